@@ -1,6 +1,9 @@
 @echo off
 REM Build script for Minigotchi with correct partition scheme
 
+echo Compressing web UI assets...
+python webui_assets.py || exit /b 1
+
 echo Building Minigotchi ESP32 firmware with huge_app partition scheme...
 arduino-cli compile --fqbn esp32:esp32:esp32:PartitionScheme=huge_app minigotchi-ESP32
 
@@ -1,6 +1,10 @@
 # Build script for PowerShell
 # Build Minigotchi with correct partition scheme
 
+Write-Host "Compressing web UI assets..." -ForegroundColor Green
+python webui_assets.py
+if ($LASTEXITCODE -ne 0) { exit 1 }
+
 Write-Host "Building Minigotchi ESP32 firmware with huge_app partition scheme..." -ForegroundColor Green
 arduino-cli compile --fqbn "esp32:esp32:esp32:PartitionScheme=huge_app" minigotchi-ESP32
 
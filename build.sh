@@ -1,6 +1,9 @@
 #!/bin/bash
 # Build script for Minigotchi with correct partition scheme
 
+echo "Compressing web UI assets..."
+python3 webui_assets.py || exit 1
+
 echo "Building Minigotchi ESP32 firmware with huge_app partition scheme..."
 arduino-cli compile --fqbn esp32:esp32:esp32:PartitionScheme=huge_app minigotchi-ESP32
 
@@ -0,0 +1,272 @@
+#include "capture_api.h"
+#include "handshake_logger.h"
+#include "hc22000.h"
+#include "logger.h"
+#include "pcap_index.h"
+#include "pcap_logger.h"
+#include <Arduino.h>
+#include <SD.h>
+#include <memory>
+
+/** developer note:
+ *
+ * both responses keep their state in a shared_ptr owned by the filler
+ * lambda, the File closes when the server drops the response, whether it
+ * finished or the client went away. fillers run on the async_tcp task, the
+ * card is shared with the capture path through the VFS lock.
+ *
+ */
+
+typedef enum { CAPTURE_RANGE_NONE, CAPTURE_RANGE_OK, CAPTURE_RANGE_UNSATISFIABLE } capture_range_t;
+
+typedef struct {
+    File file;
+    uint32_t start;
+    uint32_t len;
+    uint32_t sent;
+    uint32_t started_ms;
+} capture_stream_t;
+
+typedef struct {
+    File dir;
+    int from;
+    bool started;
+    bool done;
+    bool first;
+    char pending[160];
+    size_t pending_len;
+    size_t pending_off;
+} capture_list_t;
+
+static capture_api_stats_t capture_stats = {};
+
+static bool capture_ends_with(const char *s, const char *suffix) {
+    size_t n = strlen(s);
+    size_t m = strlen(suffix);
+    return n >= m && strcmp(s + n - m, suffix) == 0;
+}
+
+static bool capture_is_listed(const char *name) {
+    return strncmp(name, PCAP_BASE_FILENAME "_", strlen(PCAP_BASE_FILENAME) + 1) == 0 &&
+           (capture_ends_with(name, ".pcap") || capture_ends_with(name, ".pcap.gz") ||
+            capture_ends_with(name, HC22000_EXT) || capture_ends_with(name, PCAP_INDEX_EXT));
+}
+
+/**
+ * Directory a downloadable file lives in, NULL for anything else
+ */
+static const char *capture_dir_for(const char *name) {
+    if (strchr(name, '/') != NULL || strstr(name, "..") != NULL) {
+        return NULL;
+    }
+    if (capture_is_listed(name)) {
+        return PCAP_DIR;
+    }
+    if (strncmp(name, HANDSHAKE_CSV_BASE_FILENAME "_", strlen(HANDSHAKE_CSV_BASE_FILENAME) + 1) == 0 &&
+        capture_ends_with(name, ".csv")) {
+        return HANDSHAKE_CSV_DIR;
+    }
+    return NULL;
+}
+
+static const char *capture_content_type(const char *name) {
+    if (capture_ends_with(name, ".pcap")) {
+        return "application/vnd.tcpdump.pcap";
+    }
+    if (capture_ends_with(name, ".gz")) {
+        return "application/gzip";
+    }
+    if (capture_ends_with(name, PCAP_INDEX_EXT)) {
+        return "application/octet-stream";
+    }
+    return "text/plain";
+}
+
+/**
+ * One "bytes=a-b", "bytes=a-" or "bytes=-n" range, anything fancier is
+ * ignored and the whole file is sent, which RFC 9110 allows
+ */
+static capture_range_t capture_parse_range(const String &header, uint32_t size, uint32_t *start, uint32_t *end) {
+    if (!header.startsWith("bytes=") || header.indexOf(',') >= 0) {
+        return CAPTURE_RANGE_NONE;
+    }
+    int dash = header.indexOf('-');
+    if (dash < 0) {
+        return CAPTURE_RANGE_NONE;
+    }
+    String first = header.substring(6, dash);
+    String last = header.substring(dash + 1);
+    first.trim();
+    last.trim();
+    if (first.length() == 0) {
+        uint32_t suffix = last.toInt();
+        if (suffix == 0 || size == 0) {
+            return CAPTURE_RANGE_UNSATISFIABLE;
+        }
+        *start = suffix >= size ? 0 : size - suffix;
+        *end = size - 1;
+        return CAPTURE_RANGE_OK;
+    }
+    *start = first.toInt();
+    *end = last.length() ? (uint32_t)last.toInt() : size - 1;
+    if (*start >= size || *end < *start) {
+        return CAPTURE_RANGE_UNSATISFIABLE;
+    }
+    if (*end >= size) {
+        *end = size - 1;
+    }
+    return CAPTURE_RANGE_OK;
+}
+
+static void capture_download(AsyncWebServerRequest *request) {
+    if (!request->hasParam("name")) {
+        request->send(400, "text/plain", "name missing");
+        return;
+    }
+    String name = request->getParam("name")->value();
+    const char *dir = capture_dir_for(name.c_str());
+    if (dir == NULL) {
+        request->send(404, "text/plain", "no such capture");
+        return;
+    }
+    String path = String(dir) + "/" + name;
+    std::shared_ptr<capture_stream_t> st = std::make_shared<capture_stream_t>();
+    st->file = SD.open(path, FILE_READ);
+    if (!st->file || st->file.isDirectory()) {
+        request->send(404, "text/plain", "no such capture");
+        return;
+    }
+    // the open capture keeps growing, serve what is there now
+    uint32_t size = st->file.size();
+
+    uint32_t first = 0;
+    uint32_t last = size ? size - 1 : 0;
+    capture_range_t range = CAPTURE_RANGE_NONE;
+    if (request->hasHeader("Range")) {
+        range = capture_parse_range(request->getHeader("Range")->value(), size, &first, &last);
+    }
+    if (range == CAPTURE_RANGE_UNSATISFIABLE) {
+        AsyncWebServerResponse *response = request->beginResponse(416, "text/plain", "");
+        response->addHeader("Content-Range", "bytes */" + String(size));
+        request->send(response);
+        return;
+    }
+    if (first > 0 && !st->file.seek(first)) {
+        request->send(500, "text/plain", "seek failed");
+        return;
+    }
+    st->start = first;
+    st->len = size ? last - first + 1 : 0;
+    st->sent = 0;
+    st->started_ms = millis();
+    capture_stats.downloads++;
+
+    AsyncWebServerResponse *response = request->beginResponse(
+        capture_content_type(name.c_str()), st->len,
+        [st](uint8_t *buffer, size_t max_len, size_t index) -> size_t {
+            size_t want = st->len - st->sent;
+            want = want < max_len ? want : max_len;
+            want = want < CAPTURE_API_CHUNK ? want : CAPTURE_API_CHUNK;
+            if (want == 0) {
+                return 0;
+            }
+            int n = st->file.read(buffer, want);
+            if (n <= 0) {
+                LOGE("capture", "Read failed at %u", (unsigned)(st->start + st->sent));
+                return 0;
+            }
+            st->sent += n;
+            capture_stats.bytes_sent += n;
+            if (st->sent == st->len) {
+                uint32_t ms = millis() - st->started_ms;
+                capture_stats.completed++;
+                capture_stats.last_bytes = st->len;
+                capture_stats.last_ms = ms;
+                LOGI("capture", "Sent %u bytes in %u ms (%u KB/s)", (unsigned)st->len, (unsigned)ms,
+                     ms ? (unsigned)((uint64_t)st->len * 1000 / 1024 / ms) : 0);
+            }
+            return n;
+        });
+    response->addHeader("Accept-Ranges", "bytes");
+    response->addHeader("Content-Disposition", "attachment; filename=\"" + name + "\"");
+    if (range == CAPTURE_RANGE_OK) {
+        response->setCode(206);
+        response->addHeader("Content-Range",
+                            "bytes " + String(first) + "-" + String(last) + "/" + String(size));
+        capture_stats.ranges++;
+    }
+    request->send(response);
+}
+
+/**
+ * Next piece of the listing into pending, done is set with the closing brace
+ */
+static void capture_list_next(capture_list_t *st) {
+    if (!st->started) {
+        st->started = true;
+        st->pending_len = snprintf(st->pending, sizeof(st->pending), "{\"captures\":[");
+        return;
+    }
+    File f = st->dir ? st->dir.openNextFile() : File();
+    while (f) {
+        const char *n = f.name();
+        const char *slash = strrchr(n, '/');
+        n = slash ? slash + 1 : n;
+        int index = capture_is_listed(n) ? atoi(n + strlen(PCAP_BASE_FILENAME) + 1) : -1;
+        if (!f.isDirectory() && index >= 0 && index >= st->from) {
+            st->pending_len = snprintf(st->pending, sizeof(st->pending),
+                                       "%s{\"name\":\"%s\",\"index\":%d,\"size\":%u,\"open\":%s}",
+                                       st->first ? "" : ",", n, index, (unsigned)f.size(),
+                                       index == pcap_logger_current_index() ? "true" : "false");
+            st->first = false;
+            f.close();
+            return;
+        }
+        f.close();
+        f = st->dir.openNextFile();
+    }
+    st->pending_len = snprintf(st->pending, sizeof(st->pending), "],\"current\":%d}", pcap_logger_current_index());
+    st->done = true;
+}
+
+static void capture_list(AsyncWebServerRequest *request) {
+    std::shared_ptr<capture_list_t> st = std::make_shared<capture_list_t>();
+    st->dir = SD.open(PCAP_DIR);
+    st->from = request->hasParam("from") ? request->getParam("from")->value().toInt() : 0;
+    st->started = false;
+    st->done = false;
+    st->first = true;
+    st->pending_len = 0;
+    st->pending_off = 0;
+    capture_stats.listings++;
+
+    AsyncWebServerResponse *response = request->beginChunkedResponse(
+        "application/json", [st](uint8_t *buffer, size_t max_len, size_t index) -> size_t {
+            size_t out = 0;
+            while (out < max_len) {
+                if (st->pending_off < st->pending_len) {
+                    size_t n = st->pending_len - st->pending_off;
+                    n = n < max_len - out ? n : max_len - out;
+                    memcpy(buffer + out, st->pending + st->pending_off, n);
+                    st->pending_off += n;
+                    out += n;
+                    continue;
+                }
+                if (st->done) {
+                    break;
+                }
+                st->pending_off = 0;
+                capture_list_next(st.get());
+            }
+            return out;
+        });
+    response->addHeader("Cache-Control", "no-store");
+    request->send(response);
+}
+
+void capture_api_register(AsyncWebServer &server) {
+    server.on("/captures", HTTP_GET, capture_list);
+    server.on("/capture", HTTP_GET, capture_download);
+}
+
+void capture_api_get_stats(capture_api_stats_t *out) { *out = capture_stats; }
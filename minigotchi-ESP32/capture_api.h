@@ -0,0 +1,40 @@
+#ifndef CAPTURE_API_H
+#define CAPTURE_API_H
+
+#include <ESPAsyncWebServer.h>
+#include <stdint.h>
+
+/**
+ * capture_api.h: capture listing and download over the web UI
+ *
+ *   GET /captures[?from=N]    JSON list of captures, their .22000 and
+ *                             .idx sidecars, with index >= N,
+ *                             sent chunked while the directory is walked
+ *   GET /capture?name=FILE    the file itself, honouring a single
+ *                             "Range: bytes=" request with 206
+ *
+ * Files are read from the card CAPTURE_API_CHUNK bytes at a time as the
+ * TCP window opens, nothing is buffered beyond that. Only capture, hash
+ * and handshake CSV files can be fetched, by bare file name.
+ */
+
+#define CAPTURE_API_CHUNK 4096 // Largest SD read per response fill
+
+typedef struct {
+    uint32_t listings;
+    uint32_t downloads;        // Responses started
+    uint32_t ranges;           // Of those, partial
+    uint32_t completed;        // Sent to the last byte
+    uint64_t bytes_sent;
+    uint32_t last_bytes;       // Size of the last completed download
+    uint32_t last_ms;          // and how long it took
+} capture_api_stats_t;
+
+/**
+ * @brief Add the capture routes to the server
+ */
+void capture_api_register(AsyncWebServer &server);
+
+void capture_api_get_stats(capture_api_stats_t *out);
+
+#endif // CAPTURE_API_H
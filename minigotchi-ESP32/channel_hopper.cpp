@@ -6,6 +6,7 @@
 #include <WiFi.h> // Include WiFi.h for WiFi.mode() calls
 #include "esp_task_wdt.h" // For watchdog timer management
 #include "wifi_manager.h" // Include the WiFi Manager
+#include "logger.h"
 
 // Add mutex for task management
 static portMUX_TYPE channel_hopper_mutex = portMUX_INITIALIZER_UNLOCKED;
@@ -46,7 +47,7 @@ esp_err_t start_channel_hopping() {
         
         // If task still exists, force delete
         if (channel_hopping_task_handle != NULL) {
-            Serial.println(Mood::getInstance().getBroken() + " SNIFFER_START: Forcing deletion of previous task.");
+            LOGE("chan_hop", "Forcing deletion of previous task.");
             vTaskDelete(channel_hopping_task_handle);
             channel_hopping_task_handle = NULL;
         }
@@ -57,10 +58,10 @@ esp_err_t start_channel_hopping() {
 
     // Request monitor mode from WifiManager
     if (!WifiManager::getInstance().request_monitor_mode("channel_hopper")) {
-        Serial.println(Mood::getInstance().getBroken() + " SNIFFER_START: Failed to acquire monitor mode from WifiManager.");
+        LOGE("chan_hop", "Failed to acquire monitor mode from WifiManager.");
         return ESP_FAIL; // Indicate failure
     }
-    Serial.println(Mood::getInstance().getHappy() + " SNIFFER_START: Monitor mode acquired via WifiManager.");
+    LOGI("chan_hop", "Monitor mode acquired via WifiManager.");
     
     // Reset state variables
     task_should_exit = false;
@@ -71,7 +72,7 @@ esp_err_t start_channel_hopping() {
     current_hop_interval_ms = MIN_HOP_INTERVAL_MS;
     last_hop_time = esp_timer_get_time() / 1000;
     
-    Serial.println(Mood::getInstance().getIntense() + " SNIFFER_START: Creating channel hopping task...");
+    LOGI("chan_hop", "Creating channel hopping task...");
     
     BaseType_t result = xTaskCreatePinnedToCore(
         channel_hopping_task,    
@@ -84,10 +85,10 @@ esp_err_t start_channel_hopping() {
     );
     
     if (result == pdPASS && channel_hopping_task_handle != NULL) {
-        Serial.println(Mood::getInstance().getHappy() + " SNIFFER_START: Channel hopping task created successfully.");
+        LOGI("chan_hop", "Channel hopping task created successfully.");
         return ESP_OK;
     } else {
-        Serial.println(Mood::getInstance().getBroken() + " SNIFFER_START: FAILED to create channel hopping task.");
+        LOGE("chan_hop", "FAILED to create channel hopping task.");
         return ESP_FAIL;
     }
 }
@@ -95,7 +96,7 @@ esp_err_t start_channel_hopping() {
 // Helper function to stop the channel hopping task
 void stop_channel_hopping() {
     if (channel_hopping_task_handle != NULL) {
-        Serial.println(Mood::getInstance().getNeutral() + " SNIFFER_STOP: Signaling channel hopping task to exit...");
+        LOGI("chan_hop", "Signaling channel hopping task to exit...");
         
         // Signal the task to exit
         task_should_exit = true;
@@ -111,7 +112,7 @@ void stop_channel_hopping() {
         
         // If task still exists, force delete
         if (channel_hopping_task_handle != NULL) {
-            Serial.println(Mood::getInstance().getBroken() + " SNIFFER_STOP: Channel hopping task did not exit in time, forcing deletion.");
+            LOGE("chan_hop", "Channel hopping task did not exit in time, forcing deletion.");
             vTaskDelete(channel_hopping_task_handle);
             
             // Critical section to update handle
@@ -119,17 +120,16 @@ void stop_channel_hopping() {
             channel_hopping_task_handle = NULL;
             portEXIT_CRITICAL(&channel_hopper_mutex);
         } else {
-            Serial.println(Mood::getInstance().getHappy() + " SNIFFER_STOP: Channel hopping task exited gracefully.");
+            LOGI("chan_hop", "Channel hopping task exited gracefully.");
         }
         
         // Log channel hopping stats
-        Serial.printf("%s Channel hopping stats - Successful: %d, Failed: %d, Last interval: %d ms\n",
-                     Mood::getInstance().getNeutral().c_str(),
-                     successful_hops, failed_hops, current_hop_interval_ms);
+        LOGI("chan_hop", "Channel hopping stats - Successful: %u, Failed: %u, Last interval: %u ms",
+             successful_hops, failed_hops, current_hop_interval_ms);
     }
     // Release WiFi control via WifiManager
     WifiManager::getInstance().release_wifi_control("channel_hopper");
-    Serial.println(Mood::getInstance().getNeutral() + " SNIFFER_STOP: Released WiFi control via WifiManager.");
+    LOGI("chan_hop", "Released WiFi control via WifiManager.");
 }
 
 // Task runner function
@@ -137,21 +137,16 @@ void channel_hopping_task(void *pvParameters) {
     // Register with watchdog timer to avoid resets - using a safer approach
     esp_err_t wdt_err = esp_task_wdt_add(NULL);
     if (wdt_err == ESP_OK) {
-        Serial.println(Mood::getInstance().getNeutral() + " CHAN_HOP_TASK: Registered with watchdog timer.");
+        LOGI("chan_hop", "Registered with watchdog timer.");
     } else {
-        Serial.printf("%s CHAN_HOP_TASK: Failed to register with watchdog timer: %s\n",
-                     Mood::getInstance().getBroken().c_str(), 
-                     esp_err_to_name(wdt_err));
+        LOGE("chan_hop", "Failed to register with watchdog timer: %s", esp_err_to_name(wdt_err));
     }
     
-    Serial.println(Mood::getInstance().getHappy() + " CHAN_HOP_TASK: Task started with improved channel hopping logic.");
+    LOGI("chan_hop", "Task started with improved channel hopping logic.");
     
     // Print heap usage at task start
-    Serial.print("[CHAN_HOP_TASK] Free heap at start: ");
-    Serial.println(ESP.getFreeHeap());
-    UBaseType_t stackHighWaterMark = uxTaskGetStackHighWaterMark(NULL);
-    Serial.print("[CHAN_HOP_TASK] Stack high water mark at start: ");
-    Serial.println(stackHighWaterMark);
+    LOGD("chan_hop", "Free heap at start: %u, stack high water mark: %u",
+         ESP.getFreeHeap(), uxTaskGetStackHighWaterMark(NULL));
     
     const int MAX_CONSECUTIVE_FAILURES = 5;
     TickType_t last_recovery_time = 0;
@@ -164,7 +159,7 @@ void channel_hopping_task(void *pvParameters) {
         
         // Check if sniffer is still running
         if (!is_sniffer_running()) {
-            Serial.println(Mood::getInstance().getNeutral() + " CHAN_HOP_TASK: Sniffer stopped, task exiting.");
+            LOGI("chan_hop", "Sniffer stopped, task exiting.");
             break;
         }
         
@@ -179,7 +174,7 @@ void channel_hopping_task(void *pvParameters) {
             
             if (channel_hop_paused) {
                 // We're in recovery mode - just wait
-                Serial.println(Mood::getInstance().getNeutral() + " CHAN_HOP_TASK: Channel hopping paused for recovery");
+                LOGI("chan_hop", "Channel hopping paused for recovery");
                 channel_hop_paused = false; // Try again next time
                 
                 // Store recovery time for monitoring
@@ -225,30 +220,28 @@ void channel_hopping_task(void *pvParameters) {
                         current_hop_interval_ms = MAX_HOP_INTERVAL_MS;
                     }
                     
-                    Serial.printf("%s CHAN_HOP_TASK: Channel switch failed (%d consecutive). Increasing interval to %d ms\n",
-                                 Mood::getInstance().getSad().c_str(),
-                                 consecutive_failures, 
-                                 current_hop_interval_ms);
+                    LOGW("chan_hop", "Channel switch failed (%d consecutive). Increasing interval to %u ms",
+                         consecutive_failures, current_hop_interval_ms);
                       
                     // If too many consecutive failures, trigger recovery in smaller steps
                     if (consecutive_failures >= MAX_CONSECUTIVE_FAILURES) {
-                        Serial.println(Mood::getInstance().getBroken() + " CHAN_HOP_TASK: Too many consecutive failures. Requesting WiFi reset via WifiManager.");
+                        LOGE("chan_hop", "Too many consecutive failures. Requesting WiFi reset via WifiManager.");
                         channel_hop_paused = true; // Keep this to pause hopping attempts during reset
 
                         if (WifiManager::getInstance().perform_wifi_reset("channel_hopper_recovery")) {
-                            Serial.println(Mood::getInstance().getHappy() + " CHAN_HOP_TASK: WiFi reset successful via WifiManager.");
+                            LOGI("chan_hop", "WiFi reset successful via WifiManager.");
                             // WifiManager::perform_wifi_reset leaves WiFi OFF. We need monitor mode.
                             if (wdt_err == ESP_OK) esp_task_wdt_reset(); // Pet watchdog before next blocking call
                             vTaskDelay(pdMS_TO_TICKS(50)); // Brief pause
 
                             if (WifiManager::getInstance().request_monitor_mode("channel_hopper_recovery")) {
-                                Serial.println(Mood::getInstance().getHappy() + " CHAN_HOP_TASK: Monitor mode re-acquired after reset.");
+                                LOGI("chan_hop", "Monitor mode re-acquired after reset.");
                             } else {
-                                Serial.println(Mood::getInstance().getBroken() + " CHAN_HOP_TASK: FAILED to re-acquire monitor mode after reset. Task may not function.");
+                                LOGE("chan_hop", "FAILED to re-acquire monitor mode after reset. Task may not function.");
                                 task_should_exit = true; // Exit the task if monitor mode cannot be re-established.
                             }
                         } else {
-                            Serial.println(Mood::getInstance().getBroken() + " CHAN_HOP_TASK: WiFi reset FAILED via WifiManager. Task may not function.");
+                            LOGE("chan_hop", "WiFi reset FAILED via WifiManager. Task may not function.");
                             task_should_exit = true; // Exit the task if reset fails.
                         }
                         if (wdt_err == ESP_OK) esp_task_wdt_reset(); // Pet watchdog after WifiManager operations
@@ -263,11 +256,8 @@ void channel_hopping_task(void *pvParameters) {
         }
         
         // Print heap and stack usage after each hop attempt
-        Serial.print("[CHAN_HOP_TASK] Free heap after hop/check: ");
-        Serial.println(ESP.getFreeHeap());
-        stackHighWaterMark = uxTaskGetStackHighWaterMark(NULL);
-        Serial.print("[CHAN_HOP_TASK] Stack high water mark: ");
-        Serial.println(stackHighWaterMark);
+        LOGD("chan_hop", "Free heap after hop/check: %u, stack high water mark: %u",
+             ESP.getFreeHeap(), uxTaskGetStackHighWaterMark(NULL));
         
         // Use a shorter delay to keep responsive to task_should_exit
         // This also yields to the watchdog
@@ -277,13 +267,10 @@ void channel_hopping_task(void *pvParameters) {
     channel_hopping_task_handle = NULL;
     portEXIT_CRITICAL(&channel_hopper_mutex);
     
-    Serial.println(Mood::getInstance().getNeutral() + " CHAN_HOP_TASK: Task exiting normally.");
+    LOGI("chan_hop", "Task exiting normally.");
     // Print final heap and stack usage
-    Serial.print("[CHAN_HOP_TASK] Free heap at task end: ");
-    Serial.println(ESP.getFreeHeap());
-    stackHighWaterMark = uxTaskGetStackHighWaterMark(NULL);
-    Serial.print("[CHAN_HOP_TASK] Stack high water mark at end: ");
-    Serial.println(stackHighWaterMark);
+    LOGD("chan_hop", "Free heap at task end: %u, stack high water mark: %u",
+         ESP.getFreeHeap(), uxTaskGetStackHighWaterMark(NULL));
     vTaskDelete(NULL);
 }
 
@@ -22,6 +22,8 @@
 
 #include "config.h"
 #include "display.h"
+#include <rom/crc.h>
+#include <sstream>
 
 #ifdef CONFIG_WITH_SCREEN
 #include "display.cpp"
@@ -39,20 +41,49 @@
 bool Config::deauth = true;
 bool Config::advertise = true;
 bool Config::scan = true;
+
+// sweep channels for pwnagotchis on our own when the sniffer isn't running,
+// otherwise detection just listens to the sniffer
+bool Config::scanSweep = true;
 // bool Config::spam = true; // BLE functionality removed
 
 // define access point ssid and password
 const char *Config::ssid = "minigotchi";
 const char *Config::pass = "dj1ch-minigotchi";
 
+// beacon frames per second and frames per advertisement
+int Config::advertiseRate = 10;
+int Config::advertiseBurst = 20;
+
 // define universal delays
 int Config::shortDelay = 500;
 int Config::longDelay = 5000;
 
+// capture data goes to the sd card in blocks of this size, a multiple of
+// the 512 byte sector, larger blocks mean fewer FAT updates but more RAM
+int Config::pcapBlockSize = 4096;
+
+// beacons and probe responses kept per BSSID in each capture file, later
+// ones only if their contents change, 0 keeps them all
+int Config::pcapBeaconKeep = 4;
+
+// free space kept on the sd card, the oldest captures are deleted to get
+// it back, and closed captures are gzipped in the background
+int Config::storageMinFreeMB = 64;
+bool Config::storageCompress = true;
+
+// skip boot greetings, self-tests and the panel colour test, and bring up
+// nvs and the sd card alongside the display. off by default, opt in here
+bool Config::fastBoot = false;
+
 // Defines if this is running in parasite mode where it hooks up directly to a
 // Pwnagotchi
 bool Config::parasite = false;
 
+// Append "*XX" checksums to parasite frames and drop incoming frames without
+// one, leave off for hosts that don't support it yet
+bool Config::parasiteChecksum = false;
+
 // screen configuration
 bool Config::display = true;
 std::string Config::screen = "CYD";
@@ -116,69 +147,264 @@ bool Config::configured = false;
 // define version(please do not change, this should not be changed)
 std::string Config::version = "3.5.2-beta";
 
+/** developer note:
+ *
+ * only what the setup portal edits (configured and the whitelist) is kept
+ * in nvs, as one blob under one key behind a header with a version, the
+ * payload size and a crc. every other setting is read from this file on
+ * each boot, so editing config.cpp and flashing always takes effect. boot
+ * does a single nvs_get_blob into a fixed buffer. the defaults above are
+ * laid down first and the fixed part of the payload copied over them, so
+ * fields appended by a newer layout keep their defaults until the next
+ * save. the whitelist follows as length-prefixed entries at the offset the
+ * fixed part names, so it has no entry count or length limit of its own,
+ * only the CONFIG_BLOB_MAX of the whole blob. a blob of an older version
+ * goes through migrate() and is saved again in the current layout. nvs
+ * writes a blob as a new entry before dropping the old one, a power cut
+ * during save leaves the previous config.
+ *
+ */
+
+// layouts migrate() still reads, never change these
+#define CONFIG_V2_WHITELIST_MAX 10
+#define CONFIG_V2_SSID_MAX 32
+
+// version 1, when every setting was kept in nvs
+typedef struct {
+  uint8_t configured;
+  uint8_t settings[10]; // deauth ... channel, from config.cpp now
+  uint8_t whitelistCount;
+  int16_t rates[2];
+  int32_t sizes[3];
+  char screen[24];
+  char whitelist[CONFIG_V2_WHITELIST_MAX][CONFIG_V2_SSID_MAX + 1];
+} __attribute__((packed)) config_blob_v1_t;
+
+// version 2, a fixed array cut entries to 32 characters and the list to 10
+typedef struct {
+  uint8_t configured;
+  uint8_t whitelistCount;
+  char whitelist[CONFIG_V2_WHITELIST_MAX][CONFIG_V2_SSID_MAX + 1];
+} __attribute__((packed)) config_blob_v2_t;
+
+/**
+ * Replaces the whitelist with the entries of a version 1 or 2 array
+ * @param list Stored entries, CONFIG_V2_SSID_MAX characters at most
+ * @param count Entries stored
+ */
+static void config_whitelist_from(const char list[][CONFIG_V2_SSID_MAX + 1], int count) {
+  Config::whitelist.clear();
+  for (int i = 0; i < count && i < CONFIG_V2_WHITELIST_MAX; i++) {
+    Config::whitelist.push_back(std::string(list[i], strnlen(list[i], CONFIG_V2_SSID_MAX)));
+  }
+}
+
+/**
+ * Current values into a blob payload
+ * @param payload Buffer for the fixed part and the whitelist after it
+ * @param room Bytes available
+ * @return Payload size, 0 if the whitelist does not fit
+ */
+size_t Config::toBlob(uint8_t *payload, size_t room) {
+  config_blob_t blob = {};
+  blob.configured = Config::configured;
+  blob.whitelistOffset = sizeof(blob);
+
+  size_t pos = sizeof(blob);
+  for (const std::string &entry : Config::whitelist) {
+    uint16_t len = entry.size();
+    if (entry.size() > UINT16_MAX || pos + sizeof(len) + len > room) {
+      Serial.printf("Config: the whitelist needs more than the %u bytes a config can hold, not saved\n",
+                    (unsigned)(room - sizeof(blob)));
+      return 0;
+    }
+    memcpy(payload + pos, &len, sizeof(len));
+    memcpy(payload + pos + sizeof(len), entry.data(), len);
+    pos += sizeof(len) + len;
+    blob.whitelistCount++;
+  }
+  blob.whitelistBytes = pos - sizeof(blob);
+  memcpy(payload, &blob, sizeof(blob));
+  return pos;
+}
+
+/**
+ * Blob payload into the current values
+ * @param payload Stored payload of the current or a newer layout
+ * @param size Payload bytes
+ */
+void Config::fromBlob(const uint8_t *payload, size_t size) {
+  config_blob_t blob = {};
+  blob.configured = Config::configured; // defaults for anything the stored layout lacks
+  memcpy(&blob, payload, size < sizeof(blob) ? size : sizeof(blob));
+  Config::configured = blob.configured;
+
+  size_t pos = blob.whitelistOffset;
+  size_t end = pos + blob.whitelistBytes;
+  if (pos < sizeof(blob) || end > size) {
+    Serial.println("Config: stored whitelist is out of bounds, keeping the default");
+    return;
+  }
+  Config::whitelist.clear();
+  for (uint16_t i = 0; i < blob.whitelistCount; i++) {
+    uint16_t len;
+    if (pos + sizeof(len) > end) {
+      break;
+    }
+    memcpy(&len, payload + pos, sizeof(len));
+    pos += sizeof(len);
+    if (pos + len > end) {
+      break;
+    }
+    Config::whitelist.push_back(std::string((const char *)payload + pos, len));
+    pos += len;
+  }
+}
+
+/**
+ * Applies a payload stored with an older layout, one case per version
+ * @param from Version of the stored layout
+ * @param payload Stored payload
+ * @param size Payload bytes
+ * @return false if there is no upgrade from that version
+ */
+bool Config::migrate(uint16_t from, const uint8_t *payload, size_t size) {
+  switch (from) {
+  case 1: {
+    // every setting was stored, configured and the whitelist still are
+    config_blob_v1_t v1 = {};
+    memcpy(&v1, payload, size < sizeof(v1) ? size : sizeof(v1));
+    Config::configured = v1.configured;
+    config_whitelist_from(v1.whitelist, v1.whitelistCount);
+    return true;
+  }
+  case 2: {
+    // the whitelist moved from a fixed array to the variable tail
+    config_blob_v2_t v2 = {};
+    memcpy(&v2, payload, size < sizeof(v2) ? size : sizeof(v2));
+    Config::configured = v2.configured;
+    config_whitelist_from(v2.whitelist, v2.whitelistCount);
+    return true;
+  }
+  default:
+    return false;
+  }
+}
+
+/**
+ * Reads the separate keys used before the blob, true if there were any
+ * @param handle Open nvs handle
+ */
+bool Config::loadLegacy(nvs_handle_t handle) {
+  bool found = false;
+  uint8_t configured = 0;
+  if (nvs_get_u8(handle, "configured", &configured) == ESP_OK) {
+    Config::configured = (configured == 1);
+    found = true;
+  }
+
+  size_t required_size = 0;
+  if (nvs_get_str(handle, "whitelist", NULL, &required_size) == ESP_OK && required_size > 0) {
+    char *whitelistStr = (char *)malloc(required_size);
+    if (whitelistStr != NULL &&
+        nvs_get_str(handle, "whitelist", whitelistStr, &required_size) == ESP_OK) {
+      Config::whitelist.clear();
+      std::stringstream ss(whitelistStr);
+      std::string item;
+      while (std::getline(ss, item, ',')) {
+        Config::whitelist.push_back(item);
+      }
+      found = true;
+    }
+    free(whitelistStr);
+  }
+  return found;
+}
+
 /**
  * Loads configuration values from NVS
  */
 void Config::loadConfig() {
   nvs_handle_t cfgHandle;
-  esp_err_t err = nvs_open("storage", NVS_READWRITE, &cfgHandle);
-  if (err == ESP_OK) {
-    // load Config::configured
-    uint8_t configured = 0;
-    err = nvs_get_u8(cfgHandle, "configured", &configured);
-    if (err == ESP_OK) {
-      Config::configured = (configured == 1);
-    }
+  if (nvs_open(CONFIG_NVS_NAMESPACE, NVS_READWRITE, &cfgHandle) != ESP_OK) {
+    return;
+  }
+
+  static uint8_t buf[CONFIG_BLOB_MAX];
+  size_t len = sizeof(buf);
+  esp_err_t err = nvs_get_blob(cfgHandle, CONFIG_NVS_KEY, buf, &len);
 
-    // load Config::whitelist
-    size_t required_size = 0;
-    err = nvs_get_str(cfgHandle, "whitelist", NULL, &required_size);
-    if (err == ESP_OK && required_size > 0) {
-      char *whitelistStr = (char *)malloc(required_size);
-      err = nvs_get_str(cfgHandle, "whitelist", whitelistStr, &required_size);
-      if (err == ESP_OK) {
-        // convert back into a vector
-        Config::whitelist.clear();
-        std::stringstream ss(whitelistStr);
-        std::string item;
-        while (std::getline(ss, item, ',')) {
-          Config::whitelist.push_back(item);
-        }
+  if (err == ESP_ERR_NVS_NOT_FOUND) {
+    // first boot with the blob, carry the old keys over once
+    if (Config::loadLegacy(cfgHandle)) {
+      nvs_close(cfgHandle);
+      Config::saveConfig();
+      if (nvs_open(CONFIG_NVS_NAMESPACE, NVS_READWRITE, &cfgHandle) == ESP_OK) {
+        nvs_erase_key(cfgHandle, "configured");
+        nvs_erase_key(cfgHandle, "whitelist");
+        nvs_commit(cfgHandle);
+        nvs_close(cfgHandle);
       }
-      free(whitelistStr);
+      Serial.println("Config: moved the old nvs keys into the config blob");
+      return;
     }
-
     nvs_close(cfgHandle);
+    return;
+  }
+  nvs_close(cfgHandle);
+
+  const config_blob_header_t *header = (const config_blob_header_t *)buf;
+  const uint8_t *payload = buf + sizeof(config_blob_header_t);
+  if (err != ESP_OK || len < sizeof(*header) || header->magic != CONFIG_BLOB_MAGIC ||
+      header->version == 0 || header->size != len - sizeof(*header) ||
+      crc32_le(0, payload, header->size) != header->crc) {
+    Serial.println("Config: stored config is unreadable (" + String(esp_err_to_name(err)) +
+                   "), using defaults");
+    return;
   }
+  if (header->version < CONFIG_BLOB_VERSION) {
+    if (!Config::migrate(header->version, payload, header->size)) {
+      Serial.printf("Config: no upgrade from config version %u, using defaults\n",
+                    header->version);
+      return;
+    }
+    Serial.printf("Config: upgraded the stored config from version %u\n", header->version);
+    Config::saveConfig(); // in the current layout, the next boot reads it directly
+    return;
+  }
+
+  Config::fromBlob(payload, header->size);
 }
 
 /**
- * Saves configuration to NVS
+ * Saves configuration to NVS, the stored config is left alone if the
+ * current one does not fit
  */
 void Config::saveConfig() {
+  static uint8_t buf[CONFIG_BLOB_MAX];
+  config_blob_header_t *header = (config_blob_header_t *)buf;
+  uint8_t *payload = buf + sizeof(config_blob_header_t);
+  size_t size = Config::toBlob(payload, sizeof(buf) - sizeof(config_blob_header_t));
+  if (size == 0) {
+    return;
+  }
+  header->magic = CONFIG_BLOB_MAGIC;
+  header->version = CONFIG_BLOB_VERSION;
+  header->size = size;
+  header->crc = crc32_le(0, payload, size);
+
   nvs_handle_t cfgHandle;
-  esp_err_t err = nvs_open("storage", NVS_READWRITE, &cfgHandle);
+  esp_err_t err = nvs_open(CONFIG_NVS_NAMESPACE, NVS_READWRITE, &cfgHandle);
   if (err == ESP_OK) {
-    // save Config::configured
-    uint8_t configured = Config::configured ? 1 : 0;
-    err = nvs_set_u8(cfgHandle, "configured", configured);
-    ESP_ERROR_CHECK(err);
-
-    // save Config::whitelist
-    std::string whitelistStr;
-    for (size_t i = 0; i < Config::whitelist.size(); ++i) {
-      whitelistStr += Config::whitelist[i];
-      if (i < Config::whitelist.size() - 1) {
-        whitelistStr += ",";
-      }
+    err = nvs_set_blob(cfgHandle, CONFIG_NVS_KEY, buf, sizeof(config_blob_header_t) + size);
+    if (err == ESP_OK) {
+      err = nvs_commit(cfgHandle);
     }
-    err = nvs_set_str(cfgHandle, "whitelist", whitelistStr.c_str());
-    ESP_ERROR_CHECK(err);
-
-    err = nvs_commit(cfgHandle);
-    ESP_ERROR_CHECK(err);
     nvs_close(cfgHandle);
   }
+  if (err != ESP_OK) {
+    Serial.println("Config: saving failed: " + String(esp_err_to_name(err)));
+  }
 }
 
 /** developer note:
@@ -28,6 +28,7 @@
 #include "webui.h"
 #include <Arduino.h>
 #include <esp_wifi.h>
+#include <nvs.h>
 #include <iostream>
 #include <random>
 #include <string>
@@ -36,17 +37,64 @@
 // quick and dirty way to save space if you're not using a display
 #define disp 1
 
+// display libraries to compile in. DISPLAY_BACKEND_ALL keeps every driver and
+// picks one from Config::screen at boot, anything else builds only that one
+#define DISPLAY_BACKEND_ALL 0
+#define DISPLAY_BACKEND_SSD1306 1 // SSD1306, WEMOS_OLED_SHIELD
+#define DISPLAY_BACKEND_SSD1305 2 // SSD1305
+#define DISPLAY_BACKEND_U8G2 3    // IDEASPARK_SSD1306, SH1106
+#define DISPLAY_BACKEND_TFT 4     // CYD, T_DISPLAY_S3, M5STICKCP(2), M5CARDPUTER
+#define DISPLAY_BACKEND DISPLAY_BACKEND_ALL
+
+// what the setup portal edits is one checksummed blob in nvs, everything
+// else comes from config.cpp on every boot. appending a field needs no new
+// version, any other layout change bumps it and adds the upgrade from the
+// old layout to Config::migrate()
+#define CONFIG_NVS_NAMESPACE "storage"
+#define CONFIG_NVS_KEY "config"
+#define CONFIG_BLOB_VERSION 3 // 1 held every setting, 2 a fixed size whitelist
+#define CONFIG_BLOB_MAX 1024 // Whole blob with header, all the whitelist has to fit in
+#define CONFIG_BLOB_MAGIC 0x4647434D // "MCGF"
+
+typedef struct {
+  uint32_t magic;
+  uint16_t version; // Layout of the payload
+  uint16_t size;    // Payload bytes stored
+  uint32_t crc;     // crc32 of the payload
+} __attribute__((packed)) config_blob_header_t;
+
+// fixed part of the payload. later versions only append fields, so a
+// shorter blob keeps the defaults for what it lacks and a longer one is read
+// up to what we know. the whitelist sits at whitelistOffset, each entry a
+// uint16_t length and that many bytes, wherever appended fields push it
+typedef struct {
+  uint8_t configured;
+  uint8_t reserved;
+  uint16_t whitelistCount;
+  uint16_t whitelistOffset; // From the start of the payload
+  uint16_t whitelistBytes;
+} __attribute__((packed)) config_blob_t;
+
 class Config {
 public:
   static bool deauth;
   static bool advertise;
+  static int advertiseRate;
+  static int advertiseBurst;
   static bool scan;
+  static bool scanSweep;
   static bool spam;
   static const char *ssid;
   static const char *pass;
   static int shortDelay;
   static int longDelay;
+  static int pcapBlockSize;
+  static int pcapBeaconKeep;
+  static int storageMinFreeMB;
+  static bool storageCompress;
+  static bool fastBoot;
   static bool parasite;
+  static bool parasiteChecksum;
   static bool display;
   static std::string screen;
   static int baud;
@@ -91,6 +139,10 @@ public:
   static void saveConfig();
 
 private:
+  static bool loadLegacy(nvs_handle_t handle);
+  static size_t toBlob(uint8_t *payload, size_t room);
+  static void fromBlob(const uint8_t *payload, size_t size);
+  static bool migrate(uint16_t from, const uint8_t *payload, size_t size);
   static int random(int min, int max);
   static int time();
 };
@@ -27,6 +27,8 @@
 #include "mood.h"         // Ensured
 #include "display.h"      // Ensured
 #include "task_manager.h"
+#include "logger.h"
+#include "whitelist.h"    // Compiled set shared with the sniffer
 #include <esp_task_wdt.h> // Include for ESP-IDF task watchdog functions
 
 // #include "minigotchi.h" // Removed as not directly needed
@@ -53,7 +55,6 @@ extern "C" int minigotchi_ieee80211_raw_frame_sanity_check(int32_t arg, int32_t
 // Static member definitions
 TaskHandle_t Deauth::deauth_task_handle = NULL;
 bool Deauth::deauth_should_stop = false;
-std::vector<String> Deauth::whitelist = {};
 String Deauth::randomAP = "";
 int Deauth::randomIndex;
 
@@ -82,7 +83,7 @@ uint8_t Deauth::disassociateFrame[26];
 uint8_t Deauth::broadcastAddr[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
 
 /**
- * Adds SSIDs (or BSSIDs) to the whitelist
+ * Announces SSIDs (or BSSIDs) going into the whitelist
  * @param bssids SSIDs/BSSIDs to whitelist
  */
 void Deauth::add(const std::string &bssids) {
@@ -103,7 +104,6 @@ void Deauth::add(const std::string &bssids) {
                                                   (String)token.c_str() +
                                                   " to the whitelist");
     delay(Config::shortDelay);
-    whitelist.push_back(token.c_str());
   }
 }
 
@@ -114,6 +114,9 @@ void Deauth::list() {
   for (const auto &bssid : Config::whitelist) {
     Deauth::add(bssid);
   }
+  if (whitelist_load(Config::whitelist) != ESP_OK) {
+    LOGE("deauth", "Whitelist could not be compiled, nothing is excluded");
+  }
 }
 
 /**
@@ -239,7 +242,8 @@ bool Deauth::select() {
       delay(Config::shortDelay);
       Parasite::sendDeauthStatus(SKIPPING_UNENCRYPTED);
       // success remains false, will be handled by cleanup at the end
-    } else if (std::find(whitelist.begin(), whitelist.end(), randomAP) != whitelist.end()) { // check for ap in whitelist
+    } else if (whitelist_match_ssid((const uint8_t *)randomAP.c_str(), randomAP.length()) ||
+               whitelist_match_bssid(WiFi.BSSID(Deauth::randomIndex))) { // check for ap in whitelist
       Serial.println(Mood::getInstance().getNeutral() +
                      " Selected AP is in the whitelist. Skipping "
                      "deauthentication...");
@@ -405,7 +409,7 @@ void deauth_task_runner(void *pvParameters) {
     portEXIT_CRITICAL(&deauth_mutex);
 
     Serial.println(Mood::getInstance().getNeutral() + " Deauth task finished and cleaned up.");
-    vTaskDelete(NULL); // Deletes the current task
+    // TaskManager deletes the task once this returns
 }
 
 
@@ -422,12 +426,12 @@ void Deauth::deauth() {
     portEXIT_CRITICAL(&deauth_mutex);
     deauth_should_stop = false;
     // Use TaskManager to create the deauth task
-    bool created = TaskManager::getInstance().createTask(
+    task_id_t id = TaskManager::getInstance().createTask(
         "deauth_task",
         deauth_task_runner,
         8192, 1, nullptr, 0
     );
-    if (!created) {
+    if (id == TASK_ID_INVALID) {
         Serial.println(Mood::getInstance().getBroken() + " FAILED to create deauth attack task.");
         portENTER_CRITICAL(&deauth_mutex);
         Deauth::deauth_task_handle = NULL;
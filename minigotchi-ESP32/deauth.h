@@ -77,7 +77,6 @@ private:
   // static Mood &mood; // REMOVED - use Mood::getInstance() directly in .cpp
   static uint8_t bssid[6]; // Should this be here or in .cpp? If only used in .cpp, move it. For now, keep if it was like this.
   static bool deauth_should_stop; 
-  static std::vector<String> whitelist;
   static String randomAP;
 };
 
@@ -22,94 +22,619 @@
 
 #include "display.h"
 #include "mood.h" // Added missing include
+#include "display_variables.h"
+#include "task_manager.h"
+
+#if DISPLAY_HAS(DISPLAY_BACKEND_TFT)
 #include "display_test.h"
 #include "display_diagnostics.h"
-#include "display_variables.h"
+#include <esp_timer.h>
+#include "heap_tracker.h"
 
-#if disp
 TFT_eSPI tft; // Define TFT_eSPI object
-
-Adafruit_SSD1306 *Display::ssd1306_adafruit_display = nullptr;
-Adafruit_SSD1305 *Display::ssd1305_adafruit_display = nullptr;
-U8G2_SSD1306_128X64_NONAME_F_SW_I2C *Display::ssd1306_ideaspark_display =
-    nullptr;
-U8G2_SH1106_128X64_NONAME_F_SW_I2C *Display::sh1106_adafruit_display = nullptr;
-TFT_eSPI *Display::tft_display = nullptr;
 #endif
 
+DisplayDriver *Display::driver = nullptr;
+
 String Display::storedFace = "";
 String Display::previousFace = "";
 
 String Display::storedText = "";
 String Display::previousText = "";
 
+/** developer note:
+ *
+ * updateDisplay() used to draw right away in whatever task called it, which
+ * with all the delays below cost the caller 50ms+ per status line. now it only
+ * drops face/text into a single-slot mailbox and wakes the render task. if
+ * another update comes in before the render task got to the last one, the
+ * older one is simply overwritten (latest wins) and counted as dropped.
+ *
+ */
+
+#define DISPLAY_FACE_MAX_LEN 32
+#define DISPLAY_TEXT_MAX_LEN 192
+#define DISPLAY_MAX_FPS 10
+#define DISPLAY_REPORT_INTERVAL_MS 30000
+
+static portMUX_TYPE display_mutex = portMUX_INITIALIZER_UNLOCKED;
+static char pending_face[DISPLAY_FACE_MAX_LEN];
+static char pending_text[DISPLAY_TEXT_MAX_LEN];
+static bool pending_update = false;
+static bool render_busy = false; // render task is drawing, the spi bus is in use
+static volatile uint32_t posted_updates = 0;
+static volatile uint32_t dropped_updates = 0;
+static TaskHandle_t display_task_handle = NULL;
+
+#if DISPLAY_HAS(DISPLAY_BACKEND_TFT)
+/** developer note:
+ *
+ * the TFT screens (CYD, T-Display S3, M5) draw face and text into two 1-bit
+ * sprites instead of straight onto the panel. after drawing, each sprite is
+ * compared with a copy of what was last pushed and only the bounding box of
+ * the bytes that changed goes out over SPI, expanded to 16-bit colour a few
+ * rows at a time and sent with DMA where TFT_eSPI supports it. no more
+ * full-region fillRect() flicker, and a changed status line only costs the
+ * pixels that actually differ.
+ *
+ */
+
+#define TFT_LINE_BUFFER_ROWS 4
+
+typedef enum { TFT_PANEL_CYD, TFT_PANEL_T_DISPLAY_S3, TFT_PANEL_M5 } tft_panel_t;
+
+typedef struct {
+  int16_t faceHeight;
+  int16_t faceX;
+  int16_t faceY;
+  uint8_t faceSize;
+  uint16_t faceColor;
+  int16_t textY;
+  int16_t textX;
+  uint8_t textSize;
+  uint8_t maxCharsPerLine; // 0 lets the sprite wrap on its own
+  uint8_t lineHeight;
+} tft_layout_t;
+
+typedef struct {
+  TFT_eSprite *sprite;
+  uint8_t *shadow; // what the panel currently shows
+  int16_t x;
+  int16_t y;
+  int16_t w;
+  int16_t h;
+  uint16_t color;
+} tft_region_t;
+
+static tft_layout_t tft_layout = {};
+static tft_region_t tft_face_region = {};
+static tft_region_t tft_text_region = {};
+static uint16_t *tft_line_buffer[2] = {nullptr, nullptr};
+static bool tft_buffers_ready = false;
+static uint32_t tft_pixels_last = 0;
+static uint32_t tft_pixels_total = 0;
+
 /**
- * Deletes any pointers if used
+ * Allocates the 1-bit sprite and shadow copy for a screen region
+ * @param r Region to set up
+ * @param y Top of the region
+ * @param h Height of the region
+ * @param color Foreground colour used when the region is pushed
  */
-Display::~Display() {
-#if disp
-  if (ssd1306_adafruit_display) {
-    delete ssd1306_adafruit_display;
+static bool tft_region_init(tft_region_t &r, int16_t y, int16_t h,
+                            uint16_t color) {
+  r.x = 0;
+  r.y = y;
+  r.w = tft.width();
+  r.h = h;
+  r.color = color;
+  r.sprite = new TFT_eSprite(&tft);
+  r.sprite->setColorDepth(1);
+  if (r.sprite->createSprite(r.w, r.h) == nullptr) {
+    delete r.sprite;
+    r.sprite = nullptr;
+    return false;
+  }
+  r.sprite->fillSprite(0);
+
+  // panel was cleared to black, so an all-zero shadow matches it
+  r.shadow = (uint8_t *)heap_track_calloc(
+      HEAP_TAG_DISPLAY, ((r.w + 7) >> 3) * r.h, 1, MALLOC_CAP_8BIT);
+  return r.shadow != nullptr;
+}
+
+/**
+ * Sets up layout and back buffers for the TFT screens, falls back to direct
+ * drawing if there is not enough memory
+ * @param panel Which TFT board this is
+ */
+static void tft_buffers_init(tft_panel_t panel) {
+  if (panel == TFT_PANEL_CYD) {
+    tft_layout = {100, 20, 20, 8, TFT_RED, 120, 10, 2, 20, 20};
+  } else if (panel == TFT_PANEL_T_DISPLAY_S3) {
+    tft_layout = {50, 20, 0, 6, TFT_RED, 50, 10, 2, 15, 20};
+  } else {
+    tft_layout = {50, 0, 0, 6, TFT_WHITE, 50, 0, 2, 0, 20};
   }
-  if (ssd1305_adafruit_display) {
-    delete ssd1305_adafruit_display;
+
+  tft.fillScreen(TFT_BLACK);
+
+  size_t lineBytes = tft.width() * TFT_LINE_BUFFER_ROWS * sizeof(uint16_t);
+  tft_line_buffer[0] =
+      (uint16_t *)heap_track_malloc(HEAP_TAG_DISPLAY, lineBytes, MALLOC_CAP_DMA);
+  tft_line_buffer[1] =
+      (uint16_t *)heap_track_malloc(HEAP_TAG_DISPLAY, lineBytes, MALLOC_CAP_DMA);
+
+  tft_buffers_ready =
+      tft_line_buffer[0] != nullptr && tft_line_buffer[1] != nullptr &&
+      tft_region_init(tft_face_region, 0, tft_layout.faceHeight,
+                      tft_layout.faceColor) &&
+      tft_region_init(tft_text_region, tft_layout.textY,
+                      tft.height() - tft_layout.textY, TFT_WHITE);
+
+  if (!tft_buffers_ready) {
+    Serial.println("[DISPLAY] Not enough memory for TFT back buffers, drawing directly");
+    return;
+  }
+
+#ifdef ESP32_DMA
+  tft.initDMA();
+#endif
+}
+
+/**
+ * Pushes the part of a region that changed since the last push
+ * @param r Region to push
+ * @return Number of pixels sent to the panel
+ */
+static uint32_t tft_region_push(tft_region_t &r) {
+  const uint8_t *front = (const uint8_t *)r.sprite->getPointer();
+  const int rowBytes = (r.w + 7) >> 3;
+
+  // bounding box of changed bytes
+  int y0 = -1, y1 = -1, b0 = rowBytes, b1 = -1;
+  for (int y = 0; y < r.h; y++) {
+    const uint8_t *a = front + y * rowBytes;
+    const uint8_t *b = r.shadow + y * rowBytes;
+    if (memcmp(a, b, rowBytes) == 0) {
+      continue;
+    }
+    if (y0 < 0) {
+      y0 = y;
+    }
+    y1 = y;
+    for (int i = 0; i < rowBytes; i++) {
+      if (a[i] != b[i]) {
+        b0 = min(b0, i);
+        b1 = max(b1, i);
+      }
+    }
   }
-  if (ssd1306_ideaspark_display) {
-    delete ssd1306_ideaspark_display;
+
+  if (y0 < 0) {
+    return 0; // nothing changed
   }
-  if (sh1106_adafruit_display) {
-    delete sh1106_adafruit_display;
+
+  const int x0 = b0 << 3;
+  const int x1 = min((int)r.w, (b1 + 1) << 3);
+  const int w = x1 - x0;
+
+  // TFT_eSPI sends the buffer as-is unless it swaps bytes itself
+  uint16_t fg = r.color;
+  uint16_t bg = TFT_BLACK;
+  if (!tft.getSwapBytes()) {
+    fg = (fg >> 8) | (fg << 8);
+    bg = (bg >> 8) | (bg << 8);
   }
-  if (tft_display) {
-    delete tft_display;
+
+  tft.startWrite();
+  int which = 0;
+  for (int y = y0; y <= y1; y += TFT_LINE_BUFFER_ROWS) {
+    int rows = min(TFT_LINE_BUFFER_ROWS, y1 + 1 - y);
+    uint16_t *out = tft_line_buffer[which];
+
+    // filling this buffer overlaps with the DMA of the other one
+    for (int row = 0; row < rows; row++) {
+      const uint8_t *src = front + (y + row) * rowBytes;
+      for (int x = x0; x < x1; x++) {
+        *out++ = (src[x >> 3] & (0x80 >> (x & 7))) ? fg : bg;
+      }
+    }
+
+#ifdef ESP32_DMA
+    tft.pushImageDMA(r.x + x0, r.y + y, w, rows, tft_line_buffer[which]);
+#else
+    tft.pushImage(r.x + x0, r.y + y, w, rows, tft_line_buffer[which]);
+#endif
+    which ^= 1;
   }
+#ifdef ESP32_DMA
+  tft.dmaWait();
 #endif
+  tft.endWrite();
+
+  for (int y = y0; y <= y1; y++) {
+    memcpy(r.shadow + y * rowBytes, front + y * rowBytes, rowBytes);
+  }
+
+  return (uint32_t)w * (y1 - y0 + 1);
 }
 
+/** developer note:
+ *
+ * faces are drawn at text size 6-8, which goes through the slow scaled font
+ * path one pixel block at a time. so the first time a face shows up it gets
+ * rasterized once into a 1-bit bitmap (PSRAM if the board has it), from then
+ * on a face change is just a row-by-row memcpy into the face sprite.
+ *
+ */
+
+#define TFT_FACE_CACHE_SIZE 8
+#define TFT_FACE_MAX_LEN 16
+
+typedef struct {
+  char face[TFT_FACE_MAX_LEN];
+  uint8_t *bits;
+  uint16_t rowBytes;
+  uint16_t rows;
+} tft_face_glyph_t;
+
+static tft_face_glyph_t tft_face_cache[TFT_FACE_CACHE_SIZE] = {};
+static int tft_face_cache_count = 0;
+
+// draw time of a face change, rasterized vs. blitted from the cache
+static uint32_t tft_face_raster_count = 0;
+static uint64_t tft_face_raster_us = 0;
+static uint32_t tft_face_blit_count = 0;
+static uint64_t tft_face_blit_us = 0;
+
 /**
- * Function to initialize the screen ONLY.
+ * Finds a face in the cache, rasterizing it on first use
+ * @param face Face to look up
+ * @return Cached glyph or nullptr if it could not be cached
  */
-void Display::startScreen() {
-#if disp
-  if (Config::display) {
-    if (Config::screen == "SSD1306") {
-      ssd1306_adafruit_display =
-          new Adafruit_SSD1306(SSD1306_SCREEN_WIDTH, SSD1306_SCREEN_HEIGHT,
-                               &Wire, SSD1306_OLED_RESET);
-      delay(100);
-      ssd1306_adafruit_display->begin(SSD1306_SWITCHCAPVCC,
-                                      0x3C); // for the 128x64 displays
-      delay(100);
-    } else if (Config::screen == "WEMOS_OLED_SHIELD") {
-      ssd1306_adafruit_display =
-          new Adafruit_SSD1306(WEMOS_OLED_SHIELD_OLED_RESET);
-      delay(100);
-      ssd1306_adafruit_display->begin(
-          SSD1306_SWITCHCAPVCC,
-          0x3C); // initialize with the I2C addr 0x3C (for the 64x48)
-      delay(100);
-    } else if (Config::screen == "SSD1305") {
-      ssd1305_adafruit_display = new Adafruit_SSD1305(
-          SSD1305_SCREEN_WIDTH, SSD1305_SCREEN_HEIGHT, &SPI, SSD1305_OLED_DC,
-          SSD1305_OLED_RESET, SSD1305_OLED_CS, 7000000UL);
-      ssd1305_adafruit_display->begin(SSD1305_I2C_ADDRESS,
-                                      0x3c); // initialize with the
-      // I2C addr 0x3C (for the 64x48)
-      delay(100);
-    } else if (Config::screen == "IDEASPARK_SSD1306") {
-      ssd1306_ideaspark_display = new U8G2_SSD1306_128X64_NONAME_F_SW_I2C(
-          U8G2_R0, IDEASPARK_SSD1306_SCL, IDEASPARK_SSD1306_SDA, U8X8_PIN_NONE);
-      delay(100);
-      ssd1306_ideaspark_display->begin();
-      delay(100);
-    } else if (Config::screen == "SH1106") {
-      sh1106_adafruit_display = new U8G2_SH1106_128X64_NONAME_F_SW_I2C(
-          U8G2_R0, SH1106_SCL, SH1106_SDA, U8X8_PIN_NONE);
-      delay(100);
-      sh1106_adafruit_display->begin();
-      delay(100);    } else if (Config::screen ==
-               "CYD") { // Check if the screen configuration is set to "CYD" and      // execute the corresponding code
-      tft_display = &tft;
+static const tft_face_glyph_t *tft_face_glyph(const String &face) {
+  for (int i = 0; i < tft_face_cache_count; i++) {
+    if (strcmp(tft_face_cache[i].face, face.c_str()) == 0) {
+      return &tft_face_cache[i];
+    }
+  }
+
+  if (tft_face_cache_count >= TFT_FACE_CACHE_SIZE ||
+      face.length() >= TFT_FACE_MAX_LEN) {
+    return nullptr;
+  }
+
+  // the bitmap starts at column 0 so rows line up with the face sprite
+  TFT_eSprite raster(&tft);
+  raster.setColorDepth(1);
+  raster.setTextSize(tft_layout.faceSize);
+  int width = min((int)tft_face_region.w,
+                  tft_layout.faceX + (int)raster.textWidth(face));
+  int height = min((int)(tft_face_region.h - tft_layout.faceY),
+                   (int)raster.fontHeight());
+  if (width <= 0 || height <= 0 ||
+      raster.createSprite(width, height) == nullptr) {
+    return nullptr;
+  }
+  raster.fillSprite(0);
+  raster.setTextColor(1);
+  raster.setCursor(tft_layout.faceX, 0);
+  raster.print(face);
+
+  tft_face_glyph_t &glyph = tft_face_cache[tft_face_cache_count];
+  glyph.rowBytes = (width + 7) >> 3;
+  glyph.rows = height;
+  size_t size = glyph.rowBytes * glyph.rows;
+  glyph.bits = nullptr;
+  if (psramFound()) {
+    glyph.bits =
+        (uint8_t *)heap_track_malloc(HEAP_TAG_DISPLAY, size, MALLOC_CAP_SPIRAM);
+  }
+  if (glyph.bits == nullptr) {
+    glyph.bits =
+        (uint8_t *)heap_track_malloc(HEAP_TAG_DISPLAY, size, MALLOC_CAP_8BIT);
+  }
+  if (glyph.bits == nullptr) {
+    raster.deleteSprite();
+    return nullptr;
+  }
+  memcpy(glyph.bits, raster.getPointer(), size);
+  strlcpy(glyph.face, face.c_str(), sizeof(glyph.face));
+  raster.deleteSprite();
+
+  tft_face_cache_count++;
+  return &glyph;
+}
+
+/**
+ * Draws a face into the face sprite, from the cache when possible
+ * @param face Face to draw
+ */
+static void tft_draw_face(const String &face) {
+  TFT_eSprite *spr = tft_face_region.sprite;
+  uint8_t *front = (uint8_t *)spr->getPointer();
+  const int spriteRowBytes = (tft_face_region.w + 7) >> 3;
+
+  // glyphs already in the cache cost a blit, new ones pay for the raster once
+  bool cached = false;
+  for (int i = 0; i < tft_face_cache_count && !cached; i++) {
+    cached = (strcmp(tft_face_cache[i].face, face.c_str()) == 0);
+  }
+
+  int64_t start = esp_timer_get_time();
+  const tft_face_glyph_t *glyph = tft_face_glyph(face);
+
+  spr->fillSprite(0);
+  if (glyph != nullptr) {
+    for (int row = 0; row < glyph->rows; row++) {
+      memcpy(front + (tft_layout.faceY + row) * spriteRowBytes,
+             glyph->bits + row * glyph->rowBytes, glyph->rowBytes);
+    }
+  } else {
+    spr->setTextColor(1);
+    spr->setTextSize(tft_layout.faceSize);
+    spr->setCursor(tft_layout.faceX, tft_layout.faceY);
+    spr->print(face);
+  }
+
+  uint32_t elapsed = esp_timer_get_time() - start;
+  if (cached) {
+    tft_face_blit_count++;
+    tft_face_blit_us += elapsed;
+  } else {
+    tft_face_raster_count++;
+    tft_face_raster_us += elapsed;
+  }
+}
+
+/**
+ * Draws face and text on a TFT screen
+ * @param face Face to use
+ * @param text Additional text under the face
+ */
+static void tft_render(const String &face, const String &text) {
+  bool faceChanged = (face != Display::storedFace);
+  bool textChanged = (text != Display::storedText);
+  uint32_t pixels = 0;
+
+  if (!tft_buffers_ready) {
+    // direct drawing, same layout
+    if (faceChanged) {
+      tft.fillRect(0, 0, tft.width(), tft_layout.faceHeight, TFT_BLACK);
+      tft.setCursor(tft_layout.faceX, tft_layout.faceY);
+      tft.setTextSize(tft_layout.faceSize);
+      tft.setTextColor(tft_layout.faceColor);
+      tft.println(face);
+      pixels += tft.width() * tft_layout.faceHeight;
+    }
+    if (textChanged) {
+      tft.fillRect(0, tft_layout.textY, tft.width(),
+                   tft.height() - tft_layout.textY, TFT_BLACK);
+      tft.setCursor(tft_layout.textX, tft_layout.textY);
+      tft.setTextSize(tft_layout.textSize);
+      tft.setTextColor(TFT_WHITE);
+      tft.println(text);
+      pixels += tft.width() * (tft.height() - tft_layout.textY);
+    }
+  } else {
+    if (faceChanged) {
+      tft_draw_face(face);
+      pixels += tft_region_push(tft_face_region);
+    }
+
+    if (textChanged) {
+      TFT_eSprite *spr = tft_text_region.sprite;
+      spr->fillSprite(0);
+      spr->setTextColor(1);
+      spr->setTextSize(tft_layout.textSize);
+
+      if (tft_layout.maxCharsPerLine == 0) {
+        spr->setCursor(tft_layout.textX, 0);
+        spr->print(text);
+      } else {
+        // fixed-width wrap without a String per line
+        char line[32];
+        int perLine = min((int)tft_layout.maxCharsPerLine, (int)sizeof(line) - 1);
+        int currentY = 0;
+        for (unsigned int i = 0; i < text.length() && currentY < spr->height();
+             i += perLine) {
+          strlcpy(line, text.c_str() + i, perLine + 1);
+          spr->setCursor(tft_layout.textX, currentY);
+          spr->print(line);
+          currentY += tft_layout.lineHeight;
+        }
+      }
+      pixels += tft_region_push(tft_text_region);
+    }
+  }
+
+  if (faceChanged) {
+    Display::storedFace = face;
+  }
+  if (textChanged) {
+    Display::storedText = text;
+  }
+  tft_pixels_last = pixels;
+  tft_pixels_total += pixels;
+}
+#endif
+
+/** developer note:
+ *
+ * every screen is a DisplayDriver. the driver is picked once in startScreen()
+ * from Config::screen, after that drawing is a single virtual call instead of
+ * walking a chain of string compares on every update. drivers that aren't
+ * compiled in (see DISPLAY_BACKEND in config.h) don't pull in their library.
+ *
+ */
+
+class DisplayDriver {
+public:
+  virtual ~DisplayDriver() {}
+  virtual void begin() = 0;
+  virtual void draw(const String &face, const String &text) = 0;
+  virtual void printWrapped(int x, int y, const char *data) {}
+};
+
+#if DISPLAY_HAS(DISPLAY_BACKEND_SSD1306)
+class SSD1306Driver : public DisplayDriver {
+public:
+  explicit SSD1306Driver(bool wemosShield) : wemosShield(wemosShield) {}
+  ~SSD1306Driver() { delete screen; }
+
+  void begin() override {
+    if (wemosShield) {
+      screen = new Adafruit_SSD1306(WEMOS_OLED_SHIELD_OLED_RESET);
+    } else {
+      screen = new Adafruit_SSD1306(SSD1306_SCREEN_WIDTH, SSD1306_SCREEN_HEIGHT,
+                                    &Wire, SSD1306_OLED_RESET);
+    }
+    delay(100);
+    screen->begin(SSD1306_SWITCHCAPVCC, 0x3C);
+    delay(100);
+
+    // initialize w/ delays to prevent crash
+    screen->display();
+    delay(100);
+    screen->clearDisplay();
+    delay(100);
+    screen->setTextColor(WHITE);
+    delay(100);
+  }
+
+  void draw(const String &face, const String &text) override {
+    screen->clearDisplay();
+    screen->setCursor(0, 0);
+    screen->setTextSize(2);
+    screen->println(face);
+    screen->setCursor(0, 20);
+    screen->setTextSize(1);
+    screen->println(text);
+    screen->display();
+  }
+
+private:
+  bool wemosShield;
+  Adafruit_SSD1306 *screen = nullptr;
+};
+#endif
+
+#if DISPLAY_HAS(DISPLAY_BACKEND_SSD1305)
+/** developer note:
+ *
+ * ssd1305 handling is a lot more different than ssd1306,
+ * the screen height is half the expected ssd1306 size.
+ *
+ * source fork:
+ * https://github.com/dkyazzentwatwa/minigotchi-ssd1305-neopixel/blob/main/minigotchi/display.cpp
+ *
+ */
+class SSD1305Driver : public DisplayDriver {
+public:
+  ~SSD1305Driver() { delete screen; }
+
+  void begin() override {
+    screen = new Adafruit_SSD1305(SSD1305_SCREEN_WIDTH, SSD1305_SCREEN_HEIGHT,
+                                  &SPI, SSD1305_OLED_DC, SSD1305_OLED_RESET,
+                                  SSD1305_OLED_CS, 7000000UL);
+    screen->begin(SSD1305_I2C_ADDRESS, 0x3c);
+    delay(100);
+
+    // initialize w/ delays to prevent crash
+    screen->display();
+    delay(100);
+    screen->clearDisplay();
+    delay(100);
+    screen->setTextColor(WHITE);
+    delay(100);
+  }
+
+  void draw(const String &face, const String &text) override {
+    screen->clearDisplay();
+    screen->setCursor(32, 0);
+    screen->setTextSize(2);
+    screen->println(face);
+    screen->setCursor(0, 15);
+    screen->setTextSize(1);
+    screen->println(text);
+    screen->display();
+  }
+
+private:
+  Adafruit_SSD1305 *screen = nullptr;
+};
+#endif
+
+#if DISPLAY_HAS(DISPLAY_BACKEND_U8G2)
+template <typename U8G2_T> class U8G2Driver : public DisplayDriver {
+public:
+  U8G2Driver(uint8_t scl, uint8_t sda) : scl(scl), sda(sda) {}
+  ~U8G2Driver() { delete screen; }
+
+  void begin() override {
+    screen = new U8G2_T(U8G2_R0, scl, sda, U8X8_PIN_NONE);
+    delay(100);
+    screen->begin();
+    delay(100);
+    screen->clearBuffer();
+    delay(100);
+  }
+
+  void draw(const String &face, const String &text) override {
+    screen->clearBuffer();
+    screen->setDrawColor(2);
+    screen->setFont(u8g2_font_10x20_tr);
+    screen->drawStr(0, 15, face.c_str());
+    screen->setDrawColor(1);
+    screen->setFont(u8g2_font_6x10_tr);
+    printWrapped(0, 32, text.c_str());
+    screen->sendBuffer();
+  }
+
+  // U8G2 does not wrap long text on its own
+  void printWrapped(int x, int y, const char *data) override {
+    int numCharPerLine = screen->getWidth() / screen->getMaxCharWidth();
+    if (strlen(data) <= numCharPerLine &&
+        screen->getStrWidth(data) <=
+            screen->getWidth() - screen->getMaxCharWidth()) {
+      screen->drawStr(x, y, data);
+      return;
+    }
+
+    int lineNum = 0;
+    char buf[numCharPerLine + 1];
+    memset(buf, 0, sizeof(buf));
+    for (int i = 0; i < strlen(data); ++i) {
+      if (data[i] != '\n') {
+        buf[strlen(buf)] = data[i];
+      }
+      if (data[i] == '\n' || strlen(buf) == numCharPerLine ||
+          i == strlen(data) - 1 ||
+          screen->getStrWidth(buf) >=
+              screen->getWidth() - screen->getMaxCharWidth()) {
+        buf[strlen(buf)] = '\0';
+        screen->drawStr(x, y + (screen->getMaxCharHeight() * lineNum++) + 1,
+                        buf);
+        memset(buf, 0, sizeof(buf));
+      }
+    }
+  }
+
+private:
+  uint8_t scl;
+  uint8_t sda;
+  U8G2_T *screen = nullptr;
+};
+#endif
+
+#if DISPLAY_HAS(DISPLAY_BACKEND_TFT)
+class TFTDriver : public DisplayDriver {
+public:
+  explicit TFTDriver(tft_panel_t panel) : panel(panel) {}
+
+  void begin() override {
+    if (panel == TFT_PANEL_CYD) {
       // Extended hardware reset (Ghost_ESP style)
       pinMode(TFT_RST, OUTPUT);
       digitalWrite(TFT_RST, HIGH); delay(200);
@@ -117,82 +642,118 @@ void Display::startScreen() {
       digitalWrite(TFT_RST, HIGH); delay(200);
       tft.init();
       tft.setRotation(3);
-      tft.fillScreen(TFT_RED);
-      delay(1000);
-      tft.fillScreen(TFT_GREEN);
-      delay(1000);
-      tft.fillScreen(TFT_BLUE);
-      delay(1000);
+      if (!Config::fastBoot) {
+        // colour test so a dead panel is obvious on first flash
+        tft.fillScreen(TFT_RED);
+        delay(1000);
+        tft.fillScreen(TFT_GREEN);
+        delay(1000);
+        tft.fillScreen(TFT_BLUE);
+        delay(1000);
+      }
       tft.fillScreen(TFT_BLACK);
-      delay(1000);
-    }else if (Config::screen == "T_DISPLAY_S3") {
-      tft_display = &tft;
+    } else if (panel == TFT_PANEL_T_DISPLAY_S3) {
       tft.begin();
       tft.setRotation(1); // Set display rotation if needed
       delay(100);
     } else {
-      ssd1306_adafruit_display =
-          new Adafruit_SSD1306(WEMOS_OLED_SHIELD_OLED_RESET);
-      delay(100);
-      ssd1306_adafruit_display->begin(
-          SSD1306_SWITCHCAPVCC,
-          0x3C); // initialize with the I2C addr 0x3C (for the 64x48)
-      delay(100);
-    }
-
-    // initialize w/ delays to prevent crash
-    if (Config::screen == "SSD1306" && ssd1306_adafruit_display != nullptr) {
-      ssd1306_adafruit_display->display();
-      delay(100);
-      ssd1306_adafruit_display->clearDisplay();
-      delay(100);
-      ssd1306_adafruit_display->setTextColor(WHITE);
-      delay(100);
-    } else if (Config::screen == "SSD1305" &&
-               ssd1305_adafruit_display != nullptr) {
-      ssd1305_adafruit_display->display();
-      delay(100);
-      ssd1305_adafruit_display->clearDisplay();
-      delay(100);
-      ssd1305_adafruit_display->setTextColor(WHITE);
-      delay(100);
-    } else if (Config::screen == "IDEASPARK_SSD1306" &&
-               ssd1306_ideaspark_display != nullptr) {
-      ssd1306_ideaspark_display->clearBuffer();
-      delay(100);
-    } else if (Config::screen == "SH1106" &&
-               sh1106_adafruit_display != nullptr) {
-      sh1106_adafruit_display->clearBuffer();
-      delay(100);
-    } else if (Config::screen == "M5STICKCP" ||
-               Config::screen == "M5STICKCP2" ||
-               Config::screen ==
-                   "M5CARDPUTER") { // New condition for M5StickC Plus
-      tft.setRotation(1);           // Set display rotation if needed
-      tft.begin();                  // Initialize TFT_eSPI library
+      tft.begin();        // Initialize TFT_eSPI library
       delay(100);
       tft.setRotation(1); // Set display rotation if needed
       delay(100);
-      tft.fillScreen(TFT_BLACK); // Fill screen with black color
-      delay(100);
-      tft.setTextColor(TFT_WHITE); // Set text color to white
-      delay(100);
-      tft.setTextSize(2); // Set text size)
-      delay(100);
     }
+    tft_buffers_init(panel);
+  }
+
+  void draw(const String &face, const String &text) override {
+    tft_render(face, text);
+  }
+
+private:
+  tft_panel_t panel;
+};
+#endif
+
+/**
+ * Picks the driver for a screen name, nullptr if it isn't compiled in
+ * @param screen Value of Config::screen
+ */
+static DisplayDriver *display_driver_for(const std::string &screen) {
+#if DISPLAY_HAS(DISPLAY_BACKEND_SSD1306)
+  if (screen == "SSD1306") {
+    return new SSD1306Driver(false);
+  }
+  if (screen == "WEMOS_OLED_SHIELD") {
+    return new SSD1306Driver(true);
+  }
+#endif
+#if DISPLAY_HAS(DISPLAY_BACKEND_SSD1305)
+  if (screen == "SSD1305") {
+    return new SSD1305Driver();
+  }
+#endif
+#if DISPLAY_HAS(DISPLAY_BACKEND_U8G2)
+  if (screen == "IDEASPARK_SSD1306") {
+    return new U8G2Driver<U8G2_SSD1306_128X64_NONAME_F_SW_I2C>(
+        IDEASPARK_SSD1306_SCL, IDEASPARK_SSD1306_SDA);
+  }
+  if (screen == "SH1106") {
+    return new U8G2Driver<U8G2_SH1106_128X64_NONAME_F_SW_I2C>(SH1106_SCL,
+                                                              SH1106_SDA);
   }
 #endif
+#if DISPLAY_HAS(DISPLAY_BACKEND_TFT)
+  if (screen == "CYD") {
+    return new TFTDriver(TFT_PANEL_CYD);
+  }
+  if (screen == "T_DISPLAY_S3") {
+    return new TFTDriver(TFT_PANEL_T_DISPLAY_S3);
+  }
+  if (screen == "M5STICKCP" || screen == "M5STICKCP2" ||
+      screen == "M5CARDPUTER") {
+    return new TFTDriver(TFT_PANEL_M5);
+  }
+#endif
+#if DISPLAY_HAS(DISPLAY_BACKEND_SSD1306)
+  // unknown screens have always been treated as the wemos shield
+  return new SSD1306Driver(true);
+#else
+  return nullptr;
+#endif
 }
 
-/** developer note:
- *
- * ssd1305 handling is a lot more different than ssd1306,
- * the screen height is half the expected ssd1306 size.
- *
- * source fork:
- * https://github.com/dkyazzentwatwa/minigotchi-ssd1305-neopixel/blob/main/minigotchi/display.cpp
- *
+/**
+ * Deletes the driver if used
+ */
+Display::~Display() {
+  delete driver;
+  driver = nullptr;
+}
+
+/**
+ * Function to initialize the screen ONLY.
  */
+void Display::startScreen() {
+#if disp
+  if (!Config::display || driver != nullptr) {
+    return;
+  }
+
+  driver = display_driver_for(Config::screen);
+  if (driver == nullptr) {
+    Serial.printf("[DISPLAY] Screen %s is not compiled into this build\n",
+                  Config::screen.c_str());
+    return;
+  }
+  driver->begin();
+
+  if (display_task_handle == NULL) {
+    task_id_t id = TaskManager::getInstance().createTask(
+        "display_task", Display::renderTask, 4096, 1, nullptr, 1);
+    display_task_handle = TaskManager::getInstance().getTaskHandle(id);
+  }
+#endif
+}
 
 /**
  * Updates the face ONLY
@@ -205,261 +766,184 @@ void Display::updateDisplay(String face) {
 }
 
 /**
- * Updates the display with both face and text
+ * Queues face and text for the render task, never blocks the caller
  * @param face Face to use
  * @param text Additional text under the face
  */
 void Display::updateDisplay(String face, String text) {
 #if disp
-  if (Config::display) {
-    if ((Config::screen == "SSD1306" ||
-         Config::screen == "WEMOS_OLED_SHIELD") &&
-        ssd1306_adafruit_display != nullptr) {
-      ssd1306_adafruit_display->setCursor(0, 0);
-      delay(5);
-      ssd1306_adafruit_display->setTextSize(2);
-      delay(5);
-      ssd1306_adafruit_display->clearDisplay();
-      delay(5);
-      ssd1306_adafruit_display->println(face);
-      delay(5);
-      ssd1306_adafruit_display->setCursor(0, 20);
-      delay(5);
-      ssd1306_adafruit_display->setTextSize(1);
-      delay(5);
-      ssd1306_adafruit_display->println(text);
-      delay(5);
-      ssd1306_adafruit_display->display();
-      delay(5);
-    } else if (Config::screen == "SSD1305" &&
-               ssd1305_adafruit_display != nullptr) {
-      ssd1305_adafruit_display->setCursor(32, 0);
-      delay(5);
-      ssd1305_adafruit_display->setTextSize(2);
-      delay(5);
-      ssd1305_adafruit_display->clearDisplay();
-      delay(5);
-      ssd1305_adafruit_display->println(face);
-      delay(5);
-      ssd1305_adafruit_display->setCursor(0, 15);
-      delay(5);
-      ssd1305_adafruit_display->setTextSize(1);
-      delay(5);
-      ssd1305_adafruit_display->println(text);
-      delay(5);
-      ssd1305_adafruit_display->display();
-      delay(5);
-    } else if (Config::screen == "IDEASPARK_SSD1306" &&
-               ssd1306_ideaspark_display != nullptr) {
-      ssd1306_ideaspark_display->clearBuffer();
-      delay(5);
-      ssd1306_ideaspark_display->setDrawColor(2);
-      delay(5);
-      ssd1306_ideaspark_display->setFont(u8g2_font_10x20_tr);
-      delay(5);
-      ssd1306_ideaspark_display->drawStr(0, 15, face.c_str());
-      delay(5);
-      ssd1306_ideaspark_display->setDrawColor(1);
-      delay(5);
-      ssd1306_ideaspark_display->setFont(u8g2_font_6x10_tr);
-      delay(5);
-      Display::printU8G2Data(0, 32, text.c_str());
-      delay(5);
-      ssd1306_ideaspark_display->sendBuffer();
-      delay(5);
-    } else if (Config::screen == "SH1106") {
-      sh1106_adafruit_display->clearBuffer();
-      delay(5);
-      sh1106_adafruit_display->setDrawColor(2);
-      delay(5);
-      sh1106_adafruit_display->setFont(u8g2_font_10x20_tr);
-      delay(5);
-      sh1106_adafruit_display->drawStr(0, 15, face.c_str());
-      delay(5);
-      sh1106_adafruit_display->setDrawColor(1);
-      delay(5);
-      sh1106_adafruit_display->setFont(u8g2_font_6x10_tr);
-      delay(5);
-      Display::printU8G2Data(0, 32, text.c_str());
-      delay(5);
-      sh1106_adafruit_display->sendBuffer();
-      delay(5);
-
-    } else if (Config::screen == "M5STICKCP" ||
-               Config::screen == "M5STICKCP2" ||
-               Config::screen ==
-                   "M5CARDPUTER") { // New condition for M5 devices
-      bool faceChanged = (face != Display::storedFace);
-      bool textChanged = (text != Display::storedText);
-
-      if (faceChanged) {
-        tft.fillRect(0, 0, tft.width(), 50, TFT_BLACK); // Clear face area
-        delay(5);
-        tft.setTextColor(TFT_WHITE); // Set text color to white
-        delay(5);
-        tft.setCursor(0, 0); // Set cursor to start position
-        delay(5);
-        tft.setTextSize(6); // Set text size for face
-        delay(5);
-        tft.println(face); // Print face
-        delay(5);
-        Display::storedFace = face; // Store the new face
-      }
+  if (!Config::display) {
+    return;
+  }
 
-      if (textChanged) {
-        tft.fillRect(0, 50, tft.width(), tft.height() - 50,
-                     TFT_BLACK); // Clear text area
-        delay(5);
-        tft.setTextColor(TFT_WHITE); // Set text color to white
-        delay(5);
-        tft.setCursor(0, 50); // Set cursor to start position
-        delay(5);
-        tft.setTextSize(2); // Set text size for text
-        delay(5);
-        tft.println(text); // Print text
-        delay(5);
-        Display::storedText = text; // Store the new text
-      }    } else if ((Config::screen == "CYD" || Config::screen == "T_DISPLAY_S3") &&
-               tft_display != nullptr) {
-      bool faceChanged = (face != Display::storedFace);
-      bool textChanged = (text != Display::storedText);      if (faceChanged) {
-        int faceHeight = (Config::screen == "CYD") ? 100 : 50;
-        tft.fillRect(0, 0, tft.width(), faceHeight,
-                     TFT_BLACK); // Clear face area
-        tft.setCursor(20, 20);  // Center the face horizontally a bit
-        tft.setTextSize((Config::screen == "CYD") ? 8 : 6);  // Larger face for 2.8" display
-        tft.setTextColor(TFT_RED); // Make it red for better visibility
-        tft.println(face);
-        Display::storedFace = face;
-        Serial.println("Updated face: " + face);
-      }
+  // render task not running (yet), draw in the caller like before
+  if (display_task_handle == NULL) {
+    Display::render(face, text);
+    return;
+  }
 
-      if (textChanged) {
-        int textY = (Config::screen == "CYD") ? 120 : 50;
-        tft.fillRect(0, textY, tft.width(), tft.height() - textY,
-                     TFT_BLACK); // Clear text area
-        tft.setCursor(10, textY);  // Indent text slightly
-        tft.setTextSize((Config::screen == "CYD") ? 2 : 2);
-        tft.setTextColor(TFT_WHITE);
-        
-        // Word wrap for longer text
-        int maxCharsPerLine = (Config::screen == "CYD") ? 20 : 15;
-        int lineHeight = 20;
-        int currentY = textY;
-        
-        // Break text into chunks of maxCharsPerLine
-        for (int i = 0; i < text.length(); i += maxCharsPerLine) {
-          String line = text.substring(i, min(i + maxCharsPerLine, (int)text.length()));
-          tft.setCursor(10, currentY);
-          tft.println(line);
-          currentY += lineHeight;
-        }
-        
-        Display::storedText = text;
-      }
-    }
+  portENTER_CRITICAL(&display_mutex);
+  strlcpy(pending_face, face.c_str(), sizeof(pending_face));
+  strlcpy(pending_text, text.c_str(), sizeof(pending_text));
+  if (pending_update) {
+    dropped_updates++;
   }
+  pending_update = true;
+  posted_updates++;
+  portEXIT_CRITICAL(&display_mutex);
+
+  xTaskNotifyGive(display_task_handle);
 #endif
 }
 
-// If using the U8G2 library, it does not handle wrapping if text is too long to
-// fit on the screen So will print text for screens using that library via this
-// method to handle line-breaking
+/**
+ * Number of updates that were overwritten before they could be drawn
+ */
+uint32_t Display::getDroppedUpdates() { return dropped_updates; }
+
+/**
+ * Waits until the render task has drawn everything posted so far, for
+ * callers that are about to use a bus the screen may share
+ * @param timeoutMs Longest wait
+ * @return false if the render task was still busy when the wait ran out
+ */
+bool Display::waitIdle(uint32_t timeoutMs) {
+#if disp
+  unsigned long start = millis();
+  while (display_task_handle != NULL) {
+    portENTER_CRITICAL(&display_mutex);
+    bool idle = !pending_update && !render_busy;
+    portEXIT_CRITICAL(&display_mutex);
+    if (idle) {
+      break;
+    }
+    if (millis() - start >= timeoutMs) {
+      return false;
+    }
+    vTaskDelay(pdMS_TO_TICKS(5));
+  }
+#endif
+  return true;
+}
 
 /**
- * Handles U8G2 screen formatting.
- * This will only be used if the UG82 related screens are used and applied
- * within the config
- * @param x X value to print data
- * @param y Y value to print data
- * @param data Text to print
+ * Render task, draws the latest mailbox content at most DISPLAY_MAX_FPS
+ * times per second
+ * @param pvParameters Unused
  */
-void Display::printU8G2Data(int x, int y, const char *data) {
+void Display::renderTask(void *pvParameters) {
 #if disp
-  if (Config::screen == "IDEASPARK_SSD1306") {
-    auto *screen = static_cast<U8G2_SSD1306_128X64_NONAME_F_SW_I2C *>(
-        ssd1306_ideaspark_display);
+  const TickType_t minFrameTicks = pdMS_TO_TICKS(1000 / DISPLAY_MAX_FPS);
+  TickType_t lastFrame = xTaskGetTickCount() - minFrameTicks;
+  unsigned long lastReport = millis();
+  uint32_t lastReportedDrops = 0;
+  const task_id_t self = TaskManager::getInstance().self();
 
-    int numCharPerLine = screen->getWidth() / screen->getMaxCharWidth();
-    if (strlen(data) <= numCharPerLine &&
-        screen->getStrWidth(data) <=
-            screen->getWidth() - screen->getMaxCharWidth()) {
-      screen->drawStr(x, y, data);
-    } else {
-      int lineNum = 0;
-      char buf[numCharPerLine + 1];
-      memset(buf, 0, sizeof(buf));
-      for (int i = 0; i < strlen(data); ++i) {
-        if (data[i] != '\n') {
-          buf[strlen(buf)] = data[i];
-        }
-        if (data[i] == '\n' || strlen(buf) == numCharPerLine ||
-            i == strlen(data) - 1 ||
-            screen->getStrWidth(buf) >=
-                screen->getWidth() - screen->getMaxCharWidth()) {
-          buf[strlen(buf)] = '\0';
-          screen->drawStr(x, y + (screen->getMaxCharHeight() * lineNum++) + 1,
-                          buf);
-          memset(buf, 0, sizeof(buf));
-        }
-      }
+  while (!TaskManager::getInstance().shouldExit(self)) {
+    if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000)) == 0) {
+      continue;
     }
-  } else if (Config::screen == "SH1106") {
-    auto *screen = static_cast<U8G2_SH1106_128X64_NONAME_F_SW_I2C *>(
-        sh1106_adafruit_display);
 
-    int numCharPerLine = screen->getWidth() / screen->getMaxCharWidth();
-    if (strlen(data) <= numCharPerLine &&
-        screen->getStrWidth(data) <=
-            screen->getWidth() - screen->getMaxCharWidth()) {
-      screen->drawStr(x, y, data);
-    } else {
-      int lineNum = 0;
-      char buf[numCharPerLine + 1];
-      memset(buf, 0, sizeof(buf));
-      for (int i = 0; i < strlen(data); ++i) {
-        if (data[i] != '\n') {
-          buf[strlen(buf)] = data[i];
-        }
-        if (data[i] == '\n' || strlen(buf) == numCharPerLine ||
-            i == strlen(data) - 1 ||
-            screen->getStrWidth(buf) >=
-                screen->getWidth() - screen->getMaxCharWidth()) {
-          buf[strlen(buf)] = '\0';
-          screen->drawStr(x, y + (screen->getMaxCharHeight() * lineNum++) + 1,
-                          buf);
-          memset(buf, 0, sizeof(buf));
-        }
-      }
+    // frame-rate cap, anything posted meanwhile coalesces into one frame
+    TickType_t sinceLast = xTaskGetTickCount() - lastFrame;
+    if (sinceLast < minFrameTicks) {
+      vTaskDelay(minFrameTicks - sinceLast);
     }
-  } else {
-    auto *screen = static_cast<U8G2_SSD1306_128X64_NONAME_F_SW_I2C *>(
-        ssd1306_ideaspark_display);
 
-    int numCharPerLine = screen->getWidth() / screen->getMaxCharWidth();
-    if (strlen(data) <= numCharPerLine &&
-        screen->getStrWidth(data) <=
-            screen->getWidth() - screen->getMaxCharWidth()) {
-      screen->drawStr(x, y, data);
-    } else {
-      int lineNum = 0;
-      char buf[numCharPerLine + 1];
-      memset(buf, 0, sizeof(buf));
-      for (int i = 0; i < strlen(data); ++i) {
-        if (data[i] != '\n') {
-          buf[strlen(buf)] = data[i];
-        }
-        if (data[i] == '\n' || strlen(buf) == numCharPerLine ||
-            i == strlen(data) - 1 ||
-            screen->getStrWidth(buf) >=
-                screen->getWidth() - screen->getMaxCharWidth()) {
-          buf[strlen(buf)] = '\0';
-          screen->drawStr(x, y + (screen->getMaxCharHeight() * lineNum++) + 1,
-                          buf);
-          memset(buf, 0, sizeof(buf));
-        }
-      }
+    char face[DISPLAY_FACE_MAX_LEN];
+    char text[DISPLAY_TEXT_MAX_LEN];
+    portENTER_CRITICAL(&display_mutex);
+    bool hasUpdate = pending_update;
+    memcpy(face, pending_face, sizeof(face));
+    memcpy(text, pending_text, sizeof(text));
+    pending_update = false;
+    render_busy = hasUpdate;
+    portEXIT_CRITICAL(&display_mutex);
+
+    if (!hasUpdate) {
+      continue;
+    }
+
+    Display::render(String(face), String(text));
+    portENTER_CRITICAL(&display_mutex);
+    render_busy = false;
+    portEXIT_CRITICAL(&display_mutex);
+    lastFrame = xTaskGetTickCount();
+
+    if (dropped_updates != lastReportedDrops &&
+        millis() - lastReport >= DISPLAY_REPORT_INTERVAL_MS) {
+      Serial.printf("[DISPLAY] %u of %u updates coalesced\n", dropped_updates,
+                    posted_updates);
+      lastReportedDrops = dropped_updates;
+      lastReport = millis();
     }
   }
+
+  display_task_handle = NULL;
+#endif
+}
+
+/**
+ * Draws face and text on the configured screen
+ * @param face Face to use
+ * @param text Additional text under the face
+ */
+void Display::render(String face, String text) {
+  if (Config::display && driver != nullptr) {
+    driver->draw(face, text);
+  }
+}
+
+/**
+ * Pixels pushed to a TFT panel by the last update
+ */
+uint32_t Display::getLastPixelsPushed() {
+#if DISPLAY_HAS(DISPLAY_BACKEND_TFT)
+  return tft_pixels_last;
+#else
+  return 0;
+#endif
+}
+
+/**
+ * Pixels pushed to a TFT panel since boot
+ */
+uint32_t Display::getTotalPixelsPushed() {
+#if DISPLAY_HAS(DISPLAY_BACKEND_TFT)
+  return tft_pixels_total;
+#else
+  return 0;
 #endif
 }
+
+/**
+ * Prints render statistics
+ */
+void Display::printStats() {
+  Serial.printf("[DISPLAY] updates: %u posted, %u coalesced\n", posted_updates,
+                dropped_updates);
+#if DISPLAY_HAS(DISPLAY_BACKEND_TFT)
+  Serial.printf("[DISPLAY] pixels pushed: %u last, %u total\n",
+                tft_pixels_last, tft_pixels_total);
+  Serial.printf("[DISPLAY] face draw: %u rasterized avg %u us, %u cached avg %u us (%d faces cached)\n",
+                tft_face_raster_count,
+                tft_face_raster_count ? (uint32_t)(tft_face_raster_us / tft_face_raster_count) : 0,
+                tft_face_blit_count,
+                tft_face_blit_count ? (uint32_t)(tft_face_blit_us / tft_face_blit_count) : 0,
+                tft_face_cache_count);
+#endif
+}
+
+/**
+ * Handles U8G2 screen formatting.
+ * This will only be used if the UG82 related screens are used and applied
+ * within the config
+ * @param x X value to print data
+ * @param y Y value to print data
+ * @param data Text to print
+ */
+void Display::printU8G2Data(int x, int y, const char *data) {
+  if (driver != nullptr) {
+    driver->printWrapped(x, y, data);
+  }
+}
@@ -28,16 +28,32 @@
 
 // Forward declaration
 class Mood;
+class DisplayDriver;
+
+// true if the given backend is compiled into this build
+#define DISPLAY_HAS(backend)                                                   \
+  (disp && (DISPLAY_BACKEND == DISPLAY_BACKEND_ALL ||                          \
+            DISPLAY_BACKEND == (backend)))
 
 // words cannot describe how much space this has saved me
 #if disp
+#include <SPI.h>
+#include <Wire.h>
+#endif
+#if DISPLAY_HAS(DISPLAY_BACKEND_SSD1306) || DISPLAY_HAS(DISPLAY_BACKEND_SSD1305)
 #include <Adafruit_GFX.h>
-#include <Adafruit_SSD1305.h>
+#endif
+#if DISPLAY_HAS(DISPLAY_BACKEND_SSD1306)
 #include <Adafruit_SSD1306.h>
-#include <SPI.h>
+#endif
+#if DISPLAY_HAS(DISPLAY_BACKEND_SSD1305)
+#include <Adafruit_SSD1305.h>
+#endif
+#if DISPLAY_HAS(DISPLAY_BACKEND_TFT)
 #include <TFT_eSPI.h> // Defines the TFT_eSPI library for CYD
+#endif
+#if DISPLAY_HAS(DISPLAY_BACKEND_U8G2)
 #include <U8g2lib.h>
-#include <Wire.h>
 #endif
 
 #define SSD1306_SCREEN_WIDTH 128
@@ -85,6 +101,11 @@ public:
   static void updateDisplay(String face);
   static void updateDisplay(String face, String text);
   static void printU8G2Data(int x, int y, const char *data);
+  static uint32_t getDroppedUpdates();
+  static bool waitIdle(uint32_t timeoutMs);
+  static uint32_t getLastPixelsPushed();
+  static uint32_t getTotalPixelsPushed();
+  static void printStats();
   static String storedFace;
   static String previousFace;
   static String storedText;
@@ -92,13 +113,9 @@ public:
   ~Display();
 
 private:
-#if disp
-  static Adafruit_SSD1306 *ssd1306_adafruit_display;
-  static Adafruit_SSD1305 *ssd1305_adafruit_display;
-  static U8G2_SSD1306_128X64_NONAME_F_SW_I2C *ssd1306_ideaspark_display;
-  static U8G2_SH1106_128X64_NONAME_F_SW_I2C *sh1106_adafruit_display;
-  static TFT_eSPI *tft_display;
-#endif
+  static void renderTask(void *pvParameters);
+  static void render(String face, String text);
+  static DisplayDriver *driver;
 };
 
 #endif // DISPLAY_H
@@ -28,8 +28,8 @@
 #include "deauth.h"
 #include "wifi_interface.h" // Added include
 #include "mood.h"           // Added direct include for Mood
-#include "task_manager.h"   // Include TaskManager for task handling
-#include <esp_task_wdt.h>   // Include ESP-IDF task watchdog functions
+#include <esp_timer.h>      // Paced beacon transmission
+#include "heap_tracker.h"
 
 // Channel hopper helpers
 // extern bool is_channel_hopping(); // REMOVED
@@ -111,7 +111,7 @@ const int Frame::pwngridHeaderLength = sizeof(Frame::header);
 uint8_t *Frame::pack() {
   // make a json doc
   String jsonString = "";
-  DynamicJsonDocument doc(2048);
+  JsonDocument doc(heap_json_allocator());
 
   doc["epoch"] = Config::epoch;
   doc["face"] = Config::face;
@@ -147,8 +147,13 @@ uint8_t *Frame::pack() {
   serializeJson(doc, jsonString);
   Frame::essidLength = measureJson(doc);
   Frame::headerLength = 2 + ((uint8_t)(essidLength / 255) * 2);
-  uint8_t *beaconFrame = new uint8_t[Frame::pwngridHeaderLength +
-                                     Frame::essidLength + Frame::headerLength];
+  uint8_t *beaconFrame = (uint8_t *)heap_track_malloc(
+      HEAP_TAG_FRAME,
+      Frame::pwngridHeaderLength + Frame::essidLength + Frame::headerLength,
+      MALLOC_CAP_8BIT);
+  if (beaconFrame == nullptr) {
+    return nullptr;
+  }
   memcpy(beaconFrame, Frame::header, Frame::pwngridHeaderLength);
 
   /** developer note:
@@ -200,7 +205,7 @@ uint8_t *Frame::pack() {
 uint8_t *Frame::packModified() {
   // make a json doc
   String jsonString = "";
-  DynamicJsonDocument doc(2048);
+  JsonDocument doc(heap_json_allocator());
 
   doc["minigotchi"] = true;
   doc["epoch"] = Config::epoch;
@@ -237,8 +242,13 @@ uint8_t *Frame::packModified() {
   serializeJson(doc, jsonString);
   Frame::essidLength = measureJson(doc);
   Frame::headerLength = 2 + ((uint8_t)(essidLength / 255) * 2);
-  uint8_t *beaconFrame = new uint8_t[Frame::pwngridHeaderLength +
-                                     Frame::essidLength + Frame::headerLength];
+  uint8_t *beaconFrame = (uint8_t *)heap_track_malloc(
+      HEAP_TAG_FRAME,
+      Frame::pwngridHeaderLength + Frame::essidLength + Frame::headerLength,
+      MALLOC_CAP_8BIT);
+  if (beaconFrame == nullptr) {
+    return nullptr;
+  }
   memcpy(beaconFrame, Frame::header, Frame::pwngridHeaderLength);
 
   int frameByte = pwngridHeaderLength;
@@ -262,19 +272,6 @@ uint8_t *Frame::packModified() {
   return beaconFrame;
 }
 
-// Helper to ensure WiFi is initialized and started
-static bool ensure_wifi_initialized() {
-    wifi_mode_t mode;
-    esp_err_t err = esp_wifi_get_mode(&mode);
-    if (err == ESP_ERR_WIFI_NOT_INIT) {
-        wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
-        if (esp_wifi_init(&cfg) != ESP_OK) return false;
-        if (esp_wifi_start() != ESP_OK) return false;
-        return true;
-    }
-    return (err == ESP_OK);
-}
-
 // Robust WiFi mode switch helper (maximal recovery)
 static bool reset_and_set_wifi_mode(wifi_mode_t mode) {
     // Try to stop WiFi until it is stopped or not initialized
@@ -316,395 +313,233 @@ static bool reset_and_set_wifi_mode(wifi_mode_t mode) {
 }
 
 /**
- * Sends a pwnagotchi packet in AP mode with improved stability
+ * Switches the mode of a running driver, falls back to the full reset above
+ * only when the driver is down or refuses the switch
+ * @param mode Mode to switch to
  */
-bool Frame::send() {
-  Serial.printf("Frame::send() - Entry. Free heap: %d\n", ESP.getFreeHeap());
-  stop_all_wifi_tasks_and_cleanup();
-  
-  // First, check if WiFi is initialized
-  wifi_mode_t currentMode;
-  esp_err_t check_err = esp_wifi_get_mode(&currentMode);
-  
-  // If WiFi is not initialized, initialize it with better error handling
-  if (check_err == ESP_ERR_WIFI_NOT_INIT) {
-    Serial.println(Mood::getInstance().getIntense() + " WiFi not initialized, initializing now...");
-    
-    // Initialize WiFi with default configuration
-    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
-    esp_err_t init_err = esp_wifi_init(&cfg);
-    if (init_err != ESP_OK) {
-      Serial.printf("%s Failed to initialize WiFi: %s\n", 
-                    Mood::getInstance().getBroken().c_str(), esp_err_to_name(init_err));
-      return false;
-    }
-    
-    // Start WiFi
-    esp_err_t start_err = esp_wifi_start();
-    if (start_err != ESP_OK) {
-      Serial.printf("%s Failed to start WiFi: %s\n", 
-                    Mood::getInstance().getBroken().c_str(), esp_err_to_name(start_err));
-      return false;
-    }
-    
-    // Set to STA mode initially (this helps with stability)
-    esp_err_t mode_err = esp_wifi_set_mode(WIFI_MODE_STA);
-    if (mode_err != ESP_OK) {
-      Serial.printf("%s Failed to set initial WiFi mode: %s\n", 
-                    Mood::getInstance().getBroken().c_str(), esp_err_to_name(mode_err));
-      return false;
-    }
-    
-    delay(150); // Give WiFi more time to initialize
-    
-    // Re-check mode after initialization
-    check_err = esp_wifi_get_mode(&currentMode);
-    if (check_err != ESP_OK) {
-      Serial.printf("%s Failed to get WiFi mode after init: %s\n", 
-                    Mood::getInstance().getBroken().c_str(), esp_err_to_name(check_err));
-      return false;
-    }
-  } else if (check_err != ESP_OK) {
-    // Some other error occurred checking the WiFi mode
-    Serial.printf("%s Error checking WiFi mode: %s\n", 
-                  Mood::getInstance().getBroken().c_str(), esp_err_to_name(check_err));
-    return false;
-  }
-  
-  // Save current WiFi state before changing it
-  wifi_mode_t previousMode = currentMode; // Already got this above
-  
-  bool wasPromiscuous = false;
-  esp_err_t promisc_err = esp_wifi_get_promiscuous(&wasPromiscuous);
-  if (promisc_err != ESP_OK) {
-    Serial.printf("%s Error checking promiscuous mode: %s\n", 
-                  Mood::getInstance().getSad().c_str(), esp_err_to_name(promisc_err));
-    // Continue anyway, assuming not promiscuous
-    wasPromiscuous = false;
-  }
-  
-  // If we were in promiscuous mode, turn it off properly
-  if (wasPromiscuous) {
-    esp_wifi_set_promiscuous_rx_cb(NULL); // Clear callback first
-    esp_err_t promisc_off_err = esp_wifi_set_promiscuous(false);
-    if (promisc_off_err != ESP_OK) {
-      Serial.printf("%s Error disabling promiscuous mode: %s\n", 
-                    Mood::getInstance().getSad().c_str(), esp_err_to_name(promisc_off_err));
-      // Continue anyway
+static bool switch_wifi_mode(wifi_mode_t mode) {
+    wifi_mode_t current;
+    if (esp_wifi_get_mode(&current) == ESP_OK &&
+        (current == mode || esp_wifi_set_mode(mode) == ESP_OK) &&
+        esp_wifi_start() == ESP_OK) { // ESP_OK as well when already started
+        return true;
     }
-    delay(100);  // Give WiFi state time to settle
-  }
-  // Clean up existing connections if any
-  WiFi.softAPdisconnect(true);
-  WiFi.disconnect(true);
-  delay(75); // A bit more time for disconnects
-
-  // Ensure WiFi is initialized before any mode change
-  if (!ensure_wifi_initialized()) {
-    Serial.println("[Frame::send] Failed to ensure WiFi initialized before mode set!");
-    return false;
-  }
+    Serial.printf("[WiFi] Could not switch to mode %d in place, resetting the driver\n", (int)mode);
+    return reset_and_set_wifi_mode(mode);
+}
 
-  // First, verify WiFi is initialized and in a good state
-  wifi_mode_t current_mode;
-  esp_err_t mode_check_err = esp_wifi_get_mode(&current_mode);
-  
-  if (mode_check_err != ESP_OK) {
-    Serial.printf("%s WiFi not in good state before AP mode: %s\n", 
-                Mood::getInstance().getBroken().c_str(), esp_err_to_name(mode_check_err));
-    // Full cleanup and reinitialization
-    esp_wifi_stop();
-    delay(100);
-    esp_wifi_deinit();
-    delay(200);
-    // Reinitialize WiFi with default config
-    if (!ensure_wifi_initialized()) {
-      Serial.printf("%s Failed to reinitialize WiFi\n", Mood::getInstance().getBroken().c_str());
-      return false;
-    }
-    delay(150);
+/** developer note:
+ *
+ * advertising used to repack both frames and reset the driver for every
+ * single packet, and sized the burst from free heap. now both frames are
+ * packed into a small static ring that is only rebuilt when the name or the
+ * face changes, the driver just switches to AP mode and back, and an
+ * esp_timer sends the frames at Config::advertiseRate frames per second until
+ * Config::advertiseBurst frames went out, so an advertisement always costs the
+ * same.
+ *
+ */
+
+#define FRAME_RING_SIZE 2
+#define FRAME_MAX_LEN 1024
+
+static uint8_t frame_ring[FRAME_RING_SIZE][FRAME_MAX_LEN];
+static size_t frame_ring_len[FRAME_RING_SIZE];
+static int frame_ring_count = 0;
+static std::string frame_ring_key; // name and face the ring was packed with
+
+static esp_timer_handle_t frame_tx_timer = NULL;
+static SemaphoreHandle_t frame_tx_done = NULL;
+static volatile uint32_t frame_tx_target = 0;
+static volatile int64_t frame_tx_start_us = 0;
+static frame_tx_stats_t frame_tx_stats = {};
+
+// result codes we expect from esp_wifi_80211_tx, anything else lands in the last slot
+static const esp_err_t frame_tx_codes[FRAME_TX_CODE_COUNT - 1] = {
+    ESP_OK, ESP_ERR_NO_MEM, ESP_ERR_INVALID_ARG, ESP_ERR_WIFI_IF,
+    ESP_ERR_WIFI_NOT_STARTED};
+
+/**
+ * Copies a packed frame into a ring slot
+ * @param frame Frame returned by pack() or packModified(), freed here
+ */
+static void frame_ring_add(uint8_t *frame) {
+  if (frame == nullptr) {
+    return;
   }
 
-  // Set to STA mode first as a transitional state with longer delay
-  Serial.println(Mood::getInstance().getIntense() + " Setting WiFi to STA mode as transition...");
-  if (!reset_and_set_wifi_mode(WIFI_MODE_STA)) {
-    Serial.println("[Frame::send] Failed to robustly reset and set WiFi to STA mode!");
-    return false;
+  size_t frameSize =
+      Frame::pwngridHeaderLength + Frame::essidLength + Frame::headerLength;
+  if (frameSize <= FRAME_MAX_LEN && frame_ring_count < FRAME_RING_SIZE) {
+    memcpy(frame_ring[frame_ring_count], frame, frameSize);
+    frame_ring_len[frame_ring_count++] = frameSize;
+  } else {
+    Serial.printf("%s Beacon frame of %u bytes does not fit the TX ring\n",
+                  Mood::getInstance().getBroken().c_str(), (unsigned)frameSize);
   }
-  // Set to AP mode for frame transmission with retry mechanism
-  Serial.println(Mood::getInstance().getIntense() + " Setting WiFi to AP mode for transmission...");
-  bool ap_mode_ok = false;
-  for (int retry = 0; retry < 3; retry++) {
-    if (!reset_and_set_wifi_mode(WIFI_MODE_AP)) {
-      Serial.printf("[Frame::send] Failed to robustly reset and set WiFi to AP mode (attempt %d)!\n", retry+1);
-      if (retry == 2) return false;
-      delay(200 * (retry + 1));
-    } else {
-      ap_mode_ok = true;
+  heap_track_free(HEAP_TAG_FRAME, frame);
+}
+
+/**
+ * Tallies a esp_wifi_80211_tx result code
+ * @param err Result to record
+ */
+static void frame_tx_record(esp_err_t err) {
+  int slot = FRAME_TX_CODE_COUNT - 1;
+  for (int i = 0; i < FRAME_TX_CODE_COUNT - 1; i++) {
+    if (frame_tx_codes[i] == err) {
+      slot = i;
       break;
     }
   }
-  if (!ap_mode_ok) return false;
-  delay(250);  // Longer delay to ensure AP mode is fully active
-
-  // Create normal frame
-  Serial.printf("Frame::send() - About to pack frame. Free heap: %d\n", ESP.getFreeHeap());
-  uint8_t *frame = Frame::pack();
-  size_t frameSize = 0; // Initialize frameSize
-  if (frame != nullptr) {
-    frameSize = Frame::pwngridHeaderLength + Frame::essidLength + Frame::headerLength;
-    Serial.printf("Frame::send() - Frame packed. Frame size: %d. Free heap: %d\n", frameSize, ESP.getFreeHeap());
+  frame_tx_stats.codes[slot]++;
+  frame_tx_stats.sent++;
+  if (err == ESP_OK) {
+    frame_tx_stats.ok++;
   } else {
-    Serial.println("Frame::send() - Frame::pack() returned nullptr.");
-    // Restore previous WiFi state
-    esp_wifi_set_mode(previousMode);
-    if (wasPromiscuous) {
-      delay(30); // Adjusted delay
-      esp_wifi_set_promiscuous(true);
-    }
-    Serial.printf("Frame::send() - Exit (pack failed). Free heap: %d\n", ESP.getFreeHeap());
-    return false;
+    frame_tx_stats.last_err = err;
   }
+}
 
-  // Send frames
-  esp_err_t err = ESP_FAIL;
-  
-  // Only try to send if we have valid memory and frame creation succeeded (already checked)
-  // Check heap before sending
-  if (ESP.getFreeHeap() < 10000) { // This check seems redundant now with heap checks in pack and before tx, but keeping as a safeguard.
-    Serial.println(Mood::getInstance().getBroken() + " Low memory before sending, aborting");
-    if (frame != nullptr) {
-      delete[] frame;
-      frame = nullptr;
-    }
-    
-    // Restore previous WiFi state
-    esp_wifi_set_mode(previousMode);
-    if (wasPromiscuous) {
-      delay(30); // Adjusted delay
-      esp_wifi_set_promiscuous(true);
-    }
-    Serial.printf("Frame::send() - Exit (low memory). Free heap: %d\n", ESP.getFreeHeap());
-    return false;
+/**
+ * esp_timer callback, sends the next frame of the ring
+ * @param arg Unused
+ */
+static void frame_tx_timer_cb(void *arg) {
+  if (frame_tx_stats.sent >= frame_tx_target || frame_ring_count == 0) {
+    esp_timer_stop(frame_tx_timer);
+    frame_tx_stats.elapsed_us = esp_timer_get_time() - frame_tx_start_us;
+    xSemaphoreGive(frame_tx_done);
+    return;
   }
-    
-  delay(75); // A small delay before transmission - increased for better stability
-  Serial.printf("Frame::send() - Attempting to transmit first frame. WiFi Interface: WIFI_IF_AP. Free heap: %d\n", ESP.getFreeHeap());
-  err = esp_wifi_80211_tx(WIFI_IF_AP, frame, frameSize, false);
-  Serial.printf("Frame::send() - First frame tx result: %s\n", esp_err_to_name(err));
-    
-  if (err == ESP_OK) {
-    if (frame != nullptr) {
-      delete[] frame;
-      frame = nullptr;  // Prevent use-after-free
-    }
 
-    // Try to send the modified frame
-    Serial.printf("Frame::send() - About to pack modified frame. Free heap: %d\n", ESP.getFreeHeap());
-    frame = Frame::packModified();
-    if (frame != nullptr) {
-      frameSize = Frame::pwngridHeaderLength + Frame::essidLength + Frame::headerLength;
-      Serial.printf("Frame::send() - Modified frame packed. Frame size: %d. Free heap: %d\n", frameSize, ESP.getFreeHeap());
-      delay(75);  // Small delay between transmissions - increased for better stability
-      Serial.printf("Frame::send() - Attempting to transmit modified frame. WiFi Interface: WIFI_IF_AP. Free heap: %d\n", ESP.getFreeHeap());
-      err = esp_wifi_80211_tx(WIFI_IF_AP, frame, frameSize, false);
-      Serial.printf("Frame::send() - Modified frame tx result: %s\n", esp_err_to_name(err));
-      if (frame != nullptr) {
-        delete[] frame;
-        frame = nullptr;  // Prevent use-after-free
-      }
-    } else {
-      Serial.println("Frame::send() - Frame::packModified() returned nullptr.");
-      err = ESP_FAIL;  // Memory allocation failed
-      // frame is already nullptr here
-    }
-  } else {
-    if (frame != nullptr) {
-      delete[] frame;  // Clean up on error
-      frame = nullptr;
-    }
+  int slot = frame_tx_stats.sent % frame_ring_count;
+  frame_tx_record(esp_wifi_80211_tx(WIFI_IF_AP, frame_ring[slot],
+                                    frame_ring_len[slot], false));
+}
+
+/**
+ * Packs the pwnagotchi and minigotchi frames into the TX ring, unless the
+ * ring already holds them for the current name and face
+ */
+void Frame::buildRing() {
+  std::string key = Config::name + '\n' + Config::face;
+  if (frame_ring_count == FRAME_RING_SIZE && key == frame_ring_key) {
+    return;
   }
 
-  // Restore previous WiFi state
-  delay(30);  // Give WiFi time to finish transmission
-  esp_wifi_set_mode(previousMode);
-  
-  if (wasPromiscuous) {
-    delay(30);  // Give WiFi time to change mode
-    esp_wifi_set_promiscuous(true);
+  frame_ring_count = 0;
+  frame_ring_add(Frame::pack());
+  frame_ring_add(Frame::packModified());
+  // a frame that failed to pack is retried on the next advertisement
+  frame_ring_key = frame_ring_count == FRAME_RING_SIZE ? key : "";
+}
+
+/**
+ * Returns the statistics of the last advertisement
+ */
+frame_tx_stats_t Frame::getTxStats() { return frame_tx_stats; }
+
+/**
+ * Prints the statistics of the last advertisement
+ */
+void Frame::printTxStats() {
+  float seconds = frame_tx_stats.elapsed_us / 1000000.0f;
+  float rate = seconds > 0 ? frame_tx_stats.sent / seconds : 0;
+
+  Serial.printf("%s TX: %u/%u frames ok in %lld ms (%.1f fps, target %d fps)\n",
+                Mood::getInstance().getNeutral().c_str(), frame_tx_stats.ok,
+                frame_tx_stats.sent, frame_tx_stats.elapsed_us / 1000, rate,
+                Config::advertiseRate);
+  for (int i = 0; i < FRAME_TX_CODE_COUNT; i++) {
+    if (frame_tx_stats.codes[i] == 0) {
+      continue;
+    }
+    Serial.printf("%s TX:   %s x%u\n", Mood::getInstance().getNeutral().c_str(),
+                  i < FRAME_TX_CODE_COUNT - 1 ? esp_err_to_name(frame_tx_codes[i])
+                                              : "other",
+                  frame_tx_stats.codes[i]);
   }
-  Serial.printf("Frame::send() - Exit. Free heap: %d\n", ESP.getFreeHeap());
-  return (err == ESP_OK);
 }
 
 /**
  * Full usage of Pwnagotchi's advertisments on the Minigotchi.
  */
 void Frame::advertise() {
-  Serial.printf("Frame::advertise() - Entry. Free heap: %d\n", ESP.getFreeHeap());
-  stop_all_wifi_tasks_and_cleanup();
-  int packets = 0;
-  unsigned long startTime = millis();
   if (!Config::advertise) {
     Serial.println(Mood::getInstance().getNeutral() + " Advertisement disabled in config.");
-    Serial.printf("Frame::advertise() - Exit (disabled). Free heap: %d\n", ESP.getFreeHeap());
     return;  // Skip advertisement if disabled
   }
-  // Stop the sniffer temporarily if it's running
+
+  // remember the sniffer before the cleanup below stops it
   bool sniffer_was_running = is_sniffer_running();
-  if (sniffer_was_running) {
-    Serial.println(Mood::getInstance().getNeutral() + " Stopping sniffer before advertisement...");
-    esp_err_t stop_err = wifi_sniffer_stop();
-    if (stop_err != ESP_OK) {
-      Serial.printf("%s Failed to stop sniffer properly: %s\n", 
-                   Mood::getInstance().getBroken().c_str(), esp_err_to_name(stop_err));
-      Serial.println(Mood::getInstance().getIntense() + " Performing more thorough WiFi cleanup...");
-      esp_wifi_set_promiscuous_rx_cb(NULL);
-      esp_wifi_set_promiscuous(false);
-    }
-    delay(150);  // Give more time for the sniffer to stop properly
-  }
-  // Ensure we're not in monitor mode
-  bool is_promiscuous = false;
-  esp_wifi_get_promiscuous(&is_promiscuous);
-  if (is_promiscuous) {
-    Serial.println(Mood::getInstance().getIntense() + " Still in promiscuous mode, disabling...");
-    esp_wifi_set_promiscuous_rx_cb(NULL);
-    esp_wifi_set_promiscuous(false);
-    delay(100);
-  }
+  stop_all_wifi_tasks_and_cleanup();
+
   Serial.println(Mood::getInstance().getIntense() + " Starting advertisement...");
   Display::updateDisplay(Mood::getInstance().getIntense(), "Starting advertisement...");
   Parasite::sendAdvertising();
-  delay(Config::shortDelay);
-  int availableHeap = ESP.getFreeHeap();
-  int maxPackets = min(15, availableHeap / 10240);
-  maxPackets = max(3, maxPackets);
-  Serial.printf("%s Available heap: %d bytes, sending max %d packets\n", 
-               Mood::getInstance().getNeutral().c_str(), availableHeap, maxPackets);
-  Serial.printf("Frame::advertise() - Starting packet send loop. Max packets: %d. Free heap: %d\n", maxPackets, ESP.getFreeHeap());
-  WiFi.disconnect(true);
-  delay(100);
-  // Ensure WiFi is initialized before any mode/config changes
-  if (!ensure_wifi_initialized()) {
-    Serial.println("[Frame::advertise] Failed to ensure WiFi initialized before advertisement!");
-    Display::updateDisplay(Mood::getInstance().getBroken(), "WiFi init failed!");
-    return;
-  }
-  // First, check if WiFi is in an initialized state
-  wifi_mode_t current_mode;
-  esp_err_t check_err = esp_wifi_get_mode(&current_mode);
-  
-  // Only perform complete WiFi reset if we determine it's necessary
-  bool need_full_reset = false;
-  
-  if (check_err == ESP_OK) {
-    // WiFi is initialized, check if we're in a clean state
-    Serial.println(Mood::getInstance().getIntense() + " WiFi is initialized in mode: " + String(current_mode));
-    
-    // If we're not in STA mode, or there's a sniffer running, we need a reset
-    if (current_mode != WIFI_MODE_STA || sniffer_was_running) {
-      need_full_reset = true;
-    } else {
-      // WiFi is in STA mode and no sniffer, we can just use it directly
-      Serial.println(Mood::getInstance().getNeutral() + " WiFi already in clean STA mode, proceeding with advertisement...");
-      need_full_reset = false;
-    }
-  } else if (check_err == ESP_ERR_WIFI_NOT_INIT) {
-    // WiFi is not initialized, so we need to initialize it
-    Serial.println(Mood::getInstance().getIntense() + " WiFi is not initialized, will initialize for advertisement.");
-    need_full_reset = true;
+
+  // one transition into AP mode for the whole burst
+  if (!switch_wifi_mode(WIFI_MODE_AP)) {
+    Serial.println("[Frame::advertise] Failed to set WiFi to AP mode!");
+    Display::updateDisplay(Mood::getInstance().getBroken(), "WiFi mode set failed!");
   } else {
-    // Some other error, assume we need a reset
-    Serial.printf("%s Unexpected WiFi state: %s. Forcing reset.\n", 
-                Mood::getInstance().getBroken().c_str(), esp_err_to_name(check_err));
-    need_full_reset = true;
-  }
-  
-  // If we need a full reset, do it thoroughly but only once
-  if (need_full_reset) {
-    Serial.println(Mood::getInstance().getIntense() + " Performing WiFi reset for advertisement...");
-    if (!reset_and_set_wifi_mode(WIFI_MODE_STA)) {
-      Serial.println("[Frame::advertise] Failed to robustly reset and set WiFi to STA mode!");
-      Display::updateDisplay(Mood::getInstance().getBroken(), "WiFi mode set failed!");
-      return;
+    Frame::buildRing();
+
+    if (frame_tx_done == NULL) {
+      frame_tx_done = xSemaphoreCreateBinary();
     }
-    delay(150);
-    if (!reset_and_set_wifi_mode(WIFI_MODE_AP)) {
-      Serial.println("[Frame::advertise] Failed to robustly reset and set WiFi to AP mode!");
-      Display::updateDisplay(Mood::getInstance().getBroken(), "WiFi mode set failed!");
-      return;
+    if (frame_tx_timer == NULL) {
+      esp_timer_create_args_t timerArgs = {};
+      timerArgs.callback = frame_tx_timer_cb;
+      timerArgs.name = "frame_tx";
+      esp_timer_create(&timerArgs, &frame_tx_timer);
     }
-    delay(150);
-  }
-  Serial.printf("Frame::advertise() - About to send %d packets\n", maxPackets);
-  for (packets = 0; packets < maxPackets; packets++) {
-    Serial.printf("Frame::advertise() - Sending packet %d/%d\n", packets+1, maxPackets);
-    if (!Frame::send()) {
-      Serial.printf("%s Frame::send() failed during advertisement!\n", Mood::getInstance().getBroken().c_str());
-      break;
+
+    int rate = constrain(Config::advertiseRate, 1, 100);
+    frame_tx_stats = {};
+    frame_tx_target = Config::advertiseBurst;
+    frame_tx_start_us = esp_timer_get_time();
+    xSemaphoreTake(frame_tx_done, 0); // drop a stale completion
+
+    esp_err_t err = esp_timer_start_periodic(frame_tx_timer, 1000000 / rate);
+    if (err != ESP_OK) {
+      Serial.printf("%s Failed to start TX timer: %s\n",
+                    Mood::getInstance().getBroken().c_str(), esp_err_to_name(err));
+    } else {
+      // the burst takes burst/rate seconds, give it one more second
+      TickType_t timeout =
+          pdMS_TO_TICKS((Config::advertiseBurst * 1000) / rate + 1000);
+      if (xSemaphoreTake(frame_tx_done, timeout) != pdTRUE) {
+        esp_timer_stop(frame_tx_timer);
+        frame_tx_stats.elapsed_us = esp_timer_get_time() - frame_tx_start_us;
+        Serial.println(Mood::getInstance().getBroken() + " Advertisement timed out.");
+      }
     }
-    delay(Config::shortDelay);
+
+    Frame::printTxStats();
+    Serial.println(Mood::getInstance().getIntense() + " Advertisement complete.");
+    Display::updateDisplay(Mood::getInstance().getIntense(), "Advertisement done!");
   }
-  unsigned long endTime = millis();
-  Serial.printf("Frame::advertise() - Sent %d packets in %lu ms. Free heap: %d\n", 
-               packets, endTime - startTime, ESP.getFreeHeap());
-  Serial.println(Mood::getInstance().getIntense() + " Advertisement complete.");
-  Display::updateDisplay(Mood::getInstance().getIntense(), "Advertisement done!");
-  delay(500);
+
   if (sniffer_was_running) {
-    delay(300);
     Serial.println(Mood::getInstance().getIntense() + " Setting WiFi to STA mode before restarting sniffer...");
     bool sta_ok = false;
     for (int retry = 0; retry < 3; retry++) {
-      if (!reset_and_set_wifi_mode(WIFI_MODE_STA)) {
-        Serial.printf("[Frame::advertise] Failed to robustly reset and set WiFi to STA mode (attempt %d)!\n", retry+1);
-        if (retry == 2) {
-          Display::updateDisplay(Mood::getInstance().getBroken(), "WiFi mode set failed!");
-          return;
-        }
-        delay(200 * (retry + 1));
-      } else {
+      if (switch_wifi_mode(WIFI_MODE_STA)) {
         sta_ok = true;
         break;
       }
+      Serial.printf("[Frame::advertise] Failed to set WiFi to STA mode (attempt %d)!\n", retry+1);
+      delay(200 * (retry + 1));
+    }
+    if (!sta_ok) {
+      Display::updateDisplay(Mood::getInstance().getBroken(), "WiFi mode set failed!");
+      return;
     }
-    if (!sta_ok) return;
-    delay(200);
     Serial.println(Mood::getInstance().getIntense() + " Restarting sniffer...");
     wifi_sniffer_start();
   }
-  Serial.printf("Frame::advertise() - Exit. Free heap: %d\n", ESP.getFreeHeap());
-}
-
-// Example: Frame sending task using TaskManager and robust pattern
-void frame_sending_task(void *pvParameters) {
-    esp_err_t wdt_err = esp_task_wdt_add(NULL);
-    uint32_t min_interval = 500; // ms
-    uint32_t max_interval = 2000; // ms
-    uint32_t interval = min_interval;
-    int failures = 0;
-    const int max_failures = 5;
-    while (!taskShouldExit("frame_sending_task")) {
-        // ... frame sending logic ...
-        bool success = true; // Replace with actual send result
-        if (success) {
-            failures = 0;
-            if (interval > min_interval) interval -= 100;
-        } else {
-            failures++;
-            if (interval < max_interval) interval += 100;
-            if (failures >= max_failures) {
-                // Recovery logic, e.g., WiFi reset
-                failures = 0;
-            }
-        }
-        if (wdt_err == ESP_OK) esp_task_wdt_reset();
-        vTaskDelay(pdMS_TO_TICKS(interval));
-    }
-    // Cleanup
-    // ... free resources, release WiFi, etc. ...
-    vTaskDelete(NULL);
 }
 
 // Robust global WiFi/FreeRTOS cleanup helper
@@ -745,9 +580,8 @@ static void stop_all_wifi_tasks_and_cleanup() {
         stop_deauth_attack(); // Updated to use function from wifi_interface.h
         delay(50);
     }
-    // Disconnect WiFi
-    WiFi.softAPdisconnect(true);
-    WiFi.disconnect(true);
+    // Drop a station link, but leave the driver up for the mode switch
+    esp_wifi_disconnect();
     delay(50);
     Serial.println("[WiFi Cleanup] All WiFi-related tasks and callbacks stopped.");
 }
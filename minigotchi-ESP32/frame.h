@@ -36,12 +36,26 @@
 // forward declaration of mood class
 class Mood;
 
+// ESP_OK, NO_MEM, INVALID_ARG, WIFI_IF, WIFI_NOT_STARTED and everything else
+#define FRAME_TX_CODE_COUNT 6
+
+// statistics of the last advertisement burst
+typedef struct {
+  uint32_t sent;
+  uint32_t ok;
+  esp_err_t last_err;
+  int64_t elapsed_us;
+  uint32_t codes[FRAME_TX_CODE_COUNT];
+} frame_tx_stats_t;
+
 class Frame {
 public:
   static uint8_t *pack();
   static uint8_t *packModified();
-  static bool send();
+  static void buildRing();
   static void advertise();
+  static frame_tx_stats_t getTxStats();
+  static void printTxStats();
   static const uint8_t header[];
   static const uint8_t IDWhisperPayload;
   static const uint8_t IDWhisperCompression;
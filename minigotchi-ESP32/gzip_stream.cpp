@@ -0,0 +1,213 @@
+#include "gzip_stream.h"
+#include <rom/crc.h>
+#include <string.h>
+
+#define GZ_MIN_MATCH 3
+#define GZ_MAX_MATCH 258
+#define GZ_END_OF_BLOCK 256
+
+static const uint16_t gz_length_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27,
+    31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t gz_length_extra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+    2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t gz_dist_base[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129,
+    193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t gz_dist_extra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+    6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+static void gz_flush_out(gz_stream_t *gz) {
+    if (gz->out_len == 0) {
+        return;
+    }
+    if (gz->out->write(gz->outbuf, gz->out_len) != gz->out_len) {
+        gz->failed = true;
+    }
+    gz->out_total += gz->out_len;
+    gz->out_len = 0;
+}
+
+static void gz_put_byte(gz_stream_t *gz, uint8_t b) {
+    gz->outbuf[gz->out_len++] = b;
+    if (gz->out_len == GZ_OUT_SIZE) {
+        gz_flush_out(gz);
+    }
+}
+
+/**
+ * Deflate packs bits from the least significant end
+ */
+static void gz_put_bits(gz_stream_t *gz, uint32_t value, uint8_t count) {
+    gz->bitbuf |= value << gz->bitcount;
+    gz->bitcount += count;
+    while (gz->bitcount >= 8) {
+        gz_put_byte(gz, gz->bitbuf & 0xFF);
+        gz->bitbuf >>= 8;
+        gz->bitcount -= 8;
+    }
+}
+
+/**
+ * Huffman codes are defined most significant bit first
+ */
+static void gz_put_code(gz_stream_t *gz, uint32_t code, uint8_t len) {
+    uint32_t reversed = 0;
+    for (uint8_t i = 0; i < len; i++) {
+        reversed = (reversed << 1) | (code & 1);
+        code >>= 1;
+    }
+    gz_put_bits(gz, reversed, len);
+}
+
+static void gz_put_symbol(gz_stream_t *gz, uint16_t sym) {
+    if (sym < 144) {
+        gz_put_code(gz, 0x30 + sym, 8);
+    } else if (sym < 256) {
+        gz_put_code(gz, 0x190 + (sym - 144), 9);
+    } else if (sym < 280) {
+        gz_put_code(gz, sym - 256, 7);
+    } else {
+        gz_put_code(gz, 0xC0 + (sym - 280), 8);
+    }
+}
+
+static void gz_put_match(gz_stream_t *gz, uint32_t len, uint32_t dist) {
+    int l = 28;
+    while (gz_length_base[l] > len) {
+        l--;
+    }
+    gz_put_symbol(gz, 257 + l);
+    if (gz_length_extra[l]) {
+        gz_put_bits(gz, len - gz_length_base[l], gz_length_extra[l]);
+    }
+    int d = 29;
+    while (gz_dist_base[d] > dist) {
+        d--;
+    }
+    gz_put_code(gz, d, 5);
+    if (gz_dist_extra[d]) {
+        gz_put_bits(gz, dist - gz_dist_base[d], gz_dist_extra[d]);
+    }
+}
+
+static inline uint32_t gz_hash(const uint8_t *p) {
+    uint32_t v = (p[0] << 16) | (p[1] << 8) | p[2];
+    return (v * 2654435761u) >> (32 - GZ_HASH_BITS);
+}
+
+/**
+ * Codes buf from pos, leaving a full match worth of lookahead unless final
+ */
+static void gz_encode(gz_stream_t *gz, bool final) {
+    while (gz->pos < gz->buf_len) {
+        uint32_t avail = gz->buf_len - gz->pos;
+        if (!final && avail < GZ_MAX_MATCH) {
+            break;
+        }
+        uint32_t len = 0;
+        uint32_t dist = 0;
+        if (avail >= GZ_MIN_MATCH) {
+            uint32_t h = gz_hash(gz->buf + gz->pos);
+            uint32_t here = gz->base + gz->pos;
+            uint32_t cand = gz->head[h];
+            gz->head[h] = here + 1;
+            if (cand != 0 && cand - 1 >= gz->base && here - (cand - 1) <= GZ_WINDOW) {
+                const uint8_t *a = gz->buf + (cand - 1 - gz->base);
+                const uint8_t *b = gz->buf + gz->pos;
+                uint32_t max = avail < GZ_MAX_MATCH ? avail : GZ_MAX_MATCH;
+                while (len < max && a[len] == b[len]) {
+                    len++;
+                }
+                dist = here - (cand - 1);
+            }
+        }
+        if (len >= GZ_MIN_MATCH) {
+            gz_put_match(gz, len, dist);
+            // index the covered positions too, repeated frames chain well
+            for (uint32_t i = 1; i < len && gz->pos + i + GZ_MIN_MATCH <= gz->buf_len; i++) {
+                gz->head[gz_hash(gz->buf + gz->pos + i)] = gz->base + gz->pos + i + 1;
+            }
+            gz->pos += len;
+        } else {
+            gz_put_symbol(gz, gz->buf[gz->pos]);
+            gz->pos++;
+        }
+    }
+}
+
+/**
+ * Drops history older than one window to make room for input
+ */
+static void gz_slide(gz_stream_t *gz) {
+    if (gz->pos <= GZ_WINDOW) {
+        return;
+    }
+    uint32_t shift = gz->pos - GZ_WINDOW;
+    memmove(gz->buf, gz->buf + shift, gz->buf_len - shift);
+    gz->base += shift;
+    gz->pos -= shift;
+    gz->buf_len -= shift;
+}
+
+void gz_stream_begin(gz_stream_t *gz, Print *out) {
+    memset(gz->head, 0, sizeof(gz->head));
+    gz->out = out;
+    gz->buf_len = 0;
+    gz->pos = 0;
+    gz->base = 0;
+    gz->bitbuf = 0;
+    gz->bitcount = 0;
+    gz->out_len = 0;
+    gz->crc = 0;
+    gz->in_total = 0;
+    gz->out_total = 0;
+    gz->failed = false;
+
+    // magic, deflate, no flags, no mtime, no extra flags, unknown OS
+    static const uint8_t header[10] = {0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff};
+    for (size_t i = 0; i < sizeof(header); i++) {
+        gz_put_byte(gz, header[i]);
+    }
+    // one final block with the fixed tables for the whole stream
+    gz_put_bits(gz, 1, 1);
+    gz_put_bits(gz, 1, 2);
+}
+
+bool gz_stream_write(gz_stream_t *gz, const uint8_t *data, size_t len) {
+    gz->crc = crc32_le(gz->crc, data, len);
+    gz->in_total += len;
+    while (len > 0 && !gz->failed) {
+        if (gz->buf_len == GZ_BUF_SIZE) {
+            gz_encode(gz, false);
+            gz_slide(gz);
+        }
+        size_t n = GZ_BUF_SIZE - gz->buf_len;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(gz->buf + gz->buf_len, data, n);
+        gz->buf_len += n;
+        data += n;
+        len -= n;
+    }
+    return !gz->failed;
+}
+
+bool gz_stream_end(gz_stream_t *gz) {
+    gz_encode(gz, true);
+    gz_put_symbol(gz, GZ_END_OF_BLOCK);
+    if (gz->bitcount > 0) {
+        gz_put_bits(gz, 0, 8 - gz->bitcount);
+    }
+    for (int i = 0; i < 4; i++) {
+        gz_put_byte(gz, (gz->crc >> (8 * i)) & 0xFF);
+    }
+    for (int i = 0; i < 4; i++) {
+        gz_put_byte(gz, (gz->in_total >> (8 * i)) & 0xFF);
+    }
+    gz_flush_out(gz);
+    return !gz->failed;
+}
@@ -0,0 +1,62 @@
+#ifndef GZIP_STREAM_H
+#define GZIP_STREAM_H
+
+#include <Print.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * gzip_stream.h: small streaming gzip writer
+ *
+ * Input goes through a single-candidate LZ77 match finder over a 4 KB
+ * window and is coded with the fixed deflate Huffman tables, so there are
+ * no tables to build or store. The ratio is below zlib's, but the state is
+ * about 17 KB and the output is plain gzip that gunzip, zcat and Wireshark
+ * read directly.
+ */
+
+#define GZ_WINDOW 4096
+#define GZ_BUF_SIZE (GZ_WINDOW * 2)
+#define GZ_HASH_BITS 11
+#define GZ_OUT_SIZE 1024
+
+typedef struct {
+    Print *out;
+    uint8_t buf[GZ_BUF_SIZE];           // History window plus lookahead
+    uint32_t buf_len;
+    uint32_t pos;                       // Next byte of buf to code
+    uint32_t base;                      // Stream offset of buf[0]
+    uint32_t head[1 << GZ_HASH_BITS];   // Stream offset + 1 of the last 3-byte match, 0 if none
+    uint32_t bitbuf;
+    uint8_t bitcount;
+    uint8_t outbuf[GZ_OUT_SIZE];
+    size_t out_len;
+    uint32_t crc;
+    uint32_t in_total;
+    uint32_t out_total;
+    bool failed;                        // A write to out came up short
+} gz_stream_t;
+
+/**
+ * @brief Start a gzip member, writes the header
+ *
+ * @param gz State, about 17 KB, keep it off the stack
+ * @param out Where the compressed bytes go, e.g. an SD File
+ */
+void gz_stream_begin(gz_stream_t *gz, Print *out);
+
+/**
+ * @brief Compress more input
+ *
+ * @return false once a write to out has failed
+ */
+bool gz_stream_write(gz_stream_t *gz, const uint8_t *data, size_t len);
+
+/**
+ * @brief Code what is left, write the trailer and flush
+ *
+ * @return false if any write to out failed
+ */
+bool gz_stream_end(gz_stream_t *gz);
+
+#endif // GZIP_STREAM_H
@@ -3,6 +3,8 @@
 #include "minigotchi.h"   // For Minigotchi::getMood() access
 #include "wifi_frames.h"  // For EAPOL message types
 #include "display_variables.h" // For display variables
+#include "logger.h"
+#include "storage_manager.h"
 
 #include <SD.h>
 #include <SPI.h>
@@ -101,6 +103,7 @@ esp_err_t handshake_logger_open_new_file(void) {
         return ESP_ERR_TIMEOUT;
     }
 
+    storage_make_room();
     int next_index = get_next_csv_file_index(HANDSHAKE_CSV_DIR, HANDSHAKE_CSV_BASE_FILENAME);
     snprintf(current_csv_filename, MAX_CSV_FILE_NAME_LENGTH,
              "%s/%s_%d.csv", HANDSHAKE_CSV_DIR, HANDSHAKE_CSV_BASE_FILENAME, next_index);
@@ -167,15 +170,15 @@ esp_err_t handshake_logger_write_entry(const char* bssid, const char* station_ma
 
     // If file isn't open, try to open one
     if (!csv_file_is_open) {
-        Serial.println(Mood::getInstance().getNeutral() + " Handshake CSV: File not open, attempting to open new file before writing entry.");
+        LOGD("handshake", "File not open, attempting to open new file before writing entry.");
         if (handshake_logger_open_new_file() != ESP_OK) {
-            Serial.println(Mood::getInstance().getBroken() + " Handshake CSV: Failed to auto-open file. Entry not written.");
+            LOGE("handshake", "Failed to auto-open file. Entry not written.");
             return ESP_FAIL;
         }
     }
 
     if (xSemaphoreTake(csv_mutex, portMAX_DELAY) != pdTRUE) {
-        Serial.println(Mood::getInstance().getBroken() + " Handshake CSV: Could not take mutex for writing entry.");
+        LOGE("handshake", "Could not take mutex for writing entry.");
         return ESP_ERR_TIMEOUT;
     }
 
@@ -206,7 +209,7 @@ esp_err_t handshake_logger_write_entry(const char* bssid, const char* station_ma
                    String(channel);
                    
     if (current_csv_file.println(entry) == 0) {
-        Serial.println(Mood::getInstance().getBroken() + " Failed to write entry to handshake CSV file.");
+        LOGE("handshake", "Failed to write entry to handshake CSV file.");
         xSemaphoreGive(csv_mutex);
         return ESP_FAIL;
     }
@@ -214,10 +217,11 @@ esp_err_t handshake_logger_write_entry(const char* bssid, const char* station_ma
     // Flush immediately to ensure data is written to SD card
     current_csv_file.flush();
     
-    Serial.println(Mood::getInstance().getHappy() + " Recorded handshake with BSSID: " + String(bssid) + 
-                  ", SSID: " + String(found_ssid.c_str()) + ", Type: " + String(msg_type));
+    LOGI("handshake", "Recorded handshake with BSSID: %s, SSID: %s, Type: %s",
+         bssid, found_ssid.c_str(), msg_type);
       // Increment the handshake count
     handshake_count++;
+    storage_mark_handshake(); // the open capture is now kept until last
     
     // Update the global handshake count for display
     handshakeCount = handshake_count;
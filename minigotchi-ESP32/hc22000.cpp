@@ -0,0 +1,399 @@
+#include "hc22000.h"
+#include "pcap_logger.h"
+#include <Arduino.h>
+#include <SD.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+/** developer note:
+ *
+ * offsets below are from the start of the EAPOL header, the key fields of
+ * wifi_frames.h start 4 bytes in. multi-byte key fields are big endian.
+ * hashcat wants the whole M2 EAPOL frame with its MIC zeroed, the MIC goes
+ * in its own field. message pair 00 means ANonce from M1, EAPOL from M2,
+ * replay counters checked.
+ *
+ * everything up to a finished line runs in the promiscuous callback, which
+ * never waits for hc_mutex and never touches the card. finished lines wait
+ * in a small queue until hc22000_step() appends them to the file, which
+ * wifi_sniffer_start() opened. hc_file_mutex keeps step, open and close
+ * apart, the callback never takes it.
+ *
+ */
+
+#define HC_EAPOL_HDR 4
+#define HC_KEY_INFO 5
+#define HC_REPLAY 9
+#define HC_NONCE 17
+#define HC_MIC 81
+#define HC_KEY_DATA_LEN 97
+#define HC_KEY_DATA 99
+#define HC_MIC_LEN 16
+#define HC_NONCE_LEN 32
+#define HC_PMKID_LEN 16
+#define HC_LINE_MAX (64 + 2 * (HC_MIC_LEN + 12 + 32 + HC_NONCE_LEN + HC22000_MAX_EAPOL))
+
+typedef struct {
+    uint8_t bssid[6];
+    uint8_t len;            // 0 marks a free slot
+    char essid[32];
+} hc_essid_t;
+
+typedef struct {
+    uint8_t ap[6];
+    uint8_t sta[6];
+    uint64_t replay;
+    uint8_t anonce[HC_NONCE_LEN];
+    uint32_t seen_ms;
+    bool used;
+} hc_m1_t;
+
+static SemaphoreHandle_t hc_mutex = NULL;      // Tables and the queue, held for microseconds
+static SemaphoreHandle_t hc_file_mutex = NULL; // hc_file, task context only
+static hc_essid_t hc_essids[HC22000_ESSID_SLOTS];
+static hc_m1_t hc_m1s[HC22000_M1_SLOTS];
+static uint32_t hc_recent[HC22000_RECENT];
+static uint8_t hc_recent_next = 0;
+static File hc_file;
+static int hc_file_index = -1;
+static hc22000_stats_t hc_stats = {};
+static char hc_line[HC_LINE_MAX];
+static char hc_queue[HC22000_QUEUE][HC_LINE_MAX];
+static uint16_t hc_queue_len[HC22000_QUEUE];
+static uint8_t hc_queue_head = 0;
+static uint8_t hc_queue_count = 0;
+static char hc_out[HC_LINE_MAX]; // Line being written, hc_file_mutex
+
+esp_err_t hc22000_init(void) {
+    if (hc_mutex != NULL) {
+        return ESP_OK;
+    }
+    hc_file_mutex = xSemaphoreCreateMutex();
+    hc_mutex = hc_file_mutex != NULL ? xSemaphoreCreateMutex() : NULL;
+    return hc_mutex != NULL ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+static uint32_t hc_fnv(uint32_t h, const uint8_t *p, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ p[i]) * 16777619u;
+    }
+    return h;
+}
+
+static uint64_t hc_be64(const uint8_t *p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; i++) {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+static char *hc_hex(char *out, const uint8_t *p, size_t len) {
+    static const char digits[] = "0123456789abcdef";
+    for (size_t i = 0; i < len; i++) {
+        *out++ = digits[p[i] >> 4];
+        *out++ = digits[p[i] & 0x0f];
+    }
+    return out;
+}
+
+static const hc_essid_t *hc_find_essid(const uint8_t *bssid) {
+    const hc_essid_t &e = hc_essids[hc_fnv(2166136261u, bssid, 6) % HC22000_ESSID_SLOTS];
+    return e.len != 0 && memcmp(e.bssid, bssid, 6) == 0 ? &e : NULL;
+}
+
+void hc22000_note_mgmt(const uint8_t *frame, size_t len) {
+    // beacon or probe response, SSID element right after the fixed fields
+    if (hc_mutex == NULL || len < 38 || (frame[0] != 0x80 && frame[0] != 0x50) || frame[36] != 0) {
+        return;
+    }
+    uint8_t essid_len = frame[37];
+    if (essid_len == 0 || essid_len > 32 || 38u + essid_len > len || frame[38] == 0) {
+        return; // hidden network
+    }
+    const uint8_t *bssid = frame + 16;
+    hc_essid_t &e = hc_essids[hc_fnv(2166136261u, bssid, 6) % HC22000_ESSID_SLOTS];
+    if (e.len == essid_len && memcmp(e.bssid, bssid, 6) == 0 && memcmp(e.essid, frame + 38, essid_len) == 0) {
+        return;
+    }
+    if (xSemaphoreTake(hc_mutex, 0) != pdTRUE) {
+        return; // plenty more beacons where this came from
+    }
+    memcpy(e.bssid, bssid, 6);
+    memcpy(e.essid, frame + 38, essid_len);
+    e.len = essid_len;
+    xSemaphoreGive(hc_mutex);
+}
+
+/**
+ * Writes out the queued lines and flushes the file, call with hc_file_mutex held
+ */
+static void hc_drain_locked() {
+    bool wrote = false;
+    for (;;) {
+        xSemaphoreTake(hc_mutex, portMAX_DELAY);
+        size_t len = 0;
+        if (hc_queue_count > 0) {
+            len = hc_queue_len[hc_queue_head];
+            memcpy(hc_out, hc_queue[hc_queue_head], len);
+            hc_queue_head = (hc_queue_head + 1) % HC22000_QUEUE;
+            hc_queue_count--;
+        }
+        xSemaphoreGive(hc_mutex);
+        if (len == 0) {
+            break;
+        }
+        if (!hc_file || hc_file.write((const uint8_t *)hc_out, len) != len) {
+            hc_stats.write_errors++;
+            continue;
+        }
+        wrote = true;
+    }
+    if (wrote) {
+        hc_file.flush(); // few and precious, don't leave them in a buffer
+    }
+}
+
+esp_err_t hc22000_open(void) {
+    int index = pcap_logger_current_index();
+    if (hc_mutex == NULL || index < 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(hc_file_mutex, portMAX_DELAY);
+    hc_drain_locked(); // anything left belongs to the previous file
+    if (hc_file) {
+        hc_file.close();
+    }
+    char path[MAX_PCAP_FILE_NAME_LENGTH];
+    snprintf(path, sizeof(path), "%s/%s_%d%s", PCAP_DIR, PCAP_BASE_FILENAME, index, HC22000_EXT);
+    hc_file = SD.open(path, FILE_APPEND);
+    xSemaphoreTake(hc_mutex, portMAX_DELAY);
+    hc_file_index = hc_file ? index : -1;
+    memset(hc_recent, 0, sizeof(hc_recent)); // duplicates are per file
+    xSemaphoreGive(hc_mutex);
+    xSemaphoreGive(hc_file_mutex);
+    return hc_file ? ESP_OK : ESP_FAIL;
+}
+
+void hc22000_step(void) {
+    if (hc_file_mutex == NULL || hc_queue_count == 0 || xSemaphoreTake(hc_file_mutex, 0) != pdTRUE) {
+        return;
+    }
+    hc_drain_locked();
+    xSemaphoreGive(hc_file_mutex);
+}
+
+/**
+ * Queues hc_line unless the same hash went into this file already
+ */
+static void hc_emit_locked(size_t len, uint32_t key, uint32_t *counter) {
+    if (hc_file_index < 0) {
+        hc_stats.write_errors++; // the file did not open
+        return;
+    }
+    for (int i = 0; i < HC22000_RECENT; i++) {
+        if (hc_recent[i] == key) {
+            hc_stats.duplicates++;
+            return;
+        }
+    }
+    if (hc_queue_count == HC22000_QUEUE) {
+        hc_stats.queue_full++;
+        return; // not remembered, a retransmission gets another go
+    }
+    hc_line[len++] = '\n';
+    uint8_t tail = (hc_queue_head + hc_queue_count) % HC22000_QUEUE;
+    memcpy(hc_queue[tail], hc_line, len);
+    hc_queue_len[tail] = len;
+    hc_queue_count++;
+    hc_recent[hc_recent_next] = key;
+    hc_recent_next = (hc_recent_next + 1) % HC22000_RECENT;
+    (*counter)++;
+}
+
+/**
+ * Common head of both line types: WPA*<type>*<hash>*<ap>*<sta>*<essid>*
+ */
+static char *hc_head(char *p, const char *type, const uint8_t *hash, size_t hash_len,
+                     const uint8_t *ap, const uint8_t *sta, const hc_essid_t *essid) {
+    memcpy(p, "WPA*", 4);
+    p += 4;
+    memcpy(p, type, 2);
+    p += 2;
+    *p++ = '*';
+    p = hc_hex(p, hash, hash_len);
+    *p++ = '*';
+    p = hc_hex(p, ap, 6);
+    *p++ = '*';
+    p = hc_hex(p, sta, 6);
+    *p++ = '*';
+    p = hc_hex(p, (const uint8_t *)essid->essid, essid->len);
+    *p++ = '*';
+    return p;
+}
+
+/**
+ * PMKID KDE in the unencrypted key data of M1: dd 14 00 0f ac 04 <pmkid>
+ */
+static void hc_pmkid_locked(const uint8_t *ap, const uint8_t *sta, const uint8_t *eapol, size_t len) {
+    size_t data_len = (eapol[HC_KEY_DATA_LEN] << 8) | eapol[HC_KEY_DATA_LEN + 1];
+    if (HC_KEY_DATA + data_len > len) {
+        return;
+    }
+    const uint8_t *p = eapol + HC_KEY_DATA;
+    const uint8_t *end = p + data_len;
+    while (p + 2 <= end && p + 2 + p[1] <= end) {
+        if (p[0] == 0xdd && p[1] >= 4 + HC_PMKID_LEN && p[2] == 0x00 && p[3] == 0x0f &&
+            p[4] == 0xac && p[5] == 0x04) {
+            const uint8_t *pmkid = p + 6;
+            static const uint8_t zero[HC_PMKID_LEN] = {0};
+            if (memcmp(pmkid, zero, HC_PMKID_LEN) == 0) {
+                return;
+            }
+            const hc_essid_t *essid = hc_find_essid(ap);
+            if (essid == NULL) {
+                hc_stats.no_essid++;
+                return;
+            }
+            char *q = hc_head(hc_line, "01", pmkid, HC_PMKID_LEN, ap, sta, essid);
+            memcpy(q, "**", 2); // no ANonce, no EAPOL, no message pair
+            q += 2;
+            hc_emit_locked(q - hc_line, hc_fnv(2166136261u, pmkid, HC_PMKID_LEN), &hc_stats.pmkids);
+            return;
+        }
+        p += 2 + p[1];
+    }
+}
+
+static void hc_pair_locked(const uint8_t *ap, const uint8_t *sta, const uint8_t *eapol, size_t eapol_len) {
+    uint64_t replay = hc_be64(eapol + HC_REPLAY);
+    hc_m1_t *m1 = NULL;
+    for (int i = 0; i < HC22000_M1_SLOTS; i++) {
+        hc_m1_t &s = hc_m1s[i];
+        if (s.used && s.replay == replay && memcmp(s.ap, ap, 6) == 0 &&
+            memcmp(s.sta, sta, 6) == 0 && millis() - s.seen_ms <= HC22000_M1_MAX_AGE_MS) {
+            m1 = &s;
+            break;
+        }
+    }
+    if (m1 == NULL) {
+        hc_stats.unpaired++;
+        return;
+    }
+    const hc_essid_t *essid = hc_find_essid(ap);
+    if (essid == NULL) {
+        hc_stats.no_essid++;
+        return;
+    }
+
+    char *p = hc_head(hc_line, "02", eapol + HC_MIC, HC_MIC_LEN, ap, sta, essid);
+    p = hc_hex(p, m1->anonce, HC_NONCE_LEN);
+    *p++ = '*';
+    p = hc_hex(p, eapol, HC_MIC);
+    static const uint8_t zero_mic[HC_MIC_LEN] = {0};
+    p = hc_hex(p, zero_mic, HC_MIC_LEN);
+    p = hc_hex(p, eapol + HC_MIC + HC_MIC_LEN, eapol_len - HC_MIC - HC_MIC_LEN);
+    memcpy(p, "*00", 3);
+    p += 3;
+    hc_emit_locked(p - hc_line, hc_fnv(hc_fnv(2166136261u, m1->anonce, HC_NONCE_LEN), eapol + HC_MIC, HC_MIC_LEN),
+                   &hc_stats.pairs);
+}
+
+static void hc_store_m1_locked(const uint8_t *ap, const uint8_t *sta, const uint8_t *eapol) {
+    // same AP and station replaces, otherwise a free or the oldest slot
+    hc_m1_t *slot = &hc_m1s[0];
+    for (int i = 0; i < HC22000_M1_SLOTS; i++) {
+        hc_m1_t &s = hc_m1s[i];
+        if (s.used && memcmp(s.ap, ap, 6) == 0 && memcmp(s.sta, sta, 6) == 0) {
+            slot = &s;
+            break;
+        }
+        if (!s.used || (slot->used && (int32_t)(s.seen_ms - slot->seen_ms) < 0)) {
+            slot = &s;
+        }
+    }
+    memcpy(slot->ap, ap, 6);
+    memcpy(slot->sta, sta, 6);
+    slot->replay = hc_be64(eapol + HC_REPLAY);
+    memcpy(slot->anonce, eapol + HC_NONCE, HC_NONCE_LEN);
+    slot->seen_ms = millis();
+    slot->used = true;
+}
+
+void hc22000_note_eapol(const uint8_t *frame, const uint8_t *eapol, size_t len) {
+    if (hc_mutex == NULL || len < HC_KEY_DATA || eapol[1] != 0x03) {
+        return;
+    }
+    size_t eapol_len = HC_EAPOL_HDR + ((eapol[2] << 8) | eapol[3]);
+    if (eapol_len < HC_KEY_DATA || eapol_len > len) {
+        return;
+    }
+
+    // AP and station from the DS bits, frame control is little endian
+    const uint8_t *a1 = frame + 4;
+    const uint8_t *a2 = frame + 10;
+    const uint8_t *a3 = frame + 16;
+    const uint8_t *ap;
+    const uint8_t *sta;
+    uint8_t ds = frame[1] & 0x03;
+    if (ds == 0x01) {          // to DS
+        ap = a1;
+        sta = a2;
+    } else if (ds == 0x02) {   // from DS
+        ap = a2;
+        sta = a1;
+    } else if (ds == 0x00) {
+        ap = a3;
+        sta = memcmp(a2, a3, 6) == 0 ? a1 : a2;
+    } else {
+        return; // WDS
+    }
+
+    uint16_t key_info = (eapol[HC_KEY_INFO] << 8) | eapol[HC_KEY_INFO + 1];
+    bool pairwise = key_info & 0x0008;
+    bool install = key_info & 0x0040;
+    bool ack = key_info & 0x0080;
+    bool mic = key_info & 0x0100;
+    bool secure = key_info & 0x0200;
+    if (!pairwise) {
+        return;
+    }
+
+    // WiFi driver context, a hash missed here comes around with the next retry
+    if (xSemaphoreTake(hc_mutex, 0) != pdTRUE) {
+        hc_stats.busy++;
+        return;
+    }
+    if (ack && !mic) {
+        hc_store_m1_locked(ap, sta, eapol);
+        hc_pmkid_locked(ap, sta, eapol, eapol_len);
+    } else if (mic && !ack && !install && !secure && eapol_len <= HC22000_MAX_EAPOL) {
+        hc_pair_locked(ap, sta, eapol, eapol_len); // M2, M4 has secure set
+    }
+    xSemaphoreGive(hc_mutex);
+}
+
+void hc22000_close(void) {
+    if (hc_file_mutex == NULL || xSemaphoreTake(hc_file_mutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        return;
+    }
+    hc_drain_locked();
+    if (hc_file) {
+        hc_file.close();
+    }
+    xSemaphoreTake(hc_mutex, portMAX_DELAY);
+    hc_file_index = -1;
+    memset(hc_m1s, 0, sizeof(hc_m1s));
+    xSemaphoreGive(hc_mutex);
+    xSemaphoreGive(hc_file_mutex);
+}
+
+void hc22000_get_stats(hc22000_stats_t *out) { *out = hc_stats; }
+
+void hc22000_print_stats(void) {
+    hc22000_stats_t s = hc_stats;
+    Serial.printf("[HC22000] pmkid: %u, m1/m2: %u, duplicate: %u, no essid: %u, unpaired m2: %u, write errors: %u, "
+                  "queue full: %u, busy: %u\n",
+                  s.pmkids, s.pairs, s.duplicates, s.no_essid, s.unpaired, s.write_errors, s.queue_full, s.busy);
+}
@@ -0,0 +1,85 @@
+#ifndef HC22000_H
+#define HC22000_H
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * hc22000.h: hashcat 22000 lines straight from the sniffer
+ *
+ * PMKIDs are taken from the RSN key data of M1, and M1/M2 pairs with the
+ * same replay counter give the ANonce, the M2 EAPOL frame and its MIC.
+ * Each finished hash is queued and appended to <base>_<n>.22000 next to
+ * capture n by hc22000_step(), so `hashcat -m 22000` can use the file as
+ * it is. The storage manager
+ * leaves these files alone when it evicts the capture.
+ *
+ * ESSIDs are learned from beacons and probe responses, a hash for an AP
+ * never heard by name is counted and dropped.
+ */
+
+#define HC22000_EXT ".22000"
+#define HC22000_ESSID_SLOTS 64   // Recently heard APs, direct mapped
+#define HC22000_M1_SLOTS 8       // M1s waiting for their M2
+#define HC22000_M1_MAX_AGE_MS 5000
+#define HC22000_MAX_EAPOL 256    // Longest M2 kept, longer ones are not WPA2-PSK
+#define HC22000_RECENT 32        // Hashes remembered to skip retransmissions
+#define HC22000_QUEUE 4          // Finished lines waiting for hc22000_step()
+#define HC22000_STEP_MS 1000     // Scheduler period of hc22000_step()
+
+typedef struct {
+    uint32_t pmkids;        // WPA*01 lines written
+    uint32_t pairs;         // WPA*02 lines written
+    uint32_t duplicates;    // Already written to the current file
+    uint32_t no_essid;      // AP name unknown, nothing written
+    uint32_t unpaired;      // M2 with no matching M1
+    uint32_t write_errors;
+    uint32_t queue_full;    // Finished but not queued, hc22000_step() fell behind
+    uint32_t busy;          // EAPOL frames skipped while the queue was locked
+} hc22000_stats_t;
+
+/**
+ * @brief Create the mutex, call once before the sniffer starts
+ */
+esp_err_t hc22000_init(void);
+
+/**
+ * @brief Learn the ESSID from a beacon or probe response
+ *
+ * @param frame 802.11 frame starting at frame control
+ * @param len Frame length without FCS
+ */
+void hc22000_note_mgmt(const uint8_t *frame, size_t len);
+
+/**
+ * @brief Feed an EAPOL-Key frame
+ *
+ * @param frame 802.11 data frame, for the addresses
+ * @param eapol EAPOL header (version, type, length) of the same frame
+ * @param len Bytes available from eapol on
+ */
+void hc22000_note_eapol(const uint8_t *frame, const uint8_t *eapol, size_t len);
+
+/**
+ * @brief Open the hash file of the current capture
+ *
+ * Called by wifi_sniffer_start() right after the capture is opened, the
+ * callback only queues lines and never opens anything.
+ */
+esp_err_t hc22000_open(void);
+
+/**
+ * @brief Append the queued lines to the hash file, never call it from the WiFi callback
+ */
+void hc22000_step(void);
+
+/**
+ * @brief Write what is queued and close the hash file
+ */
+void hc22000_close(void);
+
+void hc22000_get_stats(hc22000_stats_t *out);
+void hc22000_print_stats(void);
+
+#endif // HC22000_H
@@ -0,0 +1,136 @@
+#include "heap_tracker.h"
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include <esp_system.h>
+#include "freertos/FreeRTOS.h"
+
+static heap_tag_stats_t heap_tags[HEAP_TAG_COUNT];
+static portMUX_TYPE heap_tags_mutex = portMUX_INITIALIZER_UNLOCKED;
+
+static const char *const heap_tag_names[HEAP_TAG_COUNT] = {
+    "sniffer", "pcap", "frame", "display", "webui", "json", "storage"};
+
+static void heap_track_charge(heap_tag_t tag, size_t size) {
+    portENTER_CRITICAL(&heap_tags_mutex);
+    heap_tag_stats_t &t = heap_tags[tag];
+    t.allocs++;
+    t.live_bytes += size;
+    if (t.live_bytes > t.peak_bytes) {
+        t.peak_bytes = t.live_bytes;
+    }
+    portEXIT_CRITICAL(&heap_tags_mutex);
+}
+
+static void heap_track_release(heap_tag_t tag, size_t size) {
+    portENTER_CRITICAL(&heap_tags_mutex);
+    heap_tag_stats_t &t = heap_tags[tag];
+    t.frees++;
+    t.live_bytes = t.live_bytes > size ? t.live_bytes - size : 0;
+    portEXIT_CRITICAL(&heap_tags_mutex);
+}
+
+static void heap_track_failed(heap_tag_t tag, uint32_t caps) {
+    // walking the heap is slow, only do it when something went wrong
+    size_t largest = heap_caps_get_largest_free_block(caps);
+    portENTER_CRITICAL(&heap_tags_mutex);
+    heap_tags[tag].failures++;
+    heap_tags[tag].failed_largest = largest;
+    portEXIT_CRITICAL(&heap_tags_mutex);
+}
+
+void *heap_track_malloc(heap_tag_t tag, size_t size, uint32_t caps) {
+    void *ptr = heap_caps_malloc(size, caps);
+    if (ptr == NULL) {
+        heap_track_failed(tag, caps);
+        return NULL;
+    }
+    heap_track_charge(tag, heap_caps_get_allocated_size(ptr));
+    return ptr;
+}
+
+void *heap_track_calloc(heap_tag_t tag, size_t count, size_t size, uint32_t caps) {
+    void *ptr = heap_caps_calloc(count, size, caps);
+    if (ptr == NULL) {
+        heap_track_failed(tag, caps);
+        return NULL;
+    }
+    heap_track_charge(tag, heap_caps_get_allocated_size(ptr));
+    return ptr;
+}
+
+void *heap_track_realloc(heap_tag_t tag, void *ptr, size_t size, uint32_t caps) {
+    size_t old_size = ptr ? heap_caps_get_allocated_size(ptr) : 0;
+    void *grown = heap_caps_realloc(ptr, size, caps);
+    if (grown == NULL) {
+        if (size > 0) {
+            heap_track_failed(tag, caps);
+        }
+        return NULL;
+    }
+    if (ptr != NULL) {
+        heap_track_release(tag, old_size);
+    }
+    heap_track_charge(tag, heap_caps_get_allocated_size(grown));
+    return grown;
+}
+
+void heap_track_free(heap_tag_t tag, void *ptr) {
+    if (ptr == NULL) {
+        return;
+    }
+    heap_track_release(tag, heap_caps_get_allocated_size(ptr));
+    heap_caps_free(ptr);
+}
+
+void heap_track_note(heap_tag_t tag, size_t free_before) {
+    int32_t drop = (int32_t)free_before - (int32_t)esp_get_free_heap_size();
+    portENTER_CRITICAL(&heap_tags_mutex);
+    heap_tags[tag].sampled_bytes += drop;
+    portEXIT_CRITICAL(&heap_tags_mutex);
+}
+
+void heap_track_get(heap_tag_t tag, heap_tag_stats_t *out) {
+    portENTER_CRITICAL(&heap_tags_mutex);
+    *out = heap_tags[tag];
+    portEXIT_CRITICAL(&heap_tags_mutex);
+}
+
+const char *heap_track_name(heap_tag_t tag) {
+    return tag < HEAP_TAG_COUNT ? heap_tag_names[tag] : "?";
+}
+
+void heap_track_dump() {
+    size_t free_now = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    size_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    Serial.printf("[HEAP] free: %u, min free: %u, largest block: %u, fragmentation: %u%%\n",
+                  (unsigned)free_now, (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT),
+                  (unsigned)largest, free_now ? (unsigned)(100 - largest * 100 / free_now) : 0);
+    Serial.println("[HEAP] tag       allocs  frees  fails   live   peak  sampled");
+    for (int i = 0; i < HEAP_TAG_COUNT; i++) {
+        heap_tag_stats_t t;
+        heap_track_get((heap_tag_t)i, &t);
+        Serial.printf("[HEAP] %-8s %7u %6u %6u %6u %6u %8d", heap_tag_names[i],
+                      t.allocs, t.frees, t.failures, t.live_bytes, t.peak_bytes,
+                      t.sampled_bytes);
+        if (t.failures > 0) {
+            Serial.printf("  (largest block at last failure: %u)", t.failed_largest);
+        }
+        Serial.println();
+    }
+}
+
+class HeapJsonAllocator : public ArduinoJson::Allocator {
+public:
+    void *allocate(size_t size) override {
+        return heap_track_malloc(HEAP_TAG_JSON, size, MALLOC_CAP_8BIT);
+    }
+    void deallocate(void *ptr) override { heap_track_free(HEAP_TAG_JSON, ptr); }
+    void *reallocate(void *ptr, size_t new_size) override {
+        return heap_track_realloc(HEAP_TAG_JSON, ptr, new_size, MALLOC_CAP_8BIT);
+    }
+};
+
+ArduinoJson::Allocator *heap_json_allocator() {
+    static HeapJsonAllocator allocator;
+    return &allocator;
+}
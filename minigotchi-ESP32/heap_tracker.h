@@ -0,0 +1,96 @@
+#ifndef HEAP_TRACKER_H
+#define HEAP_TRACKER_H
+
+#include <ArduinoJson.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * heap_tracker.h: heap allocation accounting per subsystem
+ *
+ * Allocations made through heap_track_* are counted against a tag with
+ * their real block size. Subsystems whose memory is allocated inside
+ * libraries (WiFi driver, SD, web server) record the free heap drop around
+ * their setup calls with heap_track_note() instead, shown as "sampled".
+ */
+
+typedef enum {
+    HEAP_TAG_SNIFFER,
+    HEAP_TAG_PCAP,
+    HEAP_TAG_FRAME,
+    HEAP_TAG_DISPLAY,
+    HEAP_TAG_WEBUI,
+    HEAP_TAG_JSON,
+    HEAP_TAG_STORAGE,
+    HEAP_TAG_COUNT
+} heap_tag_t;
+
+typedef struct {
+    uint32_t allocs;         // Successful allocations
+    uint32_t frees;          // Blocks handed back
+    uint32_t failures;       // Allocations that returned NULL
+    uint32_t live_bytes;     // Bytes currently held
+    uint32_t peak_bytes;     // Highest live_bytes seen
+    uint32_t failed_largest; // Largest free block when the last failure happened
+    int32_t sampled_bytes;   // Free heap drop recorded with heap_track_note()
+} heap_tag_stats_t;
+
+/**
+ * @brief Allocate memory counted against a subsystem
+ *
+ * @param tag Subsystem to charge
+ * @param size Bytes to allocate
+ * @param caps heap_caps capabilities, e.g. MALLOC_CAP_8BIT
+ * @return The block, NULL on failure
+ */
+void *heap_track_malloc(heap_tag_t tag, size_t size, uint32_t caps);
+
+/**
+ * @brief Allocate zeroed memory counted against a subsystem
+ */
+void *heap_track_calloc(heap_tag_t tag, size_t count, size_t size, uint32_t caps);
+
+/**
+ * @brief Resize a block allocated with heap_track_malloc()
+ */
+void *heap_track_realloc(heap_tag_t tag, void *ptr, size_t size, uint32_t caps);
+
+/**
+ * @brief Free a block allocated with heap_track_*(), NULL is ignored
+ *
+ * @param tag Subsystem the block was charged to
+ * @param ptr Block to free
+ */
+void heap_track_free(heap_tag_t tag, void *ptr);
+
+/**
+ * @brief Charge a subsystem with the free heap drop since free_before
+ *
+ * Approximate, other tasks allocating in the same window are charged too.
+ *
+ * @param tag Subsystem to charge
+ * @param free_before esp_get_free_heap_size() taken before the call
+ */
+void heap_track_note(heap_tag_t tag, size_t free_before);
+
+/**
+ * @brief Copy the counters of a subsystem
+ */
+void heap_track_get(heap_tag_t tag, heap_tag_stats_t *out);
+
+/**
+ * @brief Name of a subsystem tag
+ */
+const char *heap_track_name(heap_tag_t tag);
+
+/**
+ * @brief Print every subsystem plus free, minimum and largest free block
+ */
+void heap_track_dump();
+
+/**
+ * @brief ArduinoJson allocator charging HEAP_TAG_JSON, pass to JsonDocument
+ */
+ArduinoJson::Allocator *heap_json_allocator();
+
+#endif // HEAP_TRACKER_H
@@ -0,0 +1,153 @@
+#include "logger.h"
+#include "task_manager.h"
+#include <Arduino.h>
+#include <atomic>
+#include <esp_timer.h>
+#include <stdarg.h>
+#include <stdio.h>
+
+/** developer note:
+ *
+ * the ring is a bounded multi-producer queue: every slot carries a sequence
+ * number, producers claim a slot with a compare-and-swap on the head and
+ * publish it by bumping the slot sequence, the drain task frees it the same
+ * way. nobody ever waits on a lock, a producer that finds the ring full
+ * just counts a drop and returns.
+ *
+ */
+
+typedef struct {
+    std::atomic<uint32_t> seq;
+    uint32_t timestamp_ms;
+    const char *tag;
+    uint8_t level;
+    char message[LOGGER_MESSAGE_SIZE];
+} logger_slot_t;
+
+static logger_slot_t logger_ring[LOGGER_SLOT_COUNT];
+static std::atomic<uint32_t> logger_head(0);
+static uint32_t logger_tail = 0; // Only touched by the drain task
+static std::atomic<bool> logger_ring_ready(false);
+
+static std::atomic<uint32_t> logger_written(0);
+static std::atomic<uint32_t> logger_dropped(0);
+static std::atomic<uint32_t> logger_truncated(0);
+static uint32_t logger_drained = 0;
+static uint64_t logger_uart_us = 0;
+static TaskHandle_t logger_task_handle = NULL;
+
+static const char logger_level_chars[] = {'-', 'E', 'W', 'I', 'D'};
+
+static void logger_ring_init() {
+    static portMUX_TYPE init_mutex = portMUX_INITIALIZER_UNLOCKED;
+    portENTER_CRITICAL(&init_mutex);
+    if (!logger_ring_ready.load(std::memory_order_relaxed)) {
+        for (uint32_t i = 0; i < LOGGER_SLOT_COUNT; i++) {
+            logger_ring[i].seq.store(i, std::memory_order_relaxed);
+        }
+        logger_ring_ready.store(true, std::memory_order_release);
+    }
+    portEXIT_CRITICAL(&init_mutex);
+}
+
+void logger_write(uint8_t level, const char *tag, const char *fmt, ...) {
+    if (!logger_ring_ready.load(std::memory_order_acquire)) {
+        logger_ring_init();
+    }
+
+    uint32_t pos = logger_head.load(std::memory_order_relaxed);
+    logger_slot_t *slot;
+    for (;;) {
+        slot = &logger_ring[pos & (LOGGER_SLOT_COUNT - 1)];
+        int32_t diff = (int32_t)(slot->seq.load(std::memory_order_acquire) - pos);
+        if (diff == 0) {
+            if (logger_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // Drain task is a full lap behind
+            logger_dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            pos = logger_head.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->timestamp_ms = millis();
+    slot->tag = tag;
+    slot->level = level;
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(slot->message, LOGGER_MESSAGE_SIZE, fmt, args);
+    va_end(args);
+    if (len >= LOGGER_MESSAGE_SIZE) {
+        logger_truncated.fetch_add(1, std::memory_order_relaxed);
+    }
+    slot->seq.store(pos + 1, std::memory_order_release);
+    logger_written.fetch_add(1, std::memory_order_relaxed);
+
+    if (logger_task_handle != NULL) {
+        xTaskNotifyGive(logger_task_handle);
+    }
+}
+
+static void logger_task(void *pvParameters) {
+    char line[LOGGER_MESSAGE_SIZE + 32];
+    for (;;) {
+        logger_slot_t *slot = &logger_ring[logger_tail & (LOGGER_SLOT_COUNT - 1)];
+        if (slot->seq.load(std::memory_order_acquire) != logger_tail + 1) {
+            // Empty, the timeout also covers a producer preempted mid-write
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+            continue;
+        }
+
+        uint8_t level = slot->level < sizeof(logger_level_chars) ? slot->level : 0;
+        int len = snprintf(line, sizeof(line), "[%lu][%c][%s] %s\n",
+                           (unsigned long)slot->timestamp_ms, logger_level_chars[level],
+                           slot->tag ? slot->tag : "?", slot->message);
+        slot->seq.store(logger_tail + LOGGER_SLOT_COUNT, std::memory_order_release);
+        logger_tail++;
+
+        if (len > (int)sizeof(line) - 1) {
+            len = sizeof(line) - 1;
+        }
+        int64_t start = esp_timer_get_time();
+        Serial.write((const uint8_t *)line, len);
+        logger_uart_us += esp_timer_get_time() - start;
+        logger_drained++;
+    }
+}
+
+esp_err_t logger_init() {
+    if (!logger_ring_ready.load(std::memory_order_acquire)) {
+        logger_ring_init();
+    }
+    if (logger_task_handle != NULL) {
+        return ESP_OK;
+    }
+    task_id_t id = TaskManager::getInstance().createTask("log_task", logger_task, 3072, 1, NULL, 1);
+    if (id == TASK_ID_INVALID) {
+        Serial.println("[LOGGER] Failed to create log task, messages stay queued");
+        return ESP_FAIL;
+    }
+    logger_task_handle = TaskManager::getInstance().getTaskHandle(id);
+    return ESP_OK;
+}
+
+void logger_get_stats(logger_stats_t *out) {
+    out->written = logger_written.load(std::memory_order_relaxed);
+    out->dropped = logger_dropped.load(std::memory_order_relaxed);
+    out->truncated = logger_truncated.load(std::memory_order_relaxed);
+    out->drained = logger_drained;
+    out->uart_us = logger_uart_us;
+}
+
+void logger_print_stats() {
+    logger_stats_t stats;
+    logger_get_stats(&stats);
+    // UART time of queued messages was paid by the drain task, not the caller
+    Serial.printf("[LOGGER] queued: %u, dropped: %u, truncated: %u, drained: %u, "
+                  "UART time off callers: %llu ms\n",
+                  stats.written, stats.dropped, stats.truncated, stats.drained,
+                  stats.uart_us / 1000);
+}
@@ -0,0 +1,94 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include "esp_err.h"
+#include <stdint.h>
+
+/**
+ * logger.h: leveled, tagged logging through a lock-free ring drained by a
+ * low priority task
+ *
+ * LOGE/LOGW/LOGI/LOGD format into a ring slot on the calling task and never
+ * touch the heap or the UART. Calls above LOGGER_LEVEL compile to nothing,
+ * arguments included. When the ring is full the message is dropped and
+ * counted instead of blocking the caller. Not for use from ISRs.
+ */
+
+#define LOGGER_LEVEL_NONE 0
+#define LOGGER_LEVEL_ERROR 1
+#define LOGGER_LEVEL_WARN 2
+#define LOGGER_LEVEL_INFO 3
+#define LOGGER_LEVEL_DEBUG 4
+
+// compile time threshold, override with -DLOGGER_LEVEL=...
+#ifndef LOGGER_LEVEL
+#define LOGGER_LEVEL LOGGER_LEVEL_INFO
+#endif
+
+#define LOGGER_SLOT_COUNT 32  // Must be a power of two
+#define LOGGER_MESSAGE_SIZE 120
+
+#if LOGGER_LEVEL >= LOGGER_LEVEL_ERROR
+#define LOGE(tag, fmt, ...) logger_write(LOGGER_LEVEL_ERROR, tag, fmt, ##__VA_ARGS__)
+#else
+#define LOGE(tag, fmt, ...) do {} while (0)
+#endif
+
+#if LOGGER_LEVEL >= LOGGER_LEVEL_WARN
+#define LOGW(tag, fmt, ...) logger_write(LOGGER_LEVEL_WARN, tag, fmt, ##__VA_ARGS__)
+#else
+#define LOGW(tag, fmt, ...) do {} while (0)
+#endif
+
+#if LOGGER_LEVEL >= LOGGER_LEVEL_INFO
+#define LOGI(tag, fmt, ...) logger_write(LOGGER_LEVEL_INFO, tag, fmt, ##__VA_ARGS__)
+#else
+#define LOGI(tag, fmt, ...) do {} while (0)
+#endif
+
+#if LOGGER_LEVEL >= LOGGER_LEVEL_DEBUG
+#define LOGD(tag, fmt, ...) logger_write(LOGGER_LEVEL_DEBUG, tag, fmt, ##__VA_ARGS__)
+#else
+#define LOGD(tag, fmt, ...) do {} while (0)
+#endif
+
+typedef struct {
+    uint32_t written;     // Messages queued
+    uint32_t dropped;     // Messages lost because the ring was full
+    uint32_t truncated;   // Messages cut to LOGGER_MESSAGE_SIZE
+    uint32_t drained;     // Messages written to the UART
+    uint64_t uart_us;     // Time the drain task spent blocked on the UART
+} logger_stats_t;
+
+/**
+ * @brief Start the drain task
+ *
+ * Messages logged before this are kept in the ring until the task starts.
+ *
+ * @return ESP_OK if the task is running
+ */
+esp_err_t logger_init();
+
+/**
+ * @brief Format a message into the ring, use the LOG* macros instead
+ *
+ * @param level One of LOGGER_LEVEL_*
+ * @param tag Module tag, must outlive the message (string literal)
+ * @param fmt printf style format
+ */
+void logger_write(uint8_t level, const char *tag, const char *fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+
+/**
+ * @brief Copy the current counters
+ *
+ * @param out Where to store the counters
+ */
+void logger_get_stats(logger_stats_t *out);
+
+/**
+ * @brief Print the counters to serial
+ */
+void logger_print_stats();
+
+#endif // LOGGER_H
@@ -29,10 +29,23 @@
 #include "channel_hopper.h" // Include the channel hopper header
 #include "wifi_manager.h" // Include the WiFi Manager
 #include <nvs_flash.h> // Include for NVS functions
+#include "logger.h" // Buffered serial logging
+#include "heap_tracker.h" // Per-subsystem heap accounting
+#include "telemetry.h" // Periodic heap/task/WiFi sampler
+#include "task_manager.h" // Managed task table
+#include "scheduler.h" // Deadline driven activities
+#include "pcap_logger.h" // Capture write counters
+#include "storage_manager.h" // SD quota and background gzip
+#include "hc22000.h" // Hash export counters and writer
+#include "pcap_index.h" // Capture sidecar index
+#include "sd_repair.h" // Newest capture lookup
+#include "whitelist.h" // Compiled whitelist counters
+#include "web_stats.h" // Snapshot behind the web UI /stats
 
 // Status display variables
-unsigned long lastStatsUpdate = 0;
 const unsigned long STATS_UPDATE_INTERVAL = 10000; // 10 seconds
+const unsigned long EPOCH_INTERVAL = 30000; // 30 seconds
+const unsigned long DETECT_INTERVAL = 1000; // passive window is checked inside
 bool sniffer_active = false;
 
 // Serial command buffer
@@ -42,6 +55,10 @@ bool commandMode = false;
 // Arduino required setup function - runs once at startup
 void setup() {
   Serial.begin(115200);
+  logger_init();
+  // sample from the start, so the setup portal's /telemetry and the early
+  // command mode have something to show
+  telemetry_init();
 
   // Normal boot procedure (which includes Mood::init())
   Minigotchi::boot();         // MOVED EARLIER
@@ -60,6 +77,7 @@ void setup() {
         commandMode = true;
         Serial.println("\n*** COMMAND MODE ACTIVATED ***");
         Serial.println("Type 'reset' to reset device configuration");
+        Serial.println("Type 'heap' to dump heap usage per subsystem");
         Serial.println("Type 'exit' to continue normal boot");
         break;
       }
@@ -92,6 +110,100 @@ void setup() {
   
   // Start the WiFi sniffer automatically at boot
   sniffer_active = (wifi_sniffer_start() == ESP_OK);
+  if (!sniffer_active) {
+    Minigotchi::getMood().post(MOOD_EVENT_ERROR);
+  }
+
+  scheduleActivities();
+}
+
+// Recon hop, the hopper task already hops while the sniffer runs and the
+// download access point has to stay on its channel
+void reconActivity() {
+  if (channel_hopping_task_handle == NULL && !WebUI::downloading) {
+    Minigotchi::cycle();
+  }
+}
+
+// Peer detection, the active sweep would take the radio off the download AP
+void detectActivity() {
+  if (!WebUI::downloading) {
+    Minigotchi::detect();
+  }
+}
+
+// Only advertise if sniffer is running (prevents WiFi state confusion)
+void advertiseActivity() {
+  if (sniffer_active && is_sniffer_running()) {
+    Minigotchi::advertise();
+  } else {
+    LOGD("loop", "Skipping advertise() (sniffer not active)");
+  }
+}
+
+// Channel hopping stats display
+void statsActivity() {
+  if (sniffer_active && is_sniffer_running() && channel_hopping_task_handle != NULL) {
+    int currentChannel = Channel::getChannel();
+    uint32_t successful_hops = get_successful_channel_hops();
+    uint32_t failed_hops = get_failed_channel_hops();
+    uint32_t hop_interval = get_channel_hop_interval_ms();
+    float success_rate = 0;
+    if (successful_hops + failed_hops > 0) {
+      success_rate = (float)successful_hops / (successful_hops + failed_hops) * 100.0;
+    }
+    Serial.printf("%s CH:%d | Hop Stats: %d OK, %d Fail (%.1f%%), Interval: %dms\n", 
+                 Minigotchi::getMood().getNeutral().c_str(),
+                 currentChannel,
+                 successful_hops, 
+                 failed_hops,
+                 success_rate,
+                 hop_interval);
+    char stats_buf[64];
+    snprintf(stats_buf, sizeof(stats_buf), "CH:%d | %.1f%% hop success", 
+            currentChannel, success_rate);
+    Display::updateDisplay(Minigotchi::getMood().getNeutral(), stats_buf);
+  }
+  logger_print_stats();
+  if (sniffer_active) {
+    pcap_logger_print_stats();
+    hc22000_print_stats();
+  }
+  if (Config::parasite) {
+    parasite_stats_t ps;
+    Parasite::getStats(&ps);
+    Serial.printf("[PARASITE] rx: %u ok, %u bad checksum, %u malformed, %u unknown, worst latency %u us | tx: %u msgs in %u writes, %u dropped\n",
+                  ps.frames, ps.badChecksum, ps.overflows, ps.unknown, ps.maxLatencyUs,
+                  ps.txMessages, ps.txBatches, ps.txDropped);
+  }
+}
+
+// Bounds capture loss on power cuts while no frames arrive to trigger it
+void checkpointActivity() {
+  pcap_logger_checkpoint();
+}
+
+// Periods come from the pwnagotchi personality: hop_recon_time per channel,
+// recon_time between advertising bursts, min_recon_time as the floor
+void scheduleActivities() {
+  int rate = constrain(Config::advertiseRate, 1, 100);
+  uint32_t advertiseBudget = (Config::advertiseBurst * 1000) / rate + 1000;
+
+  sched_set_min_recon(Config::min_recon_time * 1000UL);
+  int failed = 0;
+  failed += sched_add("recon", reconActivity, Config::hop_recon_time * 1000UL, 500, false) < 0;
+  failed += sched_add("detect", detectActivity, DETECT_INTERVAL, 200, false) < 0;
+  failed += sched_add("advertise", advertiseActivity, Config::recon_time * 1000UL, advertiseBudget, true) < 0;
+  failed += sched_add("epoch", Minigotchi::epoch, EPOCH_INTERVAL, 200, false) < 0;
+  failed += sched_add("stats", statsActivity, STATS_UPDATE_INTERVAL, 100, false) < 0;
+  failed += sched_add("checkpoint", checkpointActivity, PCAP_CHECKPOINT_MS, 200, false) < 0;
+  failed += sched_add("storage", storage_step, STORAGE_STEP_MS, 200, false) < 0;
+  failed += sched_add("hashes", hc22000_step, HC22000_STEP_MS, 100, false) < 0;
+  failed += sched_add("webstats", web_stats_refresh, WEB_STATS_INTERVAL_MS, 100, false) < 0;
+  if (failed > 0) {
+    Serial.printf("%s %d activities could not be scheduled, raise SCHED_MAX_ACTIVITIES\n",
+                  Minigotchi::getMood().getBroken().c_str(), failed);
+  }
 }
 
 // Process command from serial
@@ -101,11 +213,17 @@ void processCommand(String command) {
   
   if (command == "reset") {
     resetConfiguration();
+  } else if (command == "heap") {
+    heap_track_dump();
+  } else if (command == "telemetry") {
+    telemetry_print(Serial);
+  } else if (command == "tasks") {
+    TaskManager::getInstance().printTaskStats();
   } else if (command == "exit") {
     Serial.println("Exiting command mode, continuing normal boot...");
     commandMode = false;
   } else {
-    Serial.println("Unknown command. Available commands: reset, exit");
+    Serial.println("Unknown command. Available commands: reset, heap, telemetry, tasks, exit");
   }
 }
 
@@ -144,21 +262,9 @@ void resetConfiguration() {
 
 // Arduino required loop function - runs repeatedly
 void loop() {
-  Serial.println("[MAINLOOP] Heartbeat: Entry");
-  // Print heap and stack diagnostics
-  Serial.printf("[MAINLOOP] Free heap: %d\n", ESP.getFreeHeap());
-  UBaseType_t stackHighWaterMark = uxTaskGetStackHighWaterMark(NULL);
-  Serial.printf("[MAINLOOP] Stack high water mark: %u\n", stackHighWaterMark);
-  // Print FreeRTOS task list
-  char *taskListBuf = (char*)malloc(1024);
-  if (taskListBuf) {
-    vTaskList(taskListBuf);
-    Serial.println("[MAINLOOP] FreeRTOS task list:");
-    Serial.println(taskListBuf);
-    free(taskListBuf);
-  }
-
-  Serial.println("[loop] Entry");
+  // heap, stack and task diagnostics come from the telemetry sampler,
+  // type 'telemetry' to see them
+  LOGD("loop", "Entry");
   // Handle serial commands in normal operation mode
   if (Serial.available()) {
     char c = Serial.read();
@@ -169,68 +275,36 @@ void loop() {
     } else if (c == '\n' || c == '\r') {
       if (serialBuffer.startsWith("reset")) {
         resetConfiguration();
+      } else if (serialBuffer.startsWith("heap")) {
+        heap_track_dump();
+      } else if (serialBuffer.startsWith("telemetry")) {
+        telemetry_print(Serial);
+      } else if (serialBuffer.startsWith("tasks")) {
+        TaskManager::getInstance().printTaskStats();
+      } else if (serialBuffer.startsWith("sched")) {
+        sched_print_stats();
+      } else if (serialBuffer.startsWith("storage")) {
+        storage_print_stats();
+      } else if (serialBuffer.startsWith("pcapidx")) {
+        // pcapidx [n], index lookup against a full scan, newest capture by default
+        String arg = serialBuffer.substring(7);
+        arg.trim();
+        pcap_index_bench(arg.length() ? arg.toInt() : sd_latest_index(PCAP_DIR, PCAP_BASE_FILENAME));
+      } else if (serialBuffer.startsWith("whitelist")) {
+        whitelist_print();
+      } else if (serialBuffer.startsWith("download")) {
+        toggleDownloads();
       }
       serialBuffer = "";
     } else {
       serialBuffer += c;
     }
   }
-  Serial.println("[loop] Before Minigotchi::cycle()");
-  Minigotchi::cycle();
-  yield();
-  Serial.println("[loop] After Minigotchi::cycle(), before Minigotchi::detect()");
-  Minigotchi::detect();
-  yield();
-  Serial.println("[loop] After Minigotchi::detect(), before Minigotchi::advertise()");
-  // Only advertise if sniffer is running (prevents WiFi state confusion)
-  if (sniffer_active && is_sniffer_running()) {
-    Minigotchi::advertise();
-    yield();
-    Serial.println("[loop] After Minigotchi::advertise()");
-  } else {
-    Serial.println("[loop] Skipping advertise() (sniffer not active)");
-  }
-
-  // Regular epoch update
-  static unsigned long lastEpochUpdate = 0;
-  if (millis() - lastEpochUpdate > 30000) {
-    Minigotchi::epoch();
-    lastEpochUpdate = millis();
-    yield();
-  }
-
-  // Channel hopping stats display
-  unsigned long currentMillis = millis();
-  if (currentMillis - lastStatsUpdate > STATS_UPDATE_INTERVAL) {
-    lastStatsUpdate = currentMillis;
-    if (sniffer_active && is_sniffer_running() && channel_hopping_task_handle != NULL) {
-      int currentChannel = Channel::getChannel();
-      uint32_t successful_hops = get_successful_channel_hops();
-      uint32_t failed_hops = get_failed_channel_hops();
-      uint32_t hop_interval = get_channel_hop_interval_ms();
-      float success_rate = 0;
-      if (successful_hops + failed_hops > 0) {
-        success_rate = (float)successful_hops / (successful_hops + failed_hops) * 100.0;
-      }
-      Serial.printf("%s CH:%d | Hop Stats: %d OK, %d Fail (%.1f%%), Interval: %dms\n", 
-                   Minigotchi::getMood().getNeutral().c_str(),
-                   currentChannel,
-                   successful_hops, 
-                   failed_hops,
-                   success_rate,
-                   hop_interval);
-      char stats_buf[64];
-      snprintf(stats_buf, sizeof(stats_buf), "CH:%d | %.1f%% hop success", 
-              currentChannel, success_rate);
-      Display::updateDisplay(Minigotchi::getMood().getNeutral(), stats_buf);
-    }
-    yield();
-  }
+  Parasite::readData();
+  uint32_t idle = sched_run_once();
 
-  Serial.println("[loop] End");
-  Serial.println("[MAINLOOP] Heartbeat: End");
-  delay(100); // Always delay to feed watchdog
-  yield();
+  LOGD("loop", "End");
+  delay(idle > 0 ? idle : 1); // Always delay to feed watchdog
 }
 
 // Toggle WiFi sniffer state
@@ -251,3 +325,23 @@ void toggleSniffer() {
   }
   delay(1000); // Show status message before returning to normal display
 }
+
+// Toggle download mode: the sniffer stops and the web UI comes up on the
+// configured access point so captures can be fetched, then capture resumes
+void toggleDownloads() {
+  if (WebUI::downloading) {
+    WebUI::stopDownloads();
+    sniffer_active = (wifi_sniffer_start() == ESP_OK);
+    if (!sniffer_active) {
+      Display::updateDisplay(Minigotchi::getMood().getBroken(), "Sniffer start failed");
+    }
+    return;
+  }
+  if (is_sniffer_running()) {
+    wifi_sniffer_stop();
+  }
+  sniffer_active = false;
+  if (!WebUI::startDownloads()) {
+    sniffer_active = (wifi_sniffer_start() == ESP_OK);
+  }
+}
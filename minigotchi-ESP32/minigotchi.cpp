@@ -14,15 +14,21 @@
 #include "parasite.h"
 // #include "ble.h" // BLE functionality removed
 #include "webui.h"
+#include "web_stats.h"
 #include "AXP192.h"
 #include "wifi_manager.h"
+#include "display_variables.h"
+#include "heap_tracker.h"
 
 #include <SPI.h>
 #include <SD.h>
 #include "pcap_logger.h"
 #include "handshake_logger.h" // Added to resolve missing declarations
+#include "sd_repair.h"
 #include "wifi_sniffer.h" // <-- NEW INCLUDE
 #include <WiFi.h> // Include WiFi.h for WiFi.mode() calls
+#include <freertos/event_groups.h>
+#include <nvs_flash.h>
 
 
 #ifndef SD_CS_PIN
@@ -34,8 +40,107 @@
 WebUI *Minigotchi::web = nullptr;
 int Minigotchi::currentEpoch = 0;
 
+/** developer note:
+ *
+ * boot used to run display, nvs, config and sd one after another with a
+ * greeting delay in between. with Config::fastBoot the cosmetic waits and
+ * self-tests are skipped and nvs/config comes up on its own task while the
+ * display initializes and greets. the sd card is still mounted from the boot
+ * task, once the render task went idle, since tft screens can share its spi
+ * bus. every phase is timed and the timeline is
+ * printed at the end of boot so startup regressions show up in the log.
+ *
+ */
+
+#define BOOT_MAX_PHASES 16
+#define BOOT_NVS_DONE BIT0
+#define BOOT_DISPLAY_IDLE_MS 2000 // Longest wait for the greeting to be drawn
+
+typedef struct {
+  const char *name;
+  uint32_t start_ms;
+  uint32_t end_ms;
+} boot_phase_t;
+
+static boot_phase_t boot_phases[BOOT_MAX_PHASES];
+static int boot_phase_count = 0;
+static portMUX_TYPE boot_phase_mutex = portMUX_INITIALIZER_UNLOCKED;
+static EventGroupHandle_t boot_events = NULL;
+static bool boot_sd_ok = false;
+
+/**
+ * Starts timing a boot phase
+ * @param name Phase name, must be a string literal
+ * @return Slot to pass to boot_phase_end(), -1 if the timeline is full
+ */
+static int boot_phase_begin(const char *name) {
+  portENTER_CRITICAL(&boot_phase_mutex);
+  int slot = boot_phase_count < BOOT_MAX_PHASES ? boot_phase_count++ : -1;
+  portEXIT_CRITICAL(&boot_phase_mutex);
+  if (slot >= 0) {
+    boot_phases[slot] = {name, millis(), 0};
+  }
+  return slot;
+}
+
+/**
+ * Stops timing a boot phase
+ * @param slot Slot returned by boot_phase_begin()
+ */
+static void boot_phase_end(int slot) {
+  if (slot >= 0) {
+    boot_phases[slot].end_ms = millis();
+  }
+}
+
+/**
+ * Prints every recorded boot phase, times are ms since power on
+ */
+static void boot_print_timeline() {
+  Serial.println("[BOOT] phase                start    end  took(ms)");
+  for (int i = 0; i < boot_phase_count; i++) {
+    Serial.printf("[BOOT] %-20s %6u %6u %6u\n", boot_phases[i].name,
+                  boot_phases[i].start_ms, boot_phases[i].end_ms,
+                  boot_phases[i].end_ms - boot_phases[i].start_ms);
+  }
+}
+
+/**
+ * Brings up NVS and loads the configuration
+ */
+static void boot_nvs() {
+  int phase = boot_phase_begin("nvs+config");
+  esp_err_t err = nvs_flash_init();
+  if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+    ESP_ERROR_CHECK(nvs_flash_erase());
+    err = nvs_flash_init();
+  }
+  ESP_ERROR_CHECK(err);
+
+  Config::loadConfig(); // Load configuration (sets Config::configured)
+  boot_phase_end(phase);
+}
+
+/**
+ * Mounts the SD card
+ */
+static void boot_sd() {
+  int phase = boot_phase_begin("sd mount");
+  Serial.println(Mood::getInstance().getNeutral() + " Initializing SD card...");
+  boot_sd_ok = SD.begin(SD_CS_PIN);
+  boot_phase_end(phase);
+}
+
+static void boot_nvs_task(void *pvParameters) {
+  boot_nvs();
+  xEventGroupSetBits(boot_events, BOOT_NVS_DONE);
+  vTaskDelete(NULL);
+}
+
 void Minigotchi::WebUITask(void *pvParameters) {
+  size_t heap_before = esp_get_free_heap_size();
   WebUI web_ui_obj;
+  heap_track_note(HEAP_TAG_WEBUI, heap_before);
   if (!WebUI::running) {
       Serial.println(Mood::getInstance().getBroken() + " WebUI failed to initialize properly in constructor!");
       vTaskDelete(NULL);
@@ -44,7 +149,8 @@ void Minigotchi::WebUITask(void *pvParameters) {
   Serial.println(Mood::getInstance().getNeutral() + " WebUITask: WebUI object created/accessible, entering wait loop.");
   while (!Config::configured) {
     WebUI::processDNS();
-    taskYIELD();
+    web_stats_refresh(); // the scheduler isn't running yet, /stats is fed from here
+    vTaskDelay(pdMS_TO_TICKS(10));
   }
   Serial.println(Mood::getInstance().getHappy() + " WebUITask: Config::configured is true. Cleaning up WebUI.");
   // Destructor for web_ui_obj will be called when task exits.
@@ -68,14 +174,22 @@ int Minigotchi::addEpoch() {
 void Minigotchi::epoch() {
   Minigotchi::addEpoch();
   Parasite::readData();
-  Serial.print(Mood::getInstance().getNeutral() + " Current Epoch: ");
-  Serial.println(Minigotchi::currentEpoch);
-  Serial.println(" ");
-  Display::updateDisplay(Mood::getInstance().getNeutral(),
+
+  // new handshakes keep us happy, otherwise boredom sets in
+  static int lastHandshakeCount = 0;
+  Mood &mood = Mood::getInstance();
+  mood.post(handshakeCount > lastHandshakeCount ? MOOD_EVENT_ACTIVE_EPOCH
+                                                : MOOD_EVENT_IDLE_EPOCH);
+  lastHandshakeCount = handshakeCount;
+
+  Serial.printf("%s Current Epoch: %d (%s)\n \n", mood.getCurrentFace(),
+                Minigotchi::currentEpoch, mood.getCurrentMood());
+  Display::updateDisplay(mood.getCurrentFace(),
                          "Current Epoch: " + String(Minigotchi::currentEpoch));
 }
 
 void Minigotchi::boot() {
+  int phase = boot_phase_begin("mood+power");
   Mood::init(Config::happy, Config::sad, Config::broken, Config::intense,
              Config::looking1, Config::looking2, Config::neutral,
              Config::sleeping);
@@ -88,45 +202,89 @@ void Minigotchi::boot() {
     pinMode(4, OUTPUT);
     digitalWrite(4, HIGH);
   }
+  boot_phase_end(phase);
+
+  // nvs doesn't depend on the display, let it come up meanwhile
+  bool parallel = false;
+  if (Config::fastBoot) {
+    boot_events = xEventGroupCreate();
+    parallel = boot_events != NULL &&
+               xTaskCreatePinnedToCore(boot_nvs_task, "boot_nvs", 4096, NULL,
+                                       1, NULL, 0) == pdPASS;
+  }
 
+  phase = boot_phase_begin("display");
   Display::startScreen();
+  boot_phase_end(phase);
+
+  phase = boot_phase_begin("greeting");
+  int greetingDelay = Config::fastBoot ? 0 : Config::shortDelay;
   Serial.println(" ");
   Serial.println(Mood::getInstance().getHappy() +
                  " Hi, I'm Minigotchi, your pwnagotchi's best friend!");
   Display::updateDisplay(Mood::getInstance().getHappy(), "Hi, I'm Minigotchi");
-  delay(Config::shortDelay);
+  delay(greetingDelay);
   Serial.println(Mood::getInstance().getNeutral() +
                  " You can edit my configuration parameters in config.cpp!");
   Display::updateDisplay(Mood::getInstance().getNeutral(), "Edit config.cpp!");
-  delay(Config::shortDelay);
+  delay(greetingDelay);
   Serial.println(Mood::getInstance().getIntense() + " Starting now...");
   Display::updateDisplay(Mood::getInstance().getIntense(), "Starting now");
-  delay(Config::shortDelay);
+  delay(greetingDelay);
   Serial.println("################################################");
   Serial.println("#                BOOTUP PROCESS                #");
   Serial.println("################################################");
   Serial.println(" ");
+  boot_phase_end(phase);
 
-  // Initialize NVS
-  esp_err_t err = nvs_flash_init();
-  if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
-    ESP_ERROR_CHECK(nvs_flash_erase());
-    err = nvs_flash_init();
+  // the sd card can share the spi bus with tft screens, the render task must
+  // be done with the greeting (and any dma transfer) before it is mounted
+  if (!Display::waitIdle(BOOT_DISPLAY_IDLE_MS)) {
+    Serial.println("[BOOT] Display still busy, mounting the SD card anyway");
+  }
+  boot_sd();
+
+  if (parallel) {
+    phase = boot_phase_begin("wait nvs");
+    xEventGroupWaitBits(boot_events, BOOT_NVS_DONE, pdFALSE, pdTRUE,
+                        portMAX_DELAY);
+    vEventGroupDelete(boot_events);
+    boot_events = NULL;
+    boot_phase_end(phase);
+  } else {
+    boot_nvs();
   }
-  ESP_ERROR_CHECK(err);
-
-  Config::loadConfig(); // Load configuration (sets Config::configured)
 
   // SD Card Initialization
-  Serial.println(Mood::getInstance().getNeutral() + " Initializing SD card...");
-  if (!SD.begin(SD_CS_PIN)) {
+  if (!boot_sd_ok) {
     Serial.println("SD card initialization failed!");
+    Mood::getInstance().post(MOOD_EVENT_ERROR);
     Display::updateDisplay(Mood::getInstance().getSad(), "SD Card Failed!");
-    delay(Config::shortDelay);
+    delay(greetingDelay);
   } else {
     Serial.println("SD card initialized successfully!");
     Display::updateDisplay(Mood::getInstance().getHappy(), "SD Card OK!");
-    delay(Config::shortDelay);
+    delay(greetingDelay);
+
+    // a power cut may have left the newest capture mid-record
+    phase = boot_phase_begin("sd repair");
+    if (sd_repair_run(NULL) != ESP_OK) {
+      Serial.println("Could not repair the newest capture files.");
+    }
+    boot_phase_end(phase);
+  }
+
+  // self-tests leave test files behind and are skipped on fast boot, the
+  // capture path still needs the pcap logger though
+  if (boot_sd_ok && Config::fastBoot) {
+    phase = boot_phase_begin("pcap logger");
+    if (pcap_logger_init() != ESP_OK) {
+      Serial.println("Failed to initialize PCAP Logger.");
+      Mood::getInstance().post(MOOD_EVENT_ERROR);
+    }
+    boot_phase_end(phase);
+  } else if (boot_sd_ok) {
+    phase = boot_phase_begin("sd self-test");
     // SD card test file creation
     File testFile = SD.open("/minigotchi_sd_test.txt", FILE_WRITE);
     if (testFile) {
@@ -166,6 +324,7 @@ void Minigotchi::boot() {
       }
     } else {
       Serial.println("Failed to initialize PCAP Logger for testing.");
+      Mood::getInstance().post(MOOD_EVENT_ERROR);
     }
     
     // Handshake CSV logger test
@@ -190,9 +349,11 @@ void Minigotchi::boot() {
     } else {
       Serial.println("Failed to initialize Handshake CSV Logger for testing.");
     }
+    boot_phase_end(phase);
   }
-  delay(Config::shortDelay);
+  delay(greetingDelay);
 
+  phase = boot_phase_begin("wifi");
   ESP_ERROR_CHECK(esp_wifi_init(&Config::wifiCfg));
   ESP_ERROR_CHECK(esp_wifi_set_storage(WIFI_STORAGE_RAM));
   ESP_ERROR_CHECK(esp_wifi_set_country(&Config::ctryCfg));
@@ -211,22 +372,29 @@ void Minigotchi::boot() {
 
   Deauth::list();
   Channel::init(Config::channel);
+  boot_phase_end(phase);
   // Minigotchi::info(); // Called later in loop or by other functions
 
-  // Start WiFi Sniffer for testing (30-second capture then stop)
-  Serial.println(Mood::getInstance().getNeutral() + " Attempting to start WiFi sniffer for testing...");
-  esp_err_t sniffer_err = wifi_sniffer_start(); // This will also open the first PCAP file
-  if (sniffer_err == ESP_OK) {
-      Serial.println(Mood::getInstance().getHappy() + " WiFi sniffer started for 30-second test from boot().");
-      delay(30000); // Sniff for 30 seconds
-      Serial.println(Mood::getInstance().getNeutral() + " Stopping WiFi sniffer after 30s test.");
-      wifi_sniffer_stop(); // This will close the PCAP file
-      Serial.println(Mood::getInstance().getNeutral() + " WiFi sniffer stopped after test.");
-  } else {
-      Serial.println(Mood::getInstance().getBroken() + " Failed to start WiFi sniffer from boot(). Error: " + String(esp_err_to_name(sniffer_err)));
+  // Start WiFi Sniffer for testing (30-second capture then stop), setup()
+  // starts the real capture right after boot anyway
+  if (!Config::fastBoot) {
+    phase = boot_phase_begin("sniffer self-test");
+    Serial.println(Mood::getInstance().getNeutral() + " Attempting to start WiFi sniffer for testing...");
+    esp_err_t sniffer_err = wifi_sniffer_start(); // This will also open the first PCAP file
+    if (sniffer_err == ESP_OK) {
+        Serial.println(Mood::getInstance().getHappy() + " WiFi sniffer started for 30-second test from boot().");
+        delay(30000); // Sniff for 30 seconds
+        Serial.println(Mood::getInstance().getNeutral() + " Stopping WiFi sniffer after 30s test.");
+        wifi_sniffer_stop(); // This will close the PCAP file
+        Serial.println(Mood::getInstance().getNeutral() + " WiFi sniffer stopped after test.");
+    } else {
+        Serial.println(Mood::getInstance().getBroken() + " Failed to start WiFi sniffer from boot(). Error: " + String(esp_err_to_name(sniffer_err)));
+    }
+    boot_phase_end(phase);
   }
 
   Minigotchi::finish();
+  boot_print_timeline();
 }
 
 void Minigotchi::info() {
@@ -246,7 +414,9 @@ void Minigotchi::finish() {
   Serial.println(" ");
   Serial.println(Mood::getInstance().getHappy() + " Started successfully!");
   Display::updateDisplay(Mood::getInstance().getHappy(), "Started successfully"); // Corrected typo
-  delay(Config::shortDelay);
+  if (!Config::fastBoot) {
+    delay(Config::shortDelay);
+  }
 }
 
 void Minigotchi::version() {
@@ -22,19 +22,12 @@
 
 #include "mood.h"
 
-/*
-String Mood::happy = "";
-String Mood::sad = "";
-String Mood::broken = "";
-String Mood::intense = "";
-String Mood::looking1 = "";
-String Mood::looking2 = "";
-String Mood::neutral = "";
-String Mood::sleeping = "";
-*/
-
 Mood *Mood::instance = nullptr;
 
+static const char *const mood_names[MOOD_FACE_COUNT] = {
+    "happy",    "sad",      "broken",  "intense",
+    "looking1", "looking2", "neutral", "sleeping"};
+
 /**
  * Sets faces according to configuration at least
  * @param happy Happy face! (not me after making this constructor)
@@ -48,9 +41,8 @@ Mood *Mood::instance = nullptr;
  */
 Mood::Mood(String happy, String sad, String broken, String intense,
            String looking1, String looking2, String neutral, String sleeping)
-    : happy(happy), sad(sad), broken(broken), intense(intense),
-      looking1(looking1), looking2(looking2), neutral(neutral),
-      sleeping(sleeping) {}
+    : faces{happy, sad, broken, intense, looking1, looking2, neutral,
+            sleeping} {}
 
 /**
  * Initializes class in the singleton pattern thingy
@@ -70,29 +62,18 @@ void Mood::init(const String happy, const String sad, const String broken,
   if (instance == nullptr) {
     instance = new Mood(happy, sad, broken, intense, looking1, looking2,
                         neutral, sleeping);
+    return;
   }
 
   Mood &instance = getInstance();
-  instance.happy = happy;
-  instance.sad = sad;
-  instance.broken = broken;
-  instance.intense = intense;
-  instance.looking1 = looking1;
-  instance.looking2 = looking2;
-  instance.neutral = neutral;
-  instance.sleeping = sleeping;
-
-  /* debugging
-  Serial.println("Faces:");
-  Serial.println("Happy: " + instance.happy);
-  Serial.println("Sad: " + instance.sad);
-  Serial.println("Broken: " + instance.broken);
-  Serial.println("Intense: " + instance.intense);
-  Serial.println("Looking1: " + instance.looking1);
-  Serial.println("Looking2: " + instance.looking2);
-  Serial.println("Neutral: " + instance.neutral);
-  Serial.println("Sleeping: " + instance.sleeping);
-  */
+  instance.faces[MOOD_HAPPY] = happy;
+  instance.faces[MOOD_SAD] = sad;
+  instance.faces[MOOD_BROKEN] = broken;
+  instance.faces[MOOD_INTENSE] = intense;
+  instance.faces[MOOD_LOOKING1] = looking1;
+  instance.faces[MOOD_LOOKING2] = looking2;
+  instance.faces[MOOD_NEUTRAL] = neutral;
+  instance.faces[MOOD_SLEEPING] = sleeping;
 }
 
 /**
@@ -110,136 +91,134 @@ Mood &Mood::getInstance() {
 
 /** developer note:
  *
- * these checking procedures will only really be used for faces,
- * since they change often and the minigotchi is intended to be fast...
+ * faces are stored once, indexed by MoodFace. the getters hand out
+ * references and face() hands out the stored buffer, so logging or drawing
+ * a face never copies it. keep the references short lived, init() may
+ * reassign the table.
  *
- * obviously, this is all a WIP!
+ * the current mood follows events instead of whatever face was drawn last:
+ * epochs with new captures count towards excited, epochs without count
+ * towards bored and then sad, using the same thresholds we advertise to
+ * other pwnagotchis.
  *
  */
 
 /**
- * Returns the current mood and writes it to a variable
- * @param face Face to get mood off of
+ * Returns a face from the table
+ * @param mood Face to return
  */
-String Mood::getFull(String face) { Mood::getFace(Mood::getMood(face)); }
+const char *Mood::face(MoodFace mood) const {
+  return mood < MOOD_FACE_COUNT ? faces[mood].c_str() : " ";
+}
 
 /**
- * Returns current mood
+ * Returns the name of a mood
+ * @param mood Mood to name
  */
-String Mood::getCurrentMood() { return currentMood; }
+const char *Mood::name(MoodFace mood) {
+  return mood < MOOD_FACE_COUNT ? mood_names[mood] : " ";
+}
 
 /**
- * Gets current mood off of face
- * @param face Current face
+ * Finds which mood a face belongs to
+ * @param face Face to look up
+ * @return The mood, MOOD_FACE_COUNT if the face is unknown
  */
-String Mood::getMood(String face) {
-  if (face == happy) {
-    currentMood = "happy";
-  } else if (face == sad) {
-    currentMood = "sad";
-  } else if (face == broken) {
-    currentMood = "broken";
-  } else if (face == intense) {
-    currentMood = "intense";
-  } else if (face == looking1) {
-    currentMood = "looking1";
-  } else if (face == looking2) {
-    currentMood = "looking2";
-  } else if (face == neutral) {
-    currentMood = "neutral";
-  } else if (face == sleeping) {
-    currentMood = "sleeping";
-  } else {
-    currentMood = " ";
+MoodFace Mood::lookup(const char *face) const {
+  for (uint8_t i = 0; i < MOOD_FACE_COUNT; i++) {
+    if (strcmp(faces[i].c_str(), face) == 0) {
+      return (MoodFace)i;
+    }
   }
-
-  return currentMood;
+  return MOOD_FACE_COUNT;
 }
 
 /**
- * Returns the current face
+ * Returns the current mood
  */
-String Mood::getCurrentFace() { return currentFace; }
-
-/**
- * Gets face off of the mood
- * @param mood Mood to use
- */
-String Mood::getFace(String mood) {
-  if (mood == "happy") {
-    currentFace = happy;
-  } else if (mood == "sad") {
-    currentFace = sad;
-  } else if (mood == "broken") {
-    currentFace = broken;
-  } else if (mood == "looking1") {
-    currentFace = looking1;
-  } else if (mood == "looking2") {
-    currentFace = looking2;
-  } else if (mood == "neutral") {
-    currentFace = neutral;
-  } else if (mood == "sleeping") {
-    currentFace = sleeping;
-  } else {
-    currentFace = " ";
-  }
-
-  return currentFace;
-}
+MoodFace Mood::current() const { return currentFace; }
 
 /**
- * Checks if moods match one another.
- * If they're similar, return true.
- * If they aren't similar, return false.
- * @param previous Previous face
- * @param current Current face
+ * Returns the current face
  */
-bool Mood::checkMood(String previous, String current) {
-  if (previous == current) {
-    return true;
-  } else if (previous != current) {
-    return false;
-  } else {
-    return false;
+const char *Mood::getCurrentFace() const { return face(currentFace); }
+
+/**
+ * Returns the current mood's name
+ */
+const char *Mood::getCurrentMood() const { return name(currentFace); }
+
+/**
+ * Moves the mood along
+ * @param event What just happened
+ * @return The mood after the event
+ */
+MoodFace Mood::post(MoodEvent event) {
+  switch (event) {
+  case MOOD_EVENT_ACTIVE_EPOCH:
+    idleEpochs = 0;
+    activeEpochs++;
+    currentFace = activeEpochs >= Config::excited_num_epochs ? MOOD_INTENSE
+                                                             : MOOD_HAPPY;
+    break;
+  case MOOD_EVENT_IDLE_EPOCH:
+    activeEpochs = 0;
+    idleEpochs++;
+    if (idleEpochs >= Config::sad_num_epochs) {
+      currentFace = MOOD_SAD;
+    } else if (idleEpochs >= Config::bored_num_epochs) {
+      currentFace = MOOD_SLEEPING;
+    } else {
+      currentFace = MOOD_NEUTRAL;
+    }
+    break;
+  case MOOD_EVENT_FRIEND:
+    idleEpochs = 0;
+    currentFace = MOOD_HAPPY;
+    break;
+  case MOOD_EVENT_ERROR:
+    currentFace = MOOD_BROKEN;
+    break;
   }
+  return currentFace;
 }
 
 /**
  * Getter for happy mood
  */
-String Mood::getHappy() { return instance->happy; }
+const String &Mood::getHappy() const { return faces[MOOD_HAPPY]; }
 
 /**
  * Getter for sad mood
  */
-String Mood::getSad() { return instance->sad; }
+const String &Mood::getSad() const { return faces[MOOD_SAD]; }
 
 /**
  * Getter for broken mood
  */
-String Mood::getBroken() { return instance->broken; }
+const String &Mood::getBroken() const { return faces[MOOD_BROKEN]; }
 
 /**
  * Getter for intense mood
  */
-String Mood::getIntense() { return instance->intense; }
+const String &Mood::getIntense() const { return faces[MOOD_INTENSE]; }
 
 /**
  * Getter for looking1 mood
  */
-String Mood::getLooking1() { return instance->looking1; }
+const String &Mood::getLooking1() const { return faces[MOOD_LOOKING1]; }
 
 /**
  * Getter for looking2 mood
  */
-String Mood::getLooking2() { return instance->looking2; }
+const String &Mood::getLooking2() const { return faces[MOOD_LOOKING2]; }
 
 /**
  * Getter for neutral mood
  */
-String Mood::getNeutral() { return instance->neutral; }
+const String &Mood::getNeutral() const { return faces[MOOD_NEUTRAL]; }
 
 /**
  * Getter for sleeping mood
  */
-String Mood::getSleeping() { return instance->sleeping; }
+const String &Mood::getSleeping() const { return faces[MOOD_SLEEPING]; }
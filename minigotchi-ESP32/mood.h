@@ -31,6 +31,27 @@
 // Forward declaration
 class Display;
 
+// Faces, in the order they are stored in the face table
+enum MoodFace : uint8_t {
+  MOOD_HAPPY,
+  MOOD_SAD,
+  MOOD_BROKEN,
+  MOOD_INTENSE,
+  MOOD_LOOKING1,
+  MOOD_LOOKING2,
+  MOOD_NEUTRAL,
+  MOOD_SLEEPING,
+  MOOD_FACE_COUNT
+};
+
+// Things that move the mood around
+enum MoodEvent : uint8_t {
+  MOOD_EVENT_ACTIVE_EPOCH, // Epoch that caught something new
+  MOOD_EVENT_IDLE_EPOCH,   // Epoch that caught nothing
+  MOOD_EVENT_FRIEND,       // Another pwnagotchi showed up
+  MOOD_EVENT_ERROR         // Something broke
+};
+
 class Mood {
 public:
   static Mood &getInstance();
@@ -40,38 +61,33 @@ public:
   Mood(const Mood &) = delete;
   Mood &operator=(const Mood &) = delete;
 
-  String getFull(String face);
-  String getCurrentFace();
-  String getCurrentMood();
-  String getMood(String face);
-  String getFace(String mood);
-  bool checkMood(String previous, String current);
+  const char *face(MoodFace mood) const;
+  static const char *name(MoodFace mood);
+  MoodFace lookup(const char *face) const;
+  MoodFace current() const;
+  const char *getCurrentFace() const;
+  const char *getCurrentMood() const;
+  MoodFace post(MoodEvent event);
 
-  String getHappy();
-  String getSad();
-  String getBroken();
-  String getIntense();
-  String getLooking1();
-  String getLooking2();
-  String getNeutral();
-  String getSleeping();
+  const String &getHappy() const;
+  const String &getSad() const;
+  const String &getBroken() const;
+  const String &getIntense() const;
+  const String &getLooking1() const;
+  const String &getLooking2() const;
+  const String &getNeutral() const;
+  const String &getSleeping() const;
 
 private:
   Mood(String happy, String sad, String broken, String intense, String looking1,
        String looking2, String neutral, String sleeping);
 
   static Mood *instance;
-  String happy;
-  String sad;
-  String broken;
-  String intense;
-  String looking1;
-  String looking2;
-  String neutral;
-  String sleeping;
+  String faces[MOOD_FACE_COUNT];
 
-  String currentMood;
-  String currentFace;
+  MoodFace currentFace = MOOD_NEUTRAL;
+  int activeEpochs = 0;
+  int idleEpochs = 0;
 };
 
 #endif // MOOD_H
@@ -21,27 +21,231 @@
  */
 
 #include "parasite.h"
+#include <esp_timer.h>
+#include <freertos/semphr.h>
 
 int Parasite::channel = 0;
 
+/** developer note:
+ *
+ * frames look like "cmd:::payload" or "cmd:::payload*XX\n", where XX is the
+ * hex xor of every byte before the '*' (the nmea trick). incoming bytes are
+ * fed one at a time from the uart rx buffer into a small state machine, so
+ * readData() never waits on Serial.readStringUntil(). with
+ * Config::parasiteChecksum set, outgoing frames carry a checksum too and
+ * incoming frames without one are dropped.
+ *
+ * outgoing frames are appended to one of two fixed buffers. inside a
+ * readData() pass they are written in a single Serial.write() when the pass
+ * ends, anywhere else each send* call flushes before returning, so a status
+ * sent before a long advertise burst or deauth loop reaches the host before
+ * that work starts, not after it.
+ *
+ */
+
+#define PARASITE_CMD_LEN 3
+#define PARASITE_PAYLOAD_MAX 128
+#define PARASITE_TX_BATCH 512
+#define PARASITE_RX_BUDGET 256 // Bytes handled per readData() call
+
+typedef enum {
+  PARASITE_RX_COMMAND,
+  PARASITE_RX_DELIMITER,
+  PARASITE_RX_PAYLOAD,
+  PARASITE_RX_CHECKSUM,
+  PARASITE_RX_END,
+  PARASITE_RX_RESYNC
+} parasite_rx_state_t;
+
+static parasite_rx_state_t rx_state = PARASITE_RX_COMMAND;
+static char rx_command[PARASITE_CMD_LEN + 1];
+static char rx_payload[PARASITE_PAYLOAD_MAX + 1];
+static size_t rx_len = 0;
+static uint8_t rx_sum = 0;
+static uint8_t rx_expected = 0;
+static bool rx_has_checksum = false;
+static int64_t rx_start_us = 0;
+
+static char tx_batch[2][PARASITE_TX_BATCH];
+static size_t tx_len[2] = {0, 0};
+static int tx_active = 0;
+static portMUX_TYPE tx_mutex = portMUX_INITIALIZER_UNLOCKED;
+static SemaphoreHandle_t tx_write_mutex = NULL;
+
+static parasite_stats_t parasite_stats;
+static volatile bool tx_in_pass = false; // readData() flushes once at the end
+
+static int parasite_hex(uint8_t c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  c |= 0x20;
+  return c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+}
+
+/**
+ * Copies a string into buf as the body of a JSON string
+ * @param buf Buffer to write to
+ * @param bufSize Size of buf
+ * @param str String to escape
+ * @return Characters written, excluding the null terminator
+ */
+static size_t parasite_escape(char *buf, size_t bufSize, const char *str) {
+  size_t n = 0;
+  for (; *str != '\0' && n + 2 < bufSize; str++) {
+    uint8_t c = *str;
+    if (c == '"' || c == '\\') {
+      buf[n++] = '\\';
+      buf[n++] = c;
+    } else if (c >= 0x20) {
+      buf[n++] = c;
+    }
+  }
+  buf[n] = '\0';
+  return n;
+}
+
+/**
+ * Advances the receive state machine by one byte
+ * @param byte Next byte from the UART
+ */
+void Parasite::feed(uint8_t byte) {
+  if (byte == '\r') {
+    return;
+  }
+  bool newline = byte == '\n';
+
+  switch (rx_state) {
+  case PARASITE_RX_COMMAND:
+    if (newline) {
+      rx_len = 0; // blank line
+      return;
+    }
+    if (rx_len == 0) {
+      rx_start_us = esp_timer_get_time();
+      rx_sum = 0;
+      rx_has_checksum = false;
+    }
+    rx_command[rx_len++] = byte;
+    rx_sum ^= byte;
+    if (rx_len == PARASITE_CMD_LEN) {
+      rx_command[PARASITE_CMD_LEN] = '\0';
+      rx_len = 0;
+      rx_state = PARASITE_RX_DELIMITER;
+    }
+    return;
+
+  case PARASITE_RX_DELIMITER:
+    if (byte != ':') {
+      break;
+    }
+    rx_sum ^= byte;
+    if (++rx_len == 3) {
+      rx_len = 0;
+      rx_state = PARASITE_RX_PAYLOAD;
+    }
+    return;
+
+  case PARASITE_RX_PAYLOAD:
+    if (newline) {
+      rx_payload[rx_len] = '\0';
+      rx_state = PARASITE_RX_END;
+      Parasite::feed('\n');
+      return;
+    }
+    if (byte == '*') {
+      rx_payload[rx_len] = '\0';
+      rx_has_checksum = true;
+      rx_expected = 0;
+      rx_len = 0;
+      rx_state = PARASITE_RX_CHECKSUM;
+      return;
+    }
+    if (rx_len >= PARASITE_PAYLOAD_MAX) {
+      break;
+    }
+    rx_payload[rx_len++] = byte;
+    rx_sum ^= byte;
+    return;
+
+  case PARASITE_RX_CHECKSUM: {
+    int nibble = parasite_hex(byte);
+    if (nibble < 0) {
+      break;
+    }
+    rx_expected = (rx_expected << 4) | nibble;
+    if (++rx_len == 2) {
+      rx_state = PARASITE_RX_END;
+    }
+    return;
+  }
+
+  case PARASITE_RX_END:
+    if (!newline) {
+      break;
+    }
+    rx_len = 0;
+    rx_state = PARASITE_RX_COMMAND;
+    if (rx_has_checksum ? rx_expected != rx_sum : Config::parasiteChecksum) {
+      parasite_stats.badChecksum++;
+      return;
+    }
+    Parasite::dispatch(rx_command, rx_payload);
+    {
+      uint32_t latency = esp_timer_get_time() - rx_start_us;
+      if (latency > parasite_stats.maxLatencyUs) {
+        parasite_stats.maxLatencyUs = latency;
+      }
+    }
+    return;
+
+  case PARASITE_RX_RESYNC:
+    if (newline) {
+      rx_len = 0;
+      rx_state = PARASITE_RX_COMMAND;
+    }
+    return;
+  }
+
+  // malformed or too long, skip to the next line
+  parasite_stats.overflows++;
+  rx_len = 0;
+  rx_state = newline ? PARASITE_RX_COMMAND : PARASITE_RX_RESYNC;
+}
+
+/**
+ * Runs a parsed command
+ * @param command Three letter command
+ * @param payload Everything after the delimiter, checksum removed
+ */
+void Parasite::dispatch(const char *command, const char *payload) {
+  if (strcmp(command, "chn") == 0) {
+    int chn = atoi(payload);
+    if (Channel::isValidChannel(chn)) {
+      Parasite::channel = chn;
+    } else {
+      Parasite::channel = 0;
+    }
+  } else if (strcmp(command, "nme") == 0) {
+    Parasite::sendName();
+  } else {
+    parasite_stats.unknown++;
+    return;
+  }
+  parasite_stats.frames++;
+}
+
 /**
  * Reads data from Parasite mode on the Minigotchi
  */
 void Parasite::readData() {
   if (Config::parasite) {
     int curChan = Parasite::channel;
-    while (Serial.available() > 0) {
-      String line = Serial.readStringUntil('\n');
-      if (line.startsWith("chn:::")) {
-        int chn = atoi(line.substring(6).c_str());
-        if (Channel::isValidChannel(chn)) {
-          Parasite::channel = chn;
-        } else {
-          Parasite::channel = 0;
-        }
-      } else if (line.startsWith("nme:::")) {
-        Parasite::sendName();
-      }
+    // only what is already buffered, never wait for more
+    int budget = PARASITE_RX_BUDGET;
+    tx_in_pass = true;
+    while (budget-- > 0 && Serial.available() > 0) {
+      Parasite::feed((uint8_t)Serial.read());
     }
 
     // If parasite channel is set and is different than what was there before,
@@ -52,9 +256,38 @@ void Parasite::readData() {
     } else if (Parasite::channel == 0 && curChan > 0) {
       Parasite::sendChannelStatus(RANDOM_CHANNEL);
     }
+    tx_in_pass = false;
+    Parasite::flush();
   }
 }
 
+/**
+ * Writes every queued status message in one go
+ */
+void Parasite::flush() {
+  if (tx_write_mutex == NULL) {
+    return; // nothing was ever queued
+  }
+  xSemaphoreTake(tx_write_mutex, portMAX_DELAY);
+  portENTER_CRITICAL(&tx_mutex);
+  int full = tx_active;
+  tx_active ^= 1;
+  portEXIT_CRITICAL(&tx_mutex);
+
+  if (tx_len[full] > 0) {
+    Serial.write((const uint8_t *)tx_batch[full], tx_len[full]);
+    tx_len[full] = 0;
+    parasite_stats.txBatches++;
+  }
+  xSemaphoreGive(tx_write_mutex);
+}
+
+/**
+ * Copies the parser and batching counters
+ * @param out Where to copy them
+ */
+void Parasite::getStats(parasite_stats_t *out) { *out = parasite_stats; }
+
 /**
  * Shows current channel
  * @param status Channel, either synced or unsynced
@@ -140,23 +373,21 @@ void Parasite::sendDeauthStatus(parasite_deauth_status_type_t status,
                                 const char *target, int channel) {
   if (Config::parasite) {
     if (target != nullptr && channel > 0) {
-      JsonDocument doc;
-      char chnBuf[4];
-      char buf[65];
+      char ssid[2 * 32 + 1];
+      char buf[96];
 
-      snprintf(chnBuf, sizeof(chnBuf), "%d", channel);
       // target is an SSID, which should only be 32 characters at most
       // Unlikely scenario but will truncate to 29 characters + "..." in case
       // that gets disrespected by someone
       if (strlen(target) > 32) {
         char targetBuf[33];
         Parasite::formatData(targetBuf, target, sizeof(targetBuf));
-        doc["ssid"] = targetBuf;
+        parasite_escape(ssid, sizeof(ssid), targetBuf);
       } else {
-        doc["ssid"] = target;
+        parasite_escape(ssid, sizeof(ssid), target);
       }
-      doc["channel"] = chnBuf;
-      serializeJson(doc, buf);
+      snprintf(buf, sizeof(buf), "{\"ssid\":\"%s\",\"channel\":\"%d\"}", ssid,
+               channel);
       Parasite::sendData("atk", static_cast<uint8_t>(status), buf);
     } else {
       Parasite::sendData("atk", static_cast<uint8_t>(status), nullptr);
@@ -171,21 +402,69 @@ void Parasite::sendDeauthStatus(parasite_deauth_status_type_t status,
  * @param data Data to use
  */
 void Parasite::sendData(const char *command, uint8_t status, const char *data) {
-  JsonDocument doc;
-  char nBuf[4];  // Up to 3 digits + null terminator
-  char buf[129]; // Up to 128 characters + null terminator
-  char fullCmd[135] = {
-      0}; // Data buffer (128) + command (3) + delimiter (3) + null terminator
-  snprintf(nBuf, sizeof(nBuf), "%d", status);
-  doc["status"] = nBuf;
+  char escaped[PARASITE_PAYLOAD_MAX + 1];
+  // command, ":::", the JSON around the payload and "*XX\r\n"
+  char frame[PARASITE_CMD_LEN + 3 + PARASITE_PAYLOAD_MAX + 48];
+  int len;
   if (data != nullptr) {
-    doc["data"] = data;
+    parasite_escape(escaped, sizeof(escaped), data);
+    len = snprintf(frame, sizeof(frame), "%s:::{\"status\":\"%d\",\"data\":\"%s\"}",
+                   command, status, escaped);
+  } else {
+    len = snprintf(frame, sizeof(frame), "%s:::{\"status\":\"%d\"}", command,
+                   status);
+  }
+  if (len < 0 || len > (int)sizeof(frame) - 6) {
+    parasite_stats.txDropped++; // cutting it would leave the host broken JSON
+    return;
+  }
+  if (Config::parasiteChecksum) {
+    uint8_t sum = 0;
+    for (int i = 0; i < len; i++) {
+      sum ^= (uint8_t)frame[i];
+    }
+    len += snprintf(frame + len, sizeof(frame) - len, "*%02X", sum);
+  }
+  frame[len++] = '\r';
+  frame[len++] = '\n';
+
+  if (tx_write_mutex == NULL) {
+    static portMUX_TYPE init_mutex = portMUX_INITIALIZER_UNLOCKED;
+    SemaphoreHandle_t created = xSemaphoreCreateMutex();
+    portENTER_CRITICAL(&init_mutex);
+    if (tx_write_mutex == NULL) {
+      tx_write_mutex = created;
+      created = NULL;
+    }
+    portEXIT_CRITICAL(&init_mutex);
+    if (created != NULL) {
+      vSemaphoreDelete(created);
+    }
+    if (tx_write_mutex == NULL) {
+      parasite_stats.txDropped++;
+      return;
+    }
+  }
+
+  for (int attempt = 0; attempt < 2; attempt++) {
+    portENTER_CRITICAL(&tx_mutex);
+    size_t &used = tx_len[tx_active];
+    bool fits = used + len <= PARASITE_TX_BATCH;
+    if (fits) {
+      memcpy(tx_batch[tx_active] + used, frame, len);
+      used += len;
+      parasite_stats.txMessages++;
+    }
+    portEXIT_CRITICAL(&tx_mutex);
+    if (fits) {
+      if (!tx_in_pass) {
+        Parasite::flush();
+      }
+      return;
+    }
+    Parasite::flush(); // batch is full, send it and retry
   }
-  serializeJson(doc, buf);
-  strncat(fullCmd, command, sizeof(fullCmd) - 1);
-  strncat(fullCmd, ":::", sizeof(fullCmd) - strlen(fullCmd) - 1);
-  strncat(fullCmd, buf, sizeof(fullCmd) - strlen(fullCmd) - 1);
-  Serial.println(fullCmd);
+  parasite_stats.txDropped++;
 }
 
 /**
@@ -55,9 +55,22 @@ typedef enum {
   DEAUTH_SCAN_ERROR = 250
 } parasite_deauth_status_type_t;
 
+typedef struct {
+  uint32_t frames;         // Commands parsed and dispatched
+  uint32_t badChecksum;    // Frames dropped for a wrong or missing checksum
+  uint32_t overflows;      // Frames dropped for being too long or malformed
+  uint32_t unknown;        // Well formed frames with a command we don't know
+  uint32_t maxLatencyUs;   // Worst first byte to dispatch time
+  uint32_t txMessages;     // Status messages queued
+  uint32_t txBatches;      // Serial writes used to send them
+  uint32_t txDropped;      // Messages too big for a frame or a batch buffer
+} parasite_stats_t;
+
 class Parasite {
 public:
   static void readData();
+  static void flush();
+  static void getStats(parasite_stats_t *out);
   static void sendChannelStatus(parasite_channel_status_type_t status);
   static void sendName();
   static void sendAdvertising();
@@ -70,6 +83,8 @@ public:
   static int channel;
 
 private:
+  static void feed(uint8_t byte);
+  static void dispatch(const char *command, const char *payload);
   static void sendData(const char *command, uint8_t status, const char *data);
   static void formatData(char *buf, const char *data, size_t bufSize);
 };
@@ -0,0 +1,126 @@
+#include "pcap_dedup.h"
+#include "config.h"
+#include "heap_tracker.h"
+#include <esp_heap_caps.h>
+#include <string.h>
+
+#define DEDUP_HDR_LEN 24        // Management header
+#define DEDUP_FIXED_LEN 12      // Timestamp, beacon interval, capability
+#define DEDUP_FCS_LEN 4
+#define DEDUP_BSSID_OFFSET 16   // Address 3
+#define DEDUP_EID_TIM 5
+
+typedef struct {
+    uint8_t bssid[6];
+    uint8_t subtype;
+    uint8_t kept;               // Frames kept in this file, 0 marks a free slot
+    uint32_t ie_hash;
+} pcap_dedup_entry_t;
+
+static pcap_dedup_entry_t *dedup_table = NULL;
+static uint32_t dedup_used = 0;
+static uint32_t dedup_overflows = 0;
+
+esp_err_t pcap_dedup_init(void) {
+    if (dedup_table != NULL) {
+        return ESP_OK;
+    }
+    dedup_table = (pcap_dedup_entry_t *)heap_track_malloc(
+        HEAP_TAG_PCAP, PCAP_DEDUP_SLOTS * sizeof(pcap_dedup_entry_t), MALLOC_CAP_8BIT);
+    if (dedup_table == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    pcap_dedup_reset();
+    return ESP_OK;
+}
+
+void pcap_dedup_reset(void) {
+    if (dedup_table != NULL) {
+        memset(dedup_table, 0, PCAP_DEDUP_SLOTS * sizeof(pcap_dedup_entry_t));
+    }
+    dedup_used = 0;
+    dedup_overflows = 0;
+}
+
+void pcap_dedup_deinit(void) {
+    heap_track_free(HEAP_TAG_PCAP, dedup_table);
+    dedup_table = NULL;
+}
+
+static inline uint32_t dedup_fnv(uint32_t h, const uint8_t *p, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ p[i]) * 16777619u;
+    }
+    return h;
+}
+
+/**
+ * Capability field and every element but the TIM
+ */
+static uint32_t dedup_ie_hash(const uint8_t *frame, size_t len) {
+    const uint8_t *p = frame + DEDUP_HDR_LEN + 10;
+    const uint8_t *end = frame + len - DEDUP_FCS_LEN;
+    uint32_t h = dedup_fnv(2166136261u, p, 2);
+    p += 2;
+    while (p + 2 <= end) {
+        size_t elen = p[1];
+        if (p + 2 + elen > end) {
+            h = dedup_fnv(h, p, end - p); // truncated element, hash what is there
+            break;
+        }
+        if (p[0] != DEDUP_EID_TIM) {
+            h = dedup_fnv(h, p, 2 + elen);
+        }
+        p += 2 + elen;
+    }
+    return h;
+}
+
+pcap_dedup_verdict_t pcap_dedup_check(const uint8_t *frame, size_t len) {
+    if (dedup_table == NULL || len < DEDUP_HDR_LEN + DEDUP_FIXED_LEN + DEDUP_FCS_LEN) {
+        return PCAP_DEDUP_KEEP;
+    }
+    // management beacons (0x80) and probe responses (0x50) only
+    uint8_t fc = frame[0];
+    if (fc != 0x80 && fc != 0x50) {
+        return PCAP_DEDUP_KEEP;
+    }
+    uint8_t subtype = fc >> 4;
+    const uint8_t *bssid = frame + DEDUP_BSSID_OFFSET;
+    uint32_t ie_hash = dedup_ie_hash(frame, len);
+
+    uint32_t slot = dedup_fnv(2166136261u ^ subtype, bssid, 6) & (PCAP_DEDUP_SLOTS - 1);
+    for (int probe = 0; probe < PCAP_DEDUP_PROBES; probe++) {
+        pcap_dedup_entry_t &e = dedup_table[(slot + probe) & (PCAP_DEDUP_SLOTS - 1)];
+        if (e.kept == 0) {
+            memcpy(e.bssid, bssid, 6);
+            e.subtype = subtype;
+            e.kept = 1;
+            e.ie_hash = ie_hash;
+            dedup_used++;
+            return PCAP_DEDUP_FIRST;
+        }
+        if (e.subtype != subtype || memcmp(e.bssid, bssid, 6) != 0) {
+            continue;
+        }
+        if (e.ie_hash != ie_hash) {
+            e.ie_hash = ie_hash; // SSID, channel, RSN or similar changed
+            return PCAP_DEDUP_KEEP;
+        }
+        if (Config::pcapBeaconKeep <= 0) {
+            return PCAP_DEDUP_KEEP;
+        }
+        if (e.kept < Config::pcapBeaconKeep && e.kept < UINT8_MAX) {
+            e.kept++;
+            return PCAP_DEDUP_KEEP;
+        }
+        return PCAP_DEDUP_DROP;
+    }
+    dedup_overflows++;
+    return PCAP_DEDUP_KEEP;
+}
+
+void pcap_dedup_usage(uint32_t *used, uint32_t *overflows) {
+    *used = dedup_used;
+    *overflows = dedup_overflows;
+}
@@ -0,0 +1,61 @@
+#ifndef PCAP_DEDUP_H
+#define PCAP_DEDUP_H
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * pcap_dedup.h: beacon and probe response thinning for capture files
+ *
+ * An AP beacons about ten times a second with the same content. Per file,
+ * the first Config::pcapBeaconKeep beacons (and probe responses) of each
+ * BSSID are kept, later ones only when the hash of their information
+ * elements changes. The TIM element and the FCS are left out of the hash,
+ * they change with every beacon. Other frame types, EAPOL included, are
+ * always kept, and so is everything once the table is full. With
+ * pcapBeaconKeep at 0 nothing is dropped, but first beacons are still
+ * reported for the capture index.
+ *
+ * Not locked, pcap_logger calls it with its mutex held.
+ */
+
+#define PCAP_DEDUP_SLOTS 2048  // Power of two, 12 bytes each
+#define PCAP_DEDUP_PROBES 8    // Slots looked at before giving up on a BSSID
+
+typedef enum {
+    PCAP_DEDUP_KEEP,
+    PCAP_DEDUP_FIRST,      // Kept, first beacon or probe response of its BSSID in this file
+    PCAP_DEDUP_DROP
+} pcap_dedup_verdict_t;
+
+/**
+ * @brief Allocate the table, dedup stays off if it does not fit
+ */
+esp_err_t pcap_dedup_init(void);
+
+/**
+ * @brief Forget all BSSIDs, called when a new file is opened
+ */
+void pcap_dedup_reset(void);
+
+/**
+ * @brief Free the table
+ */
+void pcap_dedup_deinit(void);
+
+/**
+ * @brief Decide whether a captured frame goes into the file
+ *
+ * @param frame 802.11 frame starting at frame control, FCS included
+ * @param len Frame length
+ * @return PCAP_DEDUP_DROP for a repeated beacon or probe response
+ */
+pcap_dedup_verdict_t pcap_dedup_check(const uint8_t *frame, size_t len);
+
+/**
+ * @brief BSSIDs in the table, full table misses since the last reset
+ */
+void pcap_dedup_usage(uint32_t *used, uint32_t *overflows);
+
+#endif // PCAP_DEDUP_H
@@ -0,0 +1,230 @@
+#include "pcap_index.h"
+#include "heap_tracker.h"
+#include "logger.h"
+#include "pcap_logger.h"
+#include <Arduino.h>
+#include <SD.h>
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+#include <stddef.h>
+#include <string.h>
+
+#define PCAP_INDEX_SCAN_CHUNK 4096
+#define PCAP_INDEX_SCAN_PEEK 64 // Radiotap plus enough of the frame to see EAPOL-Key info
+
+static File index_file;
+static pcap_index_entry_t index_pending[PCAP_INDEX_BUFFERED];
+static size_t index_pending_count = 0;
+static uint32_t index_next_time_sec = 0;
+static uint32_t index_entries = 0;
+static uint32_t index_dropped = 0;
+
+/**
+ * EAPOL frame check, fills in the AP and the 4-way message number
+ */
+static bool pcap_index_eapol(const uint8_t *f, size_t len, uint8_t *ap, uint8_t *msg) {
+    if (len < 24 || (f[0] & 0x0c) != 0x08) {
+        return false; // not a data frame
+    }
+    uint8_t ds = f[1] & 0x03;
+    size_t hdr = 24 + ((f[0] & 0x80) ? 2 : 0) + (ds == 0x03 ? 6 : 0);
+    static const uint8_t snap[8] = {0xaa, 0xaa, 0x03, 0x00, 0x00, 0x00, 0x88, 0x8e};
+    if (len < hdr + sizeof(snap) + 4 || memcmp(f + hdr, snap, sizeof(snap)) != 0) {
+        return false;
+    }
+    memcpy(ap, ds == 0x01 ? f + 4 : ds == 0x02 ? f + 10 : f + 16, 6);
+
+    const uint8_t *eapol = f + hdr + sizeof(snap);
+    *msg = 0;
+    if (eapol[1] == 0x03 && len >= hdr + sizeof(snap) + 7) {
+        uint16_t key_info = (eapol[5] << 8) | eapol[6];
+        bool install = key_info & 0x0040;
+        bool ack = key_info & 0x0080;
+        bool mic = key_info & 0x0100;
+        bool secure = key_info & 0x0200;
+        if (ack && !mic) {
+            *msg = 1;
+        } else if (ack && mic && install) {
+            *msg = 3;
+        } else if (!ack && mic) {
+            *msg = secure ? 4 : 2;
+        }
+    }
+    return true;
+}
+
+esp_err_t pcap_index_open(int capture) {
+    pcap_index_close();
+    char path[MAX_PCAP_FILE_NAME_LENGTH];
+    snprintf(path, sizeof(path), "%s/%s_%d%s", PCAP_DIR, PCAP_BASE_FILENAME, capture, PCAP_INDEX_EXT);
+    index_file = SD.open(path, FILE_WRITE);
+    if (!index_file) {
+        LOGW("pcap", "No index for capture %d", capture);
+        return ESP_FAIL;
+    }
+    pcap_index_header_t header;
+    memcpy(header.magic, PCAP_INDEX_MAGIC, sizeof(header.magic));
+    header.version = PCAP_INDEX_VERSION;
+    header.entry_size = sizeof(pcap_index_entry_t);
+    header.flags = 0;
+    header.reserved = 0;
+    index_file.write((const uint8_t *)&header, sizeof(header));
+    index_pending_count = 0;
+    index_next_time_sec = 0;
+    index_entries = 0;
+    index_dropped = 0;
+    return ESP_OK;
+}
+
+void pcap_index_note(const uint8_t *frame, size_t len, uint32_t ts_sec, uint32_t ts_usec,
+                     uint32_t offset, bool first_beacon) {
+    if (!index_file) {
+        return;
+    }
+    pcap_index_entry_t e = {};
+    if (pcap_index_eapol(frame, len, e.mac, &e.msg)) {
+        e.type = PCAP_INDEX_EAPOL;
+    } else if (first_beacon && frame[0] == 0x80) {
+        e.type = PCAP_INDEX_BEACON;
+        memcpy(e.mac, frame + 16, 6);
+    } else if (ts_sec >= index_next_time_sec) {
+        e.type = PCAP_INDEX_TIME;
+    } else {
+        return;
+    }
+    e.ts_sec = ts_sec;
+    e.ts_usec = ts_usec;
+    e.offset = offset;
+    if (ts_sec >= index_next_time_sec) {
+        index_next_time_sec = ts_sec + PCAP_INDEX_TIME_S; // any entry carries the time
+    }
+
+    // flushing here would put entries on the card before their records,
+    // pcap_logger checkpoints when pcap_index_full() says so
+    if (index_pending_count >= PCAP_INDEX_BUFFERED) {
+        index_dropped++;
+        return;
+    }
+    index_pending[index_pending_count++] = e;
+}
+
+bool pcap_index_full(void) { return index_file && index_pending_count >= PCAP_INDEX_BUFFERED; }
+
+esp_err_t pcap_index_flush(void) {
+    if (!index_file || index_pending_count == 0) {
+        return ESP_OK;
+    }
+    size_t len = index_pending_count * sizeof(pcap_index_entry_t);
+    size_t written = index_file.write((const uint8_t *)index_pending, len);
+    index_entries += written / sizeof(pcap_index_entry_t);
+    index_pending_count = 0;
+    index_file.flush();
+    return written == len ? ESP_OK : ESP_FAIL;
+}
+
+void pcap_index_close(void) {
+    if (!index_file) {
+        return;
+    }
+    pcap_index_flush();
+    if (index_dropped > 0) {
+        // readers have to scan the capture instead of trusting the index
+        uint16_t flags = PCAP_INDEX_TRUNCATED;
+        if (!index_file.seek(offsetof(pcap_index_header_t, flags)) ||
+            index_file.write((const uint8_t *)&flags, sizeof(flags)) != sizeof(flags)) {
+            LOGE("pcap", "Could not mark the index as truncated");
+        }
+        LOGW("pcap", "Index missed %u entries, marked truncated", (unsigned)index_dropped);
+    }
+    index_file.close();
+}
+
+/**
+ * EAPOL records found by walking every record header of the capture
+ */
+static int pcap_index_scan(File &f, uint32_t *bytes) {
+    uint8_t *chunk = (uint8_t *)heap_track_malloc(HEAP_TAG_PCAP, PCAP_INDEX_SCAN_CHUNK, MALLOC_CAP_8BIT);
+    if (chunk == NULL) {
+        return -1;
+    }
+    uint32_t size = f.size();
+    uint32_t chunk_start = 0;
+    uint32_t chunk_len = 0;
+    uint32_t pos = sizeof(pcap_global_header_t);
+    int found = 0;
+    *bytes = 0;
+    while (pos + sizeof(pcap_packet_header_t) <= size) {
+        pcap_packet_header_t rec;
+        uint32_t need = sizeof(rec) + PCAP_INDEX_SCAN_PEEK;
+        if (pos < chunk_start || pos + need > chunk_start + chunk_len) {
+            if (!f.seek(pos)) {
+                break;
+            }
+            chunk_start = pos;
+            chunk_len = f.read(chunk, PCAP_INDEX_SCAN_CHUNK);
+            *bytes += chunk_len;
+            if (chunk_len < sizeof(rec)) {
+                break;
+            }
+        }
+        memcpy(&rec, chunk + (pos - chunk_start), sizeof(rec));
+        uint32_t avail = chunk_start + chunk_len - pos - sizeof(rec);
+        uint32_t peek = rec.incl_len < avail ? rec.incl_len : avail;
+        uint8_t ap[6];
+        uint8_t msg;
+        if (peek > RADIOTAP_HEADER_LEN &&
+            pcap_index_eapol(chunk + (pos - chunk_start) + sizeof(rec) + RADIOTAP_HEADER_LEN,
+                             peek - RADIOTAP_HEADER_LEN, ap, &msg)) {
+            found++;
+        }
+        pos += sizeof(rec) + rec.incl_len;
+    }
+    heap_track_free(HEAP_TAG_PCAP, chunk);
+    return found;
+}
+
+esp_err_t pcap_index_bench(int capture) {
+    char path[MAX_PCAP_FILE_NAME_LENGTH];
+    snprintf(path, sizeof(path), "%s/%s_%d%s", PCAP_DIR, PCAP_BASE_FILENAME, capture, PCAP_INDEX_EXT);
+    File idx = SD.open(path, FILE_READ);
+    snprintf(path, sizeof(path), "%s/%s_%d.pcap", PCAP_DIR, PCAP_BASE_FILENAME, capture);
+    File pcap = SD.open(path, FILE_READ);
+    if (!idx || !pcap) {
+        Serial.printf("[INDEX] capture %d needs both an uncompressed .pcap and its .idx\n", capture);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    int64_t start = esp_timer_get_time();
+    pcap_index_header_t header;
+    int via_index = 0;
+    uint32_t entries = 0;
+    bool usable = idx.read((uint8_t *)&header, sizeof(header)) == sizeof(header) &&
+                  memcmp(header.magic, PCAP_INDEX_MAGIC, sizeof(header.magic)) == 0 &&
+                  header.version == PCAP_INDEX_VERSION && header.entry_size == sizeof(pcap_index_entry_t);
+    if (usable) {
+        pcap_index_entry_t batch[32];
+        int n;
+        while ((n = idx.read((uint8_t *)batch, sizeof(batch))) >= (int)sizeof(pcap_index_entry_t)) {
+            for (int i = 0; i < n / (int)sizeof(pcap_index_entry_t); i++) {
+                entries++;
+                if (batch[i].type == PCAP_INDEX_EAPOL && batch[i].offset < pcap.size()) {
+                    via_index++;
+                }
+            }
+        }
+    }
+    int64_t index_us = esp_timer_get_time() - start;
+
+    start = esp_timer_get_time();
+    uint32_t scanned = 0;
+    int via_scan = pcap_index_scan(pcap, &scanned);
+    int64_t scan_us = esp_timer_get_time() - start;
+
+    Serial.printf("[INDEX] capture %d: index %u entries (%u bytes%s), %d EAPOL in %lld us | full scan %u bytes, %d EAPOL in %lld us\n",
+                  capture, (unsigned)entries, (unsigned)idx.size(),
+                  !usable ? ", unreadable" : (header.flags & PCAP_INDEX_TRUNCATED) ? ", truncated" : "",
+                  via_index, index_us, (unsigned)scanned, via_scan, scan_us);
+    idx.close();
+    pcap.close();
+    return ESP_OK;
+}
@@ -0,0 +1,97 @@
+#ifndef PCAP_INDEX_H
+#define PCAP_INDEX_H
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * pcap_index.h: sidecar index of the interesting records in a capture
+ *
+ * Next to eapolscan_N.pcap the writer keeps eapolscan_N.idx, a header
+ * followed by fixed size little endian entries pointing at records:
+ *   PCAP_INDEX_EAPOL    every EAPOL frame, mac is the AP, msg the 4-way number
+ *   PCAP_INDEX_BEACON   the first beacon of each BSSID
+ *   PCAP_INDEX_TIME     the first record every PCAP_INDEX_TIME_S seconds
+ *
+ * Offsets are those of the record header in the uncompressed pcap, they
+ * stay valid after the capture is gzipped. Entries are written out with
+ * the capture checkpoints, after the data they point at, but a reader must
+ * still ignore offsets past the end of a capture cut short by sd_repair.
+ * When the buffer fills up before a checkpoint is due, pcap_logger forces
+ * one (see pcap_index_full()). Only if that fails are entries dropped, and
+ * then PCAP_INDEX_TRUNCATED is set in the header on close: the index is
+ * incomplete and a reader has to fall back to scanning the capture.
+ *
+ * The writer side is called by pcap_logger with its mutex held.
+ */
+
+#define PCAP_INDEX_EXT ".idx"
+#define PCAP_INDEX_MAGIC "PIDX"
+#define PCAP_INDEX_VERSION 2
+#define PCAP_INDEX_TIME_S 10
+#define PCAP_INDEX_BUFFERED 64 // Entries held in RAM between checkpoints
+#define PCAP_INDEX_TRUNCATED 0x0001 // Header flag, entries are missing
+
+typedef enum {
+    PCAP_INDEX_EAPOL = 1,
+    PCAP_INDEX_BEACON = 2,
+    PCAP_INDEX_TIME = 3
+} pcap_index_type_t;
+
+typedef struct {
+    char magic[4];
+    uint16_t version;
+    uint16_t entry_size;
+    uint16_t flags;        // PCAP_INDEX_TRUNCATED
+    uint16_t reserved;
+} __attribute__((packed)) pcap_index_header_t;
+
+typedef struct {
+    uint8_t type;          // pcap_index_type_t
+    uint8_t msg;           // EAPOL message 1-4, 0 otherwise
+    uint8_t mac[6];        // AP or BSSID, zero for time entries
+    uint32_t ts_sec;
+    uint32_t ts_usec;
+    uint32_t offset;       // Record header offset in the capture
+} __attribute__((packed)) pcap_index_entry_t;
+
+/**
+ * @brief Start the index of capture n, an earlier one is closed
+ */
+esp_err_t pcap_index_open(int capture);
+
+/**
+ * @brief Look at a record going into the capture
+ *
+ * @param frame 802.11 frame
+ * @param len Frame length
+ * @param ts_sec Record timestamp
+ * @param ts_usec Record timestamp
+ * @param offset File offset of the record header
+ * @param first_beacon pcap_dedup saw this BSSID for the first time
+ */
+void pcap_index_note(const uint8_t *frame, size_t len, uint32_t ts_sec, uint32_t ts_usec,
+                     uint32_t offset, bool first_beacon);
+
+/**
+ * @brief No room for another entry, the capture should checkpoint first
+ */
+bool pcap_index_full(void);
+
+/**
+ * @brief Write out buffered entries, after the capture data is on the card
+ */
+esp_err_t pcap_index_flush(void);
+
+/**
+ * @brief Flush and close the index
+ */
+void pcap_index_close(void);
+
+/**
+ * @brief Time finding the EAPOL records of capture n via its index and by a full scan
+ */
+esp_err_t pcap_index_bench(int capture);
+
+#endif // PCAP_INDEX_H
@@ -1,6 +1,12 @@
 #include "pcap_logger.h"
 #include "config.h"       // For SD_CS_PIN (if defined there) or other configs
 #include "minigotchi.h"   // For Minigotchi::mood access
+#include "logger.h"
+#include "heap_tracker.h"
+#include "storage_manager.h"
+#include "pcap_dedup.h"
+#include "pcap_index.h"
+#include <esp_heap_caps.h>
 
 #include <SD.h>
 #include <SPI.h>
@@ -14,18 +20,65 @@
 #include <dirent.h> 
 
 
-// Buffer settings
-#define PCAP_BUFFER_SIZE 4096 // Size of the RAM buffer before flushing to SD
+/** developer note:
+ *
+ * FAT on an sd card works in 512 byte sectors, a write that starts or ends
+ * inside a sector makes the library read that sector back first. the file
+ * header goes through the buffer like everything else, so the file offset
+ * of the buffer start is always sector aligned, and a flush only writes the
+ * whole sectors it holds. the tail is moved to the front and goes out with
+ * the next block, only closing the file writes a partial sector.
+ *
+ * a checkpoint writes the tail too and File::flush()es, so the directory
+ * entry holds the new size, then seeks back to the sector boundary and
+ * keeps the tail, the next block simply rewrites that sector. after a
+ * power cut at most PCAP_CHECKPOINT_MS or PCAP_CHECKPOINT_BYTES of
+ * capture is gone, and sd_repair fixes the end of the file at boot.
+ *
+ */
 
 // Static (file scope) variables
-static uint8_t pcap_ram_buffer[PCAP_BUFFER_SIZE];
+static uint8_t *pcap_ram_buffer = NULL;
+static size_t pcap_buffer_size = 0;   // Block size in use, multiple of PCAP_SECTOR_SIZE
 static size_t pcap_buffer_offset = 0;
+static uint32_t pcap_file_pos = 0;    // Bytes of the current file already on the card
 static File current_pcap_file; // Using Arduino SD File object
 static char current_pcap_filename[MAX_PCAP_FILE_NAME_LENGTH];
+static int current_pcap_index = -1;
 static bool pcap_file_is_open = false;
+static pcap_write_stats_t pcap_stats = {};
+static uint32_t pcap_checkpoint_ms = 0;      // millis() of the last checkpoint
+static uint32_t pcap_logged_since_checkpoint = 0;
+static uint32_t pcap_started_ms = 0;         // millis() of the first open, for the dedup rate
+
+typedef enum {
+    PCAP_FLUSH_SECTORS,    // Whole sectors only, the tail is carried
+    PCAP_FLUSH_CHECKPOINT, // Everything, then seek back and keep the tail
+    PCAP_FLUSH_ALL         // Everything, the file is being closed
+} pcap_flush_mode_t;
 
 static SemaphoreHandle_t pcap_mutex = NULL;
 
+/**
+ * Allocates the block buffer, halving the configured size until it fits
+ */
+static esp_err_t pcap_alloc_buffer() {
+    size_t size = constrain(Config::pcapBlockSize, PCAP_BLOCK_MIN, PCAP_BLOCK_MAX);
+    size -= size % PCAP_SECTOR_SIZE;
+    while (pcap_ram_buffer == NULL && size >= PCAP_BLOCK_MIN) {
+        pcap_ram_buffer = (uint8_t *)heap_track_malloc(HEAP_TAG_PCAP, size, MALLOC_CAP_8BIT);
+        if (pcap_ram_buffer == NULL) {
+            size /= 2;
+        }
+    }
+    if (pcap_ram_buffer == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    pcap_buffer_size = size;
+    pcap_stats.block_size = size;
+    return ESP_OK;
+}
+
 // Helper to get next file index (adapted from Ghost ESP32 example, using SD library methods)
 static int get_next_pcap_file_index(const char *base_path, const char *base_filename) {
     int max_index = -1;
@@ -76,6 +129,15 @@ esp_err_t pcap_logger_init(void) {
         return ESP_OK; 
     }
 
+    if (pcap_ram_buffer == NULL && pcap_alloc_buffer() != ESP_OK) {
+        Serial.println(Minigotchi::getMood().getBroken() + " Failed to allocate PCAP buffer!");
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (pcap_dedup_init() != ESP_OK) {
+        LOGW("pcap", "No room for the beacon dedup table, capturing every beacon");
+    }
+
     pcap_mutex = xSemaphoreCreateMutex();
     if (pcap_mutex == NULL) {
         Serial.println(Minigotchi::getMood().getBroken() + " Failed to create PCAP mutex!");
@@ -97,10 +159,8 @@ esp_err_t pcap_logger_init(void) {
     return ESP_OK;
 }
 
-// Renamed to avoid conflict if pcap_write_global_header is also global elsewhere
-static esp_err_t write_pcap_global_header_to_file(File f) {
-    if (!f) return ESP_FAIL;
-
+// Goes into the buffer, so the file starts on a sector boundary
+static void buffer_pcap_global_header() {
     pcap_global_header_t header;
     header.magic_number = PCAP_MAGIC_NUMBER;
     header.version_major = PCAP_VERSION_MAJOR;
@@ -110,8 +170,100 @@ static esp_err_t write_pcap_global_header_to_file(File f) {
     header.snaplen = 65535; 
     header.network = DLT_IEEE802_11_RADIO;
 
-    size_t written = f.write((const uint8_t*)&header, sizeof(pcap_global_header_t));
-    return (written == sizeof(pcap_global_header_t)) ? ESP_OK : ESP_FAIL;
+    memcpy(pcap_ram_buffer, &header, sizeof(pcap_global_header_t));
+    pcap_buffer_offset = sizeof(pcap_global_header_t);
+}
+
+/**
+ * Writes the buffer to the card. Call with pcap_mutex held.
+ * @param mode How much to write and what to keep, see pcap_flush_mode_t
+ */
+static esp_err_t pcap_flush_locked(pcap_flush_mode_t mode) {
+    size_t aligned = pcap_buffer_offset - pcap_buffer_offset % PCAP_SECTOR_SIZE;
+    size_t len = mode == PCAP_FLUSH_SECTORS ? aligned : pcap_buffer_offset;
+    if (len == 0) {
+        return ESP_OK;
+    }
+    if (!current_pcap_file) {
+        LOGE("pcap", "Flush error, file not actually open object.");
+        return ESP_FAIL;
+    }
+
+    size_t written = current_pcap_file.write(pcap_ram_buffer, len);
+
+    uint32_t start = pcap_file_pos;
+    if (written != len) {
+        // part of a record may be on the card now, put the position back so
+        // the next flush writes the whole buffer over it again
+        LOGE("pcap", "Failed to write complete buffer to SD. Written: %u of %u", (unsigned)written, (unsigned)len);
+        if (!current_pcap_file.seek(start)) {
+            // the file ends mid-record and can't be rewound, start a new one
+            // on the next sniffer start rather than append after the garbage
+            LOGE("pcap", "Seek back to %u failed, closing %s", (unsigned)start, current_pcap_filename);
+            current_pcap_file.close();
+            pcap_index_close();
+            pcap_buffer_offset = 0;
+            pcap_file_is_open = false;
+            current_pcap_index = -1;
+        }
+        return ESP_FAIL;
+    }
+
+    uint32_t end = pcap_file_pos + written;
+    pcap_stats.sd_writes++;
+    pcap_stats.bytes_written += written;
+    pcap_stats.sectors_written += (end + PCAP_SECTOR_SIZE - 1) / PCAP_SECTOR_SIZE -
+                                  pcap_file_pos / PCAP_SECTOR_SIZE;
+    if (pcap_file_pos % PCAP_SECTOR_SIZE != 0) {
+        pcap_stats.partial_sectors++;
+    }
+    if (end % PCAP_SECTOR_SIZE != 0) {
+        pcap_stats.partial_sectors++;
+    }
+    pcap_file_pos = end;
+
+    if (mode == PCAP_FLUSH_CHECKPOINT) {
+        current_pcap_file.flush();
+        pcap_index_flush(); // entries only ever follow the data they point at
+        pcap_stats.checkpoints++;
+        pcap_checkpoint_ms = millis();
+        pcap_logged_since_checkpoint = 0;
+        if (aligned < len) {
+            // the partial sector is on the card now, rewrite it with the next block
+            pcap_stats.bytes_rewritten += len - aligned;
+            pcap_file_pos = start + aligned;
+            if (!current_pcap_file.seek(pcap_file_pos)) {
+                LOGE("pcap", "Seek back to %u failed after checkpoint", (unsigned)pcap_file_pos);
+                pcap_file_pos = end;
+                pcap_buffer_offset = 0;
+                return ESP_FAIL;
+            }
+        }
+        len = aligned;
+    }
+
+    size_t tail = pcap_buffer_offset - len;
+    if (tail > 0 && mode != PCAP_FLUSH_ALL) {
+        memmove(pcap_ram_buffer, pcap_ram_buffer + len, tail);
+        pcap_stats.tails_carried++;
+    }
+    pcap_buffer_offset = mode == PCAP_FLUSH_ALL ? 0 : tail;
+    LOGD("pcap", "Flushed %u bytes to %s, %u carried", (unsigned)len, current_pcap_filename, (unsigned)tail);
+    return ESP_OK;
+}
+
+/**
+ * Checkpoints once the time or byte bound is reached. Call with pcap_mutex held.
+ */
+static esp_err_t pcap_checkpoint_if_due_locked() {
+    if (pcap_logged_since_checkpoint == 0) {
+        return ESP_OK;
+    }
+    if (pcap_logged_since_checkpoint < PCAP_CHECKPOINT_BYTES &&
+        millis() - pcap_checkpoint_ms < PCAP_CHECKPOINT_MS) {
+        return ESP_OK;
+    }
+    return pcap_flush_locked(PCAP_FLUSH_CHECKPOINT);
 }
 
 esp_err_t pcap_logger_open_new_file(void) {
@@ -119,6 +271,8 @@ esp_err_t pcap_logger_open_new_file(void) {
         pcap_logger_close_file(); 
     }
 
+    storage_make_room(); // may delete old captures, the new one gets a higher index
+
     if (xSemaphoreTake(pcap_mutex, portMAX_DELAY) != pdTRUE) {
         Serial.println(Minigotchi::getMood().getBroken() + " PCAP: Could not take mutex for opening file.");
         return ESP_ERR_TIMEOUT;
@@ -135,23 +289,22 @@ esp_err_t pcap_logger_open_new_file(void) {
         return ESP_FAIL;
     }
 
-    if (write_pcap_global_header_to_file(current_pcap_file) != ESP_OK) {
-        Serial.println(Minigotchi::getMood().getBroken() + " Failed to write global PCAP header to: " + String(current_pcap_filename));
-        current_pcap_file.close();
-        xSemaphoreGive(pcap_mutex);
-        return ESP_FAIL;
+    current_pcap_index = next_index;
+    pcap_file_pos = 0;
+    pcap_dedup_reset(); // every file keeps its own first beacons
+    pcap_index_open(next_index);
+    if (pcap_started_ms == 0) {
+        pcap_started_ms = millis();
     }
-
-    pcap_buffer_offset = 0; 
+    buffer_pcap_global_header();
+    pcap_checkpoint_ms = millis();
+    pcap_logged_since_checkpoint = pcap_buffer_offset;
     pcap_file_is_open = true;
     Serial.println(Minigotchi::getMood().getHappy() + " Opened new PCAP file: " + String(current_pcap_filename));
     xSemaphoreGive(pcap_mutex);
     return ESP_OK;
 }
 
-// Forward declaration for use in close_file if buffer needs flushing
-esp_err_t pcap_logger_flush_buffer(void); 
-
 void pcap_logger_close_file(void) {
     if (!pcap_file_is_open) return;
 
@@ -159,87 +312,70 @@ void pcap_logger_close_file(void) {
         Serial.println(Minigotchi::getMood().getBroken() + " PCAP: Could not take mutex for closing file.");
         return;
     }
-    
+
     if (pcap_buffer_offset > 0) {
-        xSemaphoreGive(pcap_mutex); // Release mutex before calling flush
-        Serial.println(Minigotchi::getMood().getNeutral() + " Flushing remaining PCAP buffer before closing file...");
-        esp_err_t flush_err = pcap_logger_flush_buffer();
+        // the end of the file is the one place a partial sector is written
+        esp_err_t flush_err = pcap_flush_locked(PCAP_FLUSH_ALL);
         if (flush_err != ESP_OK) {
              Serial.println(Minigotchi::getMood().getBroken() + " PCAP: Error flushing buffer during close: " + String(esp_err_to_name(flush_err)));
         }
-        if (xSemaphoreTake(pcap_mutex, pdMS_TO_TICKS(5000)) != pdTRUE) { // Re-acquire
-            Serial.println(Minigotchi::getMood().getBroken() + " PCAP: Could not re-take mutex for closing file after flush.");
-            // Fall through to try and close file anyway, but log error
-        }
     }
 
     if (current_pcap_file) {
         current_pcap_file.close();
         Serial.println(Minigotchi::getMood().getHappy() + " Closed PCAP file: " + String(current_pcap_filename));
     }
+    pcap_index_close();
+    pcap_buffer_offset = 0;
     pcap_file_is_open = false;
-    // Only give mutex if it was successfully taken and not given up by an error path
-    if (pcap_mutex != NULL && xSemaphoreGetMutexHolder(pcap_mutex) == xTaskGetCurrentTaskHandle()) {
-       xSemaphoreGive(pcap_mutex);
-    }
+    current_pcap_index = -1;
+    xSemaphoreGive(pcap_mutex);
 }
 
 esp_err_t pcap_logger_flush_buffer(void) {
-    if (pcap_buffer_offset == 0) { // Also check if file is open
-        return ESP_OK; 
+    if (pcap_buffer_offset < PCAP_SECTOR_SIZE) {
+        return ESP_OK; // nothing but a partial sector, keep it for the next block
     }
     if (!pcap_file_is_open) { // Added check
-        Serial.println(Minigotchi::getMood().getNeutral() + " PCAP: Flush called but file not open.");
+        LOGD("pcap", "Flush called but file not open.");
         return ESP_OK;
     }
 
-
     if (xSemaphoreTake(pcap_mutex, pdMS_TO_TICKS(5000)) != pdTRUE) { // Increased timeout
-        Serial.println(Minigotchi::getMood().getBroken() + " PCAP: Could not take mutex for flushing buffer.");
+        LOGE("pcap", "Could not take mutex for flushing buffer.");
         return ESP_ERR_TIMEOUT;
     }
-
-    if (!current_pcap_file) { 
-         Serial.println(Minigotchi::getMood().getBroken() + " PCAP: Flush error, file not actually open object.");
-         xSemaphoreGive(pcap_mutex);
-         return ESP_FAIL;
-    }
-
-    size_t written = current_pcap_file.write(pcap_ram_buffer, pcap_buffer_offset);
-    if (written != pcap_buffer_offset) {
-        Serial.println(Minigotchi::getMood().getBroken() + " PCAP: Failed to write complete buffer to SD. Written: " + String(written) + " of " + String(pcap_buffer_offset));
-        pcap_buffer_offset = 0; 
-        xSemaphoreGive(pcap_mutex);
-        return ESP_FAIL;
-    }
-    
-    // current_pcap_file.flush(); // SD.h File.flush() can be time-consuming; use if essential for immediate write
-
-    Serial.println(Minigotchi::getMood().getNeutral() + " Flushed " + String(pcap_buffer_offset) + " bytes to " + String(current_pcap_filename));
-    pcap_buffer_offset = 0;
+    esp_err_t err = pcap_flush_locked(PCAP_FLUSH_SECTORS);
     xSemaphoreGive(pcap_mutex);
-    return ESP_OK;
+    return err;
 }
 
 esp_err_t pcap_logger_write_packet(const void *packet_payload, size_t length) {
     if (packet_payload == NULL || length == 0) {
         return ESP_ERR_INVALID_ARG;
     }
-    // If file isn't open, try to open one. This makes it more robust if capture starts before explicit open.
+    // No opening from here: this runs in the WiFi callback, and opening
+    // waits on storage_make_room() and the card. wifi_sniffer_start() opens
+    // the file before the callback is installed.
     if (!pcap_file_is_open) {
-        Serial.println(Minigotchi::getMood().getNeutral() + " PCAP: File not open, attempting to open new file before writing packet.");
-        if (pcap_logger_open_new_file() != ESP_OK) {
-            Serial.println(Minigotchi::getMood().getBroken() + " PCAP: Failed to auto-open file. Packet not written.");
-            return ESP_FAIL;
-        }
+        return ESP_ERR_INVALID_STATE;
     }
 
-
     if (xSemaphoreTake(pcap_mutex, portMAX_DELAY) != pdTRUE) {
-        Serial.println(Minigotchi::getMood().getBroken() + " PCAP: Could not take mutex for writing packet.");
+        LOGE("pcap", "Could not take mutex for writing packet.");
         return ESP_ERR_TIMEOUT;
     }
 
+    size_t total_packet_size_in_buffer = sizeof(pcap_packet_header_t) + RADIOTAP_HEADER_LEN + length;
+
+    pcap_dedup_verdict_t verdict = pcap_dedup_check((const uint8_t *)packet_payload, length);
+    if (verdict == PCAP_DEDUP_DROP) {
+        pcap_stats.frames_deduped++;
+        pcap_stats.bytes_deduped += total_packet_size_in_buffer;
+        xSemaphoreGive(pcap_mutex);
+        return ESP_OK;
+    }
+
     struct timeval tv;
     gettimeofday(&tv, NULL); 
 
@@ -249,30 +385,31 @@ esp_err_t pcap_logger_write_packet(const void *packet_payload, size_t length) {
     pkt_header.incl_len = RADIOTAP_HEADER_LEN + length; 
     pkt_header.orig_len = RADIOTAP_HEADER_LEN + length;
 
-    size_t total_packet_size_in_buffer = sizeof(pcap_packet_header_t) + RADIOTAP_HEADER_LEN + length;
-
-    if (pcap_buffer_offset + total_packet_size_in_buffer > PCAP_BUFFER_SIZE) {
-        xSemaphoreGive(pcap_mutex); 
-        esp_err_t flush_err = pcap_logger_flush_buffer();
+    if (pcap_buffer_offset + total_packet_size_in_buffer > pcap_buffer_size) {
+        esp_err_t flush_err = pcap_flush_locked(PCAP_FLUSH_SECTORS);
         if (flush_err != ESP_OK) {
-            // If flush fails, re-take mutex before returning to maintain consistent state for caller
-            if (xSemaphoreTake(pcap_mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
-                 Serial.println(Minigotchi::getMood().getBroken() + " PCAP: Could not re-take mutex after failed flush in write_packet.");
-            }
-            return flush_err; 
-        }
-        if (xSemaphoreTake(pcap_mutex, portMAX_DELAY) != pdTRUE) { 
-             Serial.println(Minigotchi::getMood().getBroken() + " PCAP: Could not re-take mutex after flushing.");
-             return ESP_ERR_TIMEOUT;
+            xSemaphoreGive(pcap_mutex);
+            return flush_err;
         }
     }
-    
-    if (total_packet_size_in_buffer > PCAP_BUFFER_SIZE) {
-        Serial.println(Minigotchi::getMood().getBroken() + " PCAP Error: Packet too large for buffer (" + String(total_packet_size_in_buffer) + " bytes).");
+
+    // a carried tail is under one sector, so this only trips on huge frames
+    if (pcap_buffer_offset + total_packet_size_in_buffer > pcap_buffer_size) {
+        LOGE("pcap", "Packet too large for buffer (%u bytes).", (unsigned)total_packet_size_in_buffer);
         xSemaphoreGive(pcap_mutex);
         return ESP_ERR_NO_MEM;
     }
 
+    // a full index would have to drop this entry, write out the records its
+    // entries point at so it can follow them onto the card
+    if (pcap_index_full()) {
+        pcap_flush_locked(PCAP_FLUSH_CHECKPOINT);
+    }
+
+    // the buffer starts at pcap_file_pos in the file
+    pcap_index_note((const uint8_t *)packet_payload, length, pkt_header.ts_sec, pkt_header.ts_usec,
+                    pcap_file_pos + pcap_buffer_offset, verdict == PCAP_DEDUP_FIRST);
+
     memcpy(pcap_ram_buffer + pcap_buffer_offset, &pkt_header, sizeof(pcap_packet_header_t));
     pcap_buffer_offset += sizeof(pcap_packet_header_t);
 
@@ -282,9 +419,24 @@ esp_err_t pcap_logger_write_packet(const void *packet_payload, size_t length) {
 
     memcpy(pcap_ram_buffer + pcap_buffer_offset, packet_payload, length);
     pcap_buffer_offset += length;
+    pcap_stats.bytes_logged += total_packet_size_in_buffer;
+    pcap_logged_since_checkpoint += total_packet_size_in_buffer;
 
+    esp_err_t err = pcap_checkpoint_if_due_locked();
     xSemaphoreGive(pcap_mutex);
-    return ESP_OK;
+    return err;
+}
+
+esp_err_t pcap_logger_checkpoint(void) {
+    if (!pcap_file_is_open || pcap_mutex == NULL) {
+        return ESP_OK;
+    }
+    if (xSemaphoreTake(pcap_mutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+    esp_err_t err = pcap_file_is_open ? pcap_checkpoint_if_due_locked() : ESP_OK;
+    xSemaphoreGive(pcap_mutex);
+    return err;
 }
 
 void pcap_logger_deinit(void) {
@@ -312,6 +464,10 @@ void pcap_logger_deinit(void) {
                  vSemaphoreDelete(pcap_mutex);
                  pcap_mutex = NULL;
             }
+            heap_track_free(HEAP_TAG_PCAP, pcap_ram_buffer);
+            pcap_ram_buffer = NULL;
+            pcap_dedup_deinit();
+            pcap_buffer_size = 0;
             Serial.println(Minigotchi::getMood().getNeutral() + " PCAP Logger de-initialized.");
         } else {
             Serial.println(Minigotchi::getMood().getBroken() + " PCAP: Could not re-take mutex for final deletion in deinit. Mutex NOT deleted.");
@@ -321,3 +477,38 @@ void pcap_logger_deinit(void) {
         Serial.println(Minigotchi::getMood().getBroken() + " PCAP: Could not take mutex for deinit. File may not be closed. Mutex NOT deleted.");
     }
 }
+
+void pcap_logger_get_stats(pcap_write_stats_t *out) {
+    if (pcap_mutex != NULL && xSemaphoreTake(pcap_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+        *out = pcap_stats;
+        xSemaphoreGive(pcap_mutex);
+    } else {
+        *out = pcap_stats;
+    }
+}
+
+void pcap_logger_print_stats(void) {
+    pcap_write_stats_t st;
+    pcap_logger_get_stats(&st);
+    // every partial sector costs the card a read before the write
+    uint64_t moved = (uint64_t)(st.sectors_written + st.partial_sectors) * PCAP_SECTOR_SIZE;
+    unsigned amp = st.bytes_logged ? (unsigned)(moved * 100 / st.bytes_logged) : 0;
+    Serial.printf("[PCAP] block: %u, logged: %llu, written: %llu in %u writes, sectors: %u, partial: %u, tails carried: %u, checkpoints: %u (%llu rewritten), amplification: %u.%02ux\n",
+                  (unsigned)st.block_size, st.bytes_logged, st.bytes_written, st.sd_writes,
+                  st.sectors_written, st.partial_sectors, st.tails_carried, st.checkpoints,
+                  st.bytes_rewritten, amp / 100, amp % 100);
+
+    uint32_t used, overflows;
+    pcap_dedup_usage(&used, &overflows);
+    uint32_t elapsed = pcap_started_ms ? millis() - pcap_started_ms : 0;
+    uint64_t per_hour = elapsed ? st.bytes_deduped * 3600000ULL / elapsed : 0;
+    unsigned saved = st.bytes_logged + st.bytes_deduped
+                         ? (unsigned)(st.bytes_deduped * 1000 / (st.bytes_logged + st.bytes_deduped)) : 0;
+    Serial.printf("[PCAP] dedup: %u frames, %llu bytes left out (%u.%u%%, %llu KB/h), %u BSSIDs in file, %u table misses\n",
+                  st.frames_deduped, st.bytes_deduped, saved / 10, saved % 10, per_hour / 1024,
+                  used, overflows);
+}
+
+int pcap_logger_current_index(void) {
+    return current_pcap_index;
+}
@@ -37,6 +37,27 @@ typedef struct {
   uint32_t orig_len;       // Actual length of packet (on the wire)
 } pcap_packet_header_t;
 
+// SD write path
+#define PCAP_SECTOR_SIZE 512
+#define PCAP_BLOCK_MIN 4096   // Must hold a tail plus the largest frame
+#define PCAP_BLOCK_MAX 32768
+#define PCAP_CHECKPOINT_MS 5000       // Longest time captured data stays off the card
+#define PCAP_CHECKPOINT_BYTES 32768   // Most captured bytes between two checkpoints
+
+typedef struct {
+    size_t block_size;         // Buffer size actually allocated
+    uint64_t bytes_logged;     // Record bytes accepted into the buffer
+    uint64_t bytes_written;    // Bytes handed to the card
+    uint32_t sd_writes;        // File::write() calls
+    uint32_t sectors_written;  // Sectors touched by those writes
+    uint32_t partial_sectors;  // Sectors only partly covered, each needs a read-modify-write
+    uint32_t tails_carried;    // Flushes that left a partial sector for the next block
+    uint32_t checkpoints;      // Full writes plus File::flush() for crash consistency
+    uint64_t bytes_rewritten;  // Partial sectors written by a checkpoint and again later
+    uint32_t frames_deduped;   // Repeated beacons and probe responses left out
+    uint64_t bytes_deduped;    // Record bytes they would have taken
+} pcap_write_stats_t;
+
 // Radiotap constants
 #define RADIOTAP_HEADER_LEN 8 // Minimal radiotap header (version, pad, len, present_flags)
 
@@ -44,8 +65,12 @@ typedef struct {
 esp_err_t pcap_logger_init(void); // Initializes mutex, checks/creates PCAP directory
 esp_err_t pcap_logger_open_new_file(void);
 void pcap_logger_close_file(void);
-esp_err_t pcap_logger_write_packet(const void *packet_payload, size_t length);
+esp_err_t pcap_logger_write_packet(const void *packet_payload, size_t length); // ESP_ERR_INVALID_STATE if no file is open
 esp_err_t pcap_logger_flush_buffer(void); // Made public for explicit flush if needed
+esp_err_t pcap_logger_checkpoint(void); // Checkpoint if PCAP_CHECKPOINT_MS has passed, for quiet periods
 void pcap_logger_deinit(void); // Cleans up (closes file, deletes mutex)
+void pcap_logger_get_stats(pcap_write_stats_t *out);
+int pcap_logger_current_index(void); // Index of the open file, -1 if none
+void pcap_logger_print_stats(void); // Write counters and amplification
 
 #endif // PCAP_LOGGER_H
@@ -48,10 +48,13 @@ class Pwnagotchi {
 public:
   static void detect();
   static void pwnagotchiCallback(void *buf, wifi_promiscuous_pkt_type_t type);
+  static void inspectBeacon(const uint8_t *payload, int len, int8_t rssi);
+  static bool processPending();
   static void stop_scan();
   static bool is_scanning();
   static TaskHandle_t pwnagotchi_scan_task_handle;
   static bool pwnagotchiDetected;
+  static uint32_t peersSeen; // Friends reported since boot
 
 private:
   static Mood &mood;
@@ -0,0 +1,152 @@
+#include "scheduler.h"
+#include "logger.h"
+#include <Arduino.h>
+
+/** developer note:
+ *
+ * loop() used to run cycle(), detect() and advertise() back to back with
+ * their own sleeps, so a long advertising burst held up detection and the
+ * stats for its whole length, and hopping ran on every pass no matter what.
+ * every activity now has a deadline and only due ones run, earliest first.
+ * a late activity is never run twice to catch up, its next deadline is
+ * simply one period after the run.
+ *
+ */
+
+typedef struct {
+    sched_fn_t fn;
+    uint32_t period_ms;
+    uint32_t budget_ms;
+    uint32_t deadline_ms;
+    bool exclusive_radio;
+    sched_stats_t stats;
+} sched_activity_t;
+
+static sched_activity_t sched_activities[SCHED_MAX_ACTIVITIES];
+static int sched_count = 0;
+static uint32_t sched_min_recon_ms = 0;
+
+// Radio lease accounting, recon holds it unless an exclusive activity runs
+static uint32_t sched_recon_since_ms = 0;
+static uint32_t sched_started_ms = 0;
+static uint64_t sched_exclusive_ms = 0;
+
+static bool sched_before(uint32_t a, uint32_t b) { return (int32_t)(a - b) < 0; }
+
+int sched_add(const char *name, sched_fn_t fn, uint32_t period_ms, uint32_t budget_ms,
+              bool exclusive_radio) {
+    if (sched_count >= SCHED_MAX_ACTIVITIES || fn == NULL) {
+        LOGE("sched", "Activity %s not registered (%d of %d slots used)", name, sched_count,
+             SCHED_MAX_ACTIVITIES);
+        return -1;
+    }
+    uint32_t now = millis();
+    if (sched_count == 0) {
+        sched_started_ms = now;
+        sched_recon_since_ms = now;
+    }
+    sched_activity_t &a = sched_activities[sched_count];
+    a.fn = fn;
+    a.period_ms = period_ms;
+    a.budget_ms = budget_ms;
+    a.deadline_ms = now + period_ms;
+    a.exclusive_radio = exclusive_radio;
+    a.stats = {};
+    a.stats.name = name;
+    return sched_count++;
+}
+
+void sched_set_period(int id, uint32_t period_ms) {
+    if (id >= 0 && id < sched_count) {
+        sched_activities[id].period_ms = period_ms;
+    }
+}
+
+void sched_set_min_recon(uint32_t min_recon_ms) { sched_min_recon_ms = min_recon_ms; }
+
+uint32_t sched_run_once() {
+    uint32_t now = millis();
+    uint32_t radio_free_ms = sched_recon_since_ms + sched_min_recon_ms;
+
+    // earliest due deadline wins, exclusive activities wait for the lease
+    sched_activity_t *next = NULL;
+    for (int i = 0; i < sched_count; i++) {
+        sched_activity_t &a = sched_activities[i];
+        if (sched_before(now, a.deadline_ms)) {
+            continue;
+        }
+        if (a.exclusive_radio && sched_before(now, radio_free_ms)) {
+            a.deadline_ms = radio_free_ms;
+            a.stats.deferred++;
+            continue;
+        }
+        if (next == NULL || sched_before(a.deadline_ms, next->deadline_ms)) {
+            next = &a;
+        }
+    }
+
+    if (next != NULL) {
+        uint32_t late = now - next->deadline_ms;
+        next->fn();
+        uint32_t end = millis();
+        uint32_t ran = end - now;
+
+        sched_stats_t &s = next->stats;
+        s.runs++;
+        s.total_run_ms += ran;
+        if (ran > s.max_run_ms) {
+            s.max_run_ms = ran;
+        }
+        if (late > s.max_late_ms) {
+            s.max_late_ms = late;
+        }
+        if (ran > next->budget_ms) {
+            s.overruns++;
+        }
+        if (next->exclusive_radio) {
+            sched_exclusive_ms += ran;
+            sched_recon_since_ms = end; // recon gets the radio back now
+        }
+        next->deadline_ms = end + next->period_ms;
+        now = end;
+    }
+
+    uint32_t wait = SCHED_MAX_IDLE_MS;
+    for (int i = 0; i < sched_count; i++) {
+        uint32_t deadline = sched_activities[i].deadline_ms;
+        if (!sched_before(now, deadline)) {
+            return 0;
+        }
+        if (deadline - now < wait) {
+            wait = deadline - now;
+        }
+    }
+    return wait;
+}
+
+void sched_get_stats(int id, sched_stats_t *out) {
+    if (id >= 0 && id < sched_count) {
+        *out = sched_activities[id].stats;
+    }
+}
+
+void sched_print_stats() {
+    uint32_t now = millis();
+    uint32_t uptime = now - sched_started_ms;
+    Serial.println("[SCHED] activity   period  budget   runs  over  defer  max ms  late ms  avg ms");
+    for (int i = 0; i < sched_count; i++) {
+        const sched_activity_t &a = sched_activities[i];
+        const sched_stats_t &s = a.stats;
+        Serial.printf("[SCHED] %-10s %6lu %7lu %6u %5u %6u %7u %8u %7lu%s\n", s.name,
+                      (unsigned long)a.period_ms, (unsigned long)a.budget_ms, s.runs,
+                      s.overruns, s.deferred, s.max_run_ms, s.max_late_ms,
+                      s.runs ? (unsigned long)(s.total_run_ms / s.runs) : 0UL,
+                      a.exclusive_radio ? "  (radio)" : "");
+    }
+    if (uptime > 0) {
+        unsigned exclusive = (unsigned)(sched_exclusive_ms * 100 / uptime);
+        Serial.printf("[SCHED] radio: recon %u%%, exclusive %u%%, min recon %lu ms\n",
+                      exclusive <= 100 ? 100 - exclusive : 0, exclusive,
+                      (unsigned long)sched_min_recon_ms);
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+
+/**
+ * scheduler.h: deadline driven main loop scheduler
+ *
+ * Activities are registered with a period and a time budget. Every call to
+ * sched_run_once() runs the due activity with the earliest deadline, so a
+ * slow activity delays the others by one run instead of a whole pass.
+ *
+ * The radio has one lease. Recon (sniffer plus hopper) holds it by default,
+ * activities registered with exclusive_radio take it over, e.g. advertising
+ * in AP mode. An exclusive activity only starts once recon has held the
+ * radio for min_recon_ms since the last exclusive run, anything due earlier
+ * is pushed back to that point.
+ */
+
+#define SCHED_MAX_ACTIVITIES 16 // scheduleActivities() registers 9, leave room
+#define SCHED_MAX_IDLE_MS 100 // Longest sleep, serial and parasite are polled between runs
+
+typedef void (*sched_fn_t)();
+
+typedef struct {
+    const char *name;
+    uint32_t runs;
+    uint32_t overruns;      // Runs longer than the budget
+    uint32_t deferred;      // Times the radio lease pushed the deadline back
+    uint32_t max_run_ms;
+    uint32_t max_late_ms;   // Worst start past the deadline
+    uint64_t total_run_ms;
+} sched_stats_t;
+
+/**
+ * @brief Register an activity, the first deadline is one period from now
+ *
+ * @param name Shown in the stats, must outlive the scheduler
+ * @param fn Activity body
+ * @param period_ms Time between deadlines
+ * @param budget_ms Expected run time, longer runs count as overruns
+ * @param exclusive_radio Activity takes the radio away from recon
+ * @return Activity id, -1 if the table is full
+ */
+int sched_add(const char *name, sched_fn_t fn, uint32_t period_ms, uint32_t budget_ms,
+              bool exclusive_radio);
+
+/**
+ * @brief Change the period of an activity, applies from its next deadline
+ */
+void sched_set_period(int id, uint32_t period_ms);
+
+/**
+ * @brief Minimum recon time between two exclusive radio activities
+ */
+void sched_set_min_recon(uint32_t min_recon_ms);
+
+/**
+ * @brief Run the due activity with the earliest deadline, if any
+ *
+ * @return Milliseconds until the next deadline, at most SCHED_MAX_IDLE_MS
+ */
+uint32_t sched_run_once();
+
+/**
+ * @brief Copy the counters of an activity
+ */
+void sched_get_stats(int id, sched_stats_t *out);
+
+/**
+ * @brief Print per-activity counters and radio utilization
+ */
+void sched_print_stats();
+
+#endif // SCHEDULER_H
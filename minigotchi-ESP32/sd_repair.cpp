@@ -0,0 +1,197 @@
+#include "sd_repair.h"
+#include "handshake_logger.h"
+#include "heap_tracker.h"
+#include "mood.h"
+#include "pcap_logger.h"
+#include <Arduino.h>
+#include <SD.h>
+#include <esp_heap_caps.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SD_REPAIR_CHUNK 4096      // Read size while walking record headers
+#define SD_REPAIR_CSV_TAIL 256    // Longest CSV line we look back for
+#define SD_REPAIR_MAX_RECORD 65535
+
+int sd_latest_index(const char *dir, const char *base) {
+    File d = SD.open(dir);
+    if (!d || !d.isDirectory()) {
+        return -1;
+    }
+    size_t base_len = strlen(base);
+    int latest = -1;
+    File f = d.openNextFile();
+    while (f) {
+        const char *name = f.name();
+        const char *slash = strrchr(name, '/');
+        if (slash != NULL) {
+            name = slash + 1; // older cores return the full path
+        }
+        if (!f.isDirectory() && strncmp(name, base, base_len) == 0 && name[base_len] == '_') {
+            int index = atoi(name + base_len + 1);
+            if (index > latest) {
+                latest = index;
+            }
+        }
+        f.close();
+        f = d.openNextFile();
+    }
+    d.close();
+    return latest;
+}
+
+/**
+ * The SD library has no truncate, go through the VFS underneath it
+ */
+static bool sd_truncate(const char *path, size_t len) {
+    char full[MAX_PCAP_FILE_NAME_LENGTH + sizeof(SD_REPAIR_MOUNT)];
+    snprintf(full, sizeof(full), "%s%s", SD_REPAIR_MOUNT, path);
+    FILE *f = fopen(full, "r+");
+    if (f == NULL) {
+        return false;
+    }
+    bool ok = ftruncate(fileno(f), len) == 0;
+    fclose(f);
+    return ok;
+}
+
+/**
+ * End of the last complete record, 0 if the global header is bad
+ */
+static uint32_t sd_repair_walk_pcap(File &f, uint32_t size, uint32_t *records) {
+    pcap_global_header_t header;
+    if (size < sizeof(header) || f.read((uint8_t *)&header, sizeof(header)) != sizeof(header) ||
+        header.magic_number != PCAP_MAGIC_NUMBER) {
+        return 0;
+    }
+    uint32_t snaplen = header.snaplen ? header.snaplen : SD_REPAIR_MAX_RECORD;
+
+    uint8_t *chunk = (uint8_t *)heap_track_malloc(HEAP_TAG_PCAP, SD_REPAIR_CHUNK, MALLOC_CAP_8BIT);
+    if (chunk == NULL) {
+        return size; // can't check, leave the file alone
+    }
+
+    // chunk holds file bytes [chunk_start, chunk_start + chunk_len), big
+    // frames are skipped with a seek instead of being read
+    uint32_t chunk_start = 0;
+    uint32_t chunk_len = 0;
+    uint32_t pos = sizeof(header);
+    uint32_t good = pos;
+    *records = 0;
+    while (pos + sizeof(pcap_packet_header_t) <= size) {
+        if (pos < chunk_start || pos + sizeof(pcap_packet_header_t) > chunk_start + chunk_len) {
+            if (!f.seek(pos)) {
+                break;
+            }
+            chunk_start = pos;
+            chunk_len = f.read(chunk, SD_REPAIR_CHUNK);
+            if (chunk_len < sizeof(pcap_packet_header_t)) {
+                break;
+            }
+        }
+        pcap_packet_header_t rec;
+        memcpy(&rec, chunk + (pos - chunk_start), sizeof(rec));
+        if (rec.incl_len == 0 || rec.incl_len > snaplen || rec.incl_len > rec.orig_len ||
+            rec.ts_usec >= 1000000) {
+            break; // garbage, everything from here on is suspect
+        }
+        uint32_t next = pos + sizeof(rec) + rec.incl_len;
+        if (next > size) {
+            break; // cut off by the power loss
+        }
+        pos = next;
+        good = next;
+        (*records)++;
+    }
+    heap_track_free(HEAP_TAG_PCAP, chunk);
+    return good;
+}
+
+static esp_err_t sd_repair_pcap(sd_repair_result_t *res) {
+    int index = sd_latest_index(PCAP_DIR, PCAP_BASE_FILENAME);
+    if (index < 0) {
+        return ESP_OK;
+    }
+    char path[MAX_PCAP_FILE_NAME_LENGTH];
+    snprintf(path, sizeof(path), "%s/%s_%d.pcap", PCAP_DIR, PCAP_BASE_FILENAME, index);
+    if (!SD.exists(path)) {
+        return ESP_OK; // already gzipped, only closed captures are
+    }
+
+    File f = SD.open(path, FILE_READ);
+    if (!f) {
+        return ESP_FAIL;
+    }
+    uint32_t size = f.size();
+    uint32_t good = sd_repair_walk_pcap(f, size, &res->pcap_records);
+    f.close();
+
+    if (good == size) {
+        return ESP_OK;
+    }
+    if (good == 0) {
+        Serial.printf("%s %s has no valid header, removing it\n",
+                      Mood::getInstance().getSad().c_str(), path);
+        res->pcap_removed = true;
+        return SD.remove(path) ? ESP_OK : ESP_FAIL;
+    }
+    res->pcap_cut_bytes = size - good;
+    Serial.printf("%s %s ends in a partial record, cutting %u bytes after %u records\n",
+                  Mood::getInstance().getIntense().c_str(), path,
+                  (unsigned)(size - good), (unsigned)res->pcap_records);
+    return sd_truncate(path, good) ? ESP_OK : ESP_FAIL;
+}
+
+static esp_err_t sd_repair_csv(sd_repair_result_t *res) {
+    int index = sd_latest_index(HANDSHAKE_CSV_DIR, HANDSHAKE_CSV_BASE_FILENAME);
+    if (index < 0) {
+        return ESP_OK;
+    }
+    char path[MAX_CSV_FILE_NAME_LENGTH];
+    snprintf(path, sizeof(path), "%s/%s_%d.csv", HANDSHAKE_CSV_DIR, HANDSHAKE_CSV_BASE_FILENAME, index);
+
+    File f = SD.open(path, FILE_READ);
+    if (!f) {
+        return ESP_FAIL;
+    }
+    uint32_t size = f.size();
+    uint32_t tail_len = size < SD_REPAIR_CSV_TAIL ? size : SD_REPAIR_CSV_TAIL;
+    char tail[SD_REPAIR_CSV_TAIL];
+    bool read_ok = tail_len == 0 ||
+                   (f.seek(size - tail_len) && f.read((uint8_t *)tail, tail_len) == tail_len);
+    f.close();
+    if (!read_ok) {
+        return ESP_FAIL;
+    }
+    if (tail_len == 0 || tail[tail_len - 1] == '\n') {
+        return ESP_OK;
+    }
+
+    // keep everything up to the last full line, an entry is one println()
+    int last_newline = -1;
+    for (int i = tail_len - 1; i >= 0; i--) {
+        if (tail[i] == '\n') {
+            last_newline = i;
+            break;
+        }
+    }
+    if (last_newline < 0 && tail_len < size) {
+        return ESP_FAIL; // no line end anywhere near, not something we wrote
+    }
+    uint32_t good = size - tail_len + last_newline + 1;
+    res->csv_cut_bytes = size - good;
+    Serial.printf("%s %s ends in a partial line, cutting %u bytes\n",
+                  Mood::getInstance().getIntense().c_str(), path, (unsigned)(size - good));
+    return sd_truncate(path, good) ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t sd_repair_run(sd_repair_result_t *out) {
+    sd_repair_result_t res = {};
+    esp_err_t pcap_err = sd_repair_pcap(&res);
+    esp_err_t csv_err = sd_repair_csv(&res);
+    if (out != NULL) {
+        *out = res;
+    }
+    return pcap_err != ESP_OK ? pcap_err : csv_err;
+}
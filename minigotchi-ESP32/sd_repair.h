@@ -0,0 +1,41 @@
+#ifndef SD_REPAIR_H
+#define SD_REPAIR_H
+
+#include "esp_err.h"
+#include <stdint.h>
+
+/**
+ * sd_repair.h: boot time repair of capture files
+ *
+ * A power cut can leave the newest capture ending in the middle of a
+ * record. Before anything opens a new file, the newest pcap is walked
+ * record by record and cut after the last complete one, and the newest
+ * handshake CSV is cut after its last full line. Older files were closed
+ * cleanly and are not touched.
+ */
+
+#define SD_REPAIR_MOUNT "/sd" // Where the SD library mounts the card in the VFS
+
+typedef struct {
+    uint32_t pcap_records;    // Complete records found in the newest pcap
+    uint32_t pcap_cut_bytes;  // Bytes cut off its end
+    uint32_t csv_cut_bytes;   // Bytes cut off the newest CSV
+    bool pcap_removed;        // The pcap did not even have a full header
+} sd_repair_result_t;
+
+/**
+ * @brief Repair the newest pcap and handshake CSV, call after mounting
+ *
+ * @param out Optional, what was found and fixed
+ * @return ESP_OK if both files are consistent now (or there were none)
+ */
+esp_err_t sd_repair_run(sd_repair_result_t *out);
+
+/**
+ * @brief Highest index among files named <base>_<index>.<ext> in a directory
+ *
+ * @return The index, -1 if there is none
+ */
+int sd_latest_index(const char *dir, const char *base);
+
+#endif // SD_REPAIR_H
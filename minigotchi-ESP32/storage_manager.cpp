@@ -0,0 +1,472 @@
+#include "storage_manager.h"
+#include "config.h"
+#include "gzip_stream.h"
+#include "handshake_logger.h"
+#include "heap_tracker.h"
+#include "mood.h"
+#include "pcap_index.h"
+#include "pcap_logger.h"
+#include "sd_repair.h"
+#include <Arduino.h>
+#include <SD.h>
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+/** developer note:
+ *
+ * captures are numbered, so the index is the age, there is no RTC to trust
+ * file times. a directory scan folds the .pcap, .pcap.gz and .hs names of
+ * each index into one entry and the lowest index of the wanted kind wins.
+ * compression writes to .pcap.gz.tmp and renames when done, a power cut
+ * just leaves a .tmp that the next scan deletes.
+ *
+ */
+
+#define STORAGE_HAS_PCAP 0x01
+#define STORAGE_HAS_GZ 0x02
+#define STORAGE_HAS_HS 0x04
+#define STORAGE_IDLE_BYTES (16 * 1024) // Capture bytes per step below which the card counts as idle
+
+typedef struct {
+    int32_t index;
+    uint8_t flags;
+} storage_entry_t;
+
+typedef struct {
+    bool active;
+    int index;
+    File in;
+    File out;
+    gz_stream_t *gz;
+    uint64_t busy_us;
+} storage_job_t;
+
+static storage_stats_t storage_stats = {};
+static SemaphoreHandle_t storage_mutex = NULL;
+static storage_job_t storage_job = {};
+static uint32_t storage_checked_ms = 0;
+static bool storage_checked = false;
+static int storage_marked_index = -1;
+static volatile int storage_mark_pending = -1; // Set from the WiFi callback, marker written by storage_step()
+static int storage_skip_index = -1; // Did not compress, don't try again this session
+static uint64_t storage_last_logged = 0;
+static uint8_t storage_io[2048];
+
+static bool storage_lock(TickType_t wait) {
+    if (storage_mutex == NULL) {
+        static portMUX_TYPE init_mutex = portMUX_INITIALIZER_UNLOCKED;
+        SemaphoreHandle_t m = xSemaphoreCreateMutex();
+        portENTER_CRITICAL(&init_mutex);
+        if (storage_mutex == NULL) {
+            storage_mutex = m;
+            m = NULL;
+        }
+        portEXIT_CRITICAL(&init_mutex);
+        if (m != NULL) {
+            vSemaphoreDelete(m);
+        }
+        if (storage_mutex == NULL) {
+            return false;
+        }
+    }
+    return xSemaphoreTake(storage_mutex, wait) == pdTRUE;
+}
+
+static void storage_unlock() { xSemaphoreGive(storage_mutex); }
+
+static void storage_path(char *buf, size_t size, int index, const char *ext) {
+    snprintf(buf, size, "%s/%s_%d%s", PCAP_DIR, PCAP_BASE_FILENAME, index, ext);
+}
+
+/**
+ * Removes a file and counts it as evicted
+ * @return false if there was nothing to remove or the removal failed
+ */
+static bool storage_remove(const char *path) {
+    File f = SD.open(path, FILE_READ);
+    if (!f) {
+        return false;
+    }
+    uint32_t size = f.size();
+    f.close();
+    if (!SD.remove(path)) {
+        return false;
+    }
+    storage_stats.evicted_files++;
+    storage_stats.evicted_bytes += size;
+    return true;
+}
+
+/**
+ * One entry per capture index in PCAP_DIR, leftover .tmp files are deleted
+ */
+static int storage_scan(storage_entry_t *entries, int max) {
+    File dir = SD.open(PCAP_DIR);
+    if (!dir || !dir.isDirectory()) {
+        return 0;
+    }
+    size_t base_len = strlen(PCAP_BASE_FILENAME);
+    int count = 0;
+    File f = dir.openNextFile();
+    while (f) {
+        char name[MAX_PCAP_FILE_NAME_LENGTH];
+        const char *n = f.name();
+        const char *slash = strrchr(n, '/');
+        strlcpy(name, slash ? slash + 1 : n, sizeof(name));
+        bool is_dir = f.isDirectory();
+        f.close();
+
+        const char *ext = NULL;
+        int index = -1;
+        if (!is_dir && strncmp(name, PCAP_BASE_FILENAME, base_len) == 0 && name[base_len] == '_') {
+            index = atoi(name + base_len + 1);
+            ext = strchr(name + base_len + 1, '.');
+        }
+        uint8_t flag = 0;
+        if (ext != NULL) {
+            if (strcmp(ext, ".pcap") == 0) {
+                flag = STORAGE_HAS_PCAP;
+            } else if (strcmp(ext, ".pcap.gz") == 0) {
+                flag = STORAGE_HAS_GZ;
+            } else if (strcmp(ext, ".hs") == 0) {
+                flag = STORAGE_HAS_HS;
+            } else if (strcmp(ext, ".pcap.gz.tmp") == 0 &&
+                       !(storage_job.active && storage_job.index == index)) {
+                char path[MAX_PCAP_FILE_NAME_LENGTH];
+                storage_path(path, sizeof(path), index, ext);
+                SD.remove(path);
+            }
+        }
+        if (flag != 0) {
+            int i = 0;
+            while (i < count && entries[i].index != index) {
+                i++;
+            }
+            if (i == count && count < max) {
+                entries[count].index = index;
+                entries[count].flags = 0;
+                count++;
+            }
+            if (i < count) {
+                entries[i].flags |= flag;
+            }
+        }
+        f = dir.openNextFile();
+    }
+    dir.close();
+    return count;
+}
+
+/**
+ * Lowest index holding data (any of the given flags), handshake ones only
+ * if there is nothing else. The open capture is never picked.
+ */
+static int storage_pick(const storage_entry_t *entries, int count, uint8_t want, int skip) {
+    int current = pcap_logger_current_index();
+    int plain = -1;
+    int hs = -1;
+    for (int i = 0; i < count; i++) {
+        const storage_entry_t &e = entries[i];
+        if (e.index == current || e.index == skip || !(e.flags & want)) {
+            continue;
+        }
+        int &best = (e.flags & STORAGE_HAS_HS) ? hs : plain;
+        if (best < 0 || e.index < best) {
+            best = e.index;
+        }
+    }
+    return plain >= 0 ? plain : hs;
+}
+
+static void storage_abort_job() {
+    if (!storage_job.active) {
+        return;
+    }
+    storage_job.in.close();
+    storage_job.out.close();
+    char path[MAX_PCAP_FILE_NAME_LENGTH];
+    storage_path(path, sizeof(path), storage_job.index, ".pcap.gz.tmp");
+    SD.remove(path);
+    heap_track_free(HEAP_TAG_STORAGE, storage_job.gz);
+    storage_job.gz = NULL;
+    storage_job.active = false;
+}
+
+/**
+ * Oldest handshake CSV, the newest one may still be open
+ */
+static bool storage_evict_csv() {
+    int latest = sd_latest_index(HANDSHAKE_CSV_DIR, HANDSHAKE_CSV_BASE_FILENAME);
+    File dir = SD.open(HANDSHAKE_CSV_DIR);
+    if (!dir || !dir.isDirectory()) {
+        return false;
+    }
+    size_t base_len = strlen(HANDSHAKE_CSV_BASE_FILENAME);
+    int oldest = -1;
+    File f = dir.openNextFile();
+    while (f) {
+        const char *n = f.name();
+        const char *slash = strrchr(n, '/');
+        n = slash ? slash + 1 : n;
+        if (!f.isDirectory() && strncmp(n, HANDSHAKE_CSV_BASE_FILENAME, base_len) == 0 &&
+            n[base_len] == '_') {
+            int index = atoi(n + base_len + 1);
+            if (index != latest && (oldest < 0 || index < oldest)) {
+                oldest = index;
+            }
+        }
+        f.close();
+        f = dir.openNextFile();
+    }
+    dir.close();
+    if (oldest < 0) {
+        return false;
+    }
+    char path[MAX_CSV_FILE_NAME_LENGTH];
+    snprintf(path, sizeof(path), "%s/%s_%d.csv", HANDSHAKE_CSV_DIR, HANDSHAKE_CSV_BASE_FILENAME, oldest);
+    return storage_remove(path);
+}
+
+static bool storage_evict_one() {
+    storage_entry_t *entries = (storage_entry_t *)heap_track_malloc(
+        HEAP_TAG_STORAGE, STORAGE_MAX_FILES * sizeof(storage_entry_t), MALLOC_CAP_8BIT);
+    if (entries == NULL) {
+        return false;
+    }
+    int count = storage_scan(entries, STORAGE_MAX_FILES);
+    int index = storage_pick(entries, count, STORAGE_HAS_PCAP | STORAGE_HAS_GZ, -1);
+    heap_track_free(HEAP_TAG_STORAGE, entries);
+
+    if (index < 0) {
+        return storage_evict_csv();
+    }
+    if (storage_job.active && storage_job.index == index) {
+        storage_abort_job();
+    }
+    char path[MAX_PCAP_FILE_NAME_LENGTH];
+    storage_path(path, sizeof(path), index, ".pcap");
+    bool removed = storage_remove(path);
+    storage_path(path, sizeof(path), index, ".pcap.gz");
+    removed |= storage_remove(path);
+    if (!removed) {
+        // held open (a download) or a card error, the scan would only pick
+        // the same capture again, so give up until the next check
+        LOGW("storage", "Could not delete capture %d, giving up on making room", index);
+        return false;
+    }
+    storage_path(path, sizeof(path), index, PCAP_INDEX_EXT);
+    storage_remove(path);
+    storage_path(path, sizeof(path), index, ".hs");
+    SD.remove(path);
+    Serial.printf("%s Storage low, deleted capture %d\n", Mood::getInstance().getSad().c_str(), index);
+    return true;
+}
+
+static uint64_t storage_min_free() {
+    uint64_t min_free = (uint64_t)Config::storageMinFreeMB * 1024 * 1024;
+    // on a small card the target would mean deleting everything
+    return min_free < storage_stats.total_bytes / 4 ? min_free : storage_stats.total_bytes / 4;
+}
+
+static void storage_refresh() {
+    storage_stats.total_bytes = SD.totalBytes();
+    storage_stats.used_bytes = SD.usedBytes();
+    storage_checked_ms = millis();
+    storage_checked = true;
+}
+
+/**
+ * Writes the .hs marker asked for by storage_mark_handshake(). Call with
+ * storage_mutex held.
+ */
+static void storage_write_marker() {
+    int index = storage_mark_pending;
+    if (index < 0 || index == storage_marked_index) {
+        return;
+    }
+    char path[MAX_PCAP_FILE_NAME_LENGTH];
+    storage_path(path, sizeof(path), index, ".hs");
+    File marker = SD.open(path, FILE_WRITE);
+    if (marker) {
+        marker.close();
+        storage_marked_index = index; // otherwise retried on the next step
+    }
+}
+
+/**
+ * Call with storage_mutex held
+ */
+static esp_err_t storage_make_room_locked() {
+    storage_write_marker(); // a capture with a handshake must not look like a plain one
+    storage_refresh();
+    if (storage_stats.total_bytes == 0) {
+        return ESP_ERR_INVALID_STATE; // no card
+    }
+    while (storage_stats.total_bytes - storage_stats.used_bytes < storage_min_free()) {
+        if (!storage_evict_one()) {
+            return ESP_ERR_NO_MEM;
+        }
+        storage_refresh();
+    }
+    return ESP_OK;
+}
+
+esp_err_t storage_make_room() {
+    if (!storage_lock(portMAX_DELAY)) {
+        return ESP_ERR_TIMEOUT;
+    }
+    esp_err_t err = storage_make_room_locked();
+    storage_unlock();
+    return err;
+}
+
+void storage_mark_handshake() {
+    int index = pcap_logger_current_index();
+    if (index >= 0) {
+        storage_mark_pending = index; // no lock and no card access here, see storage_write_marker()
+    }
+}
+
+static void storage_start_job() {
+    storage_entry_t *entries = (storage_entry_t *)heap_track_malloc(
+        HEAP_TAG_STORAGE, STORAGE_MAX_FILES * sizeof(storage_entry_t), MALLOC_CAP_8BIT);
+    if (entries == NULL) {
+        return;
+    }
+    int count = storage_scan(entries, STORAGE_MAX_FILES);
+    char path[MAX_PCAP_FILE_NAME_LENGTH];
+    for (int i = 0; i < count; i++) {
+        // rename done but the power went before the original was removed
+        if ((entries[i].flags & (STORAGE_HAS_PCAP | STORAGE_HAS_GZ)) ==
+                (STORAGE_HAS_PCAP | STORAGE_HAS_GZ) &&
+            entries[i].index != pcap_logger_current_index()) {
+            storage_path(path, sizeof(path), entries[i].index, ".pcap");
+            SD.remove(path);
+            entries[i].flags &= ~STORAGE_HAS_PCAP;
+        }
+    }
+    int index = storage_pick(entries, count, STORAGE_HAS_PCAP, storage_skip_index);
+    heap_track_free(HEAP_TAG_STORAGE, entries);
+    if (index < 0) {
+        return;
+    }
+
+    storage_job.gz = (gz_stream_t *)heap_track_malloc(HEAP_TAG_STORAGE, sizeof(gz_stream_t), MALLOC_CAP_8BIT);
+    if (storage_job.gz == NULL) {
+        return;
+    }
+    storage_path(path, sizeof(path), index, ".pcap");
+    storage_job.in = SD.open(path, FILE_READ);
+    storage_path(path, sizeof(path), index, ".pcap.gz.tmp");
+    storage_job.out = SD.open(path, FILE_WRITE);
+    storage_job.index = index;
+    storage_job.busy_us = 0;
+    storage_job.active = true;
+    if (!storage_job.in || !storage_job.out) {
+        storage_abort_job();
+        storage_skip_index = index;
+        return;
+    }
+    gz_stream_begin(storage_job.gz, &storage_job.out);
+}
+
+static void storage_finish_job() {
+    gz_stream_t *gz = storage_job.gz;
+    int64_t start = esp_timer_get_time();
+    bool ok = gz_stream_end(gz);
+    storage_job.busy_us += esp_timer_get_time() - start;
+    storage_job.in.close();
+    storage_job.out.close();
+
+    char tmp[MAX_PCAP_FILE_NAME_LENGTH];
+    char path[MAX_PCAP_FILE_NAME_LENGTH];
+    storage_path(tmp, sizeof(tmp), storage_job.index, ".pcap.gz.tmp");
+    if (ok && gz->out_total < gz->in_total) {
+        storage_path(path, sizeof(path), storage_job.index, ".pcap.gz");
+        if (SD.rename(tmp, path)) {
+            storage_path(path, sizeof(path), storage_job.index, ".pcap");
+            SD.remove(path);
+            storage_stats.compressed_files++;
+            storage_stats.compress_in += gz->in_total;
+            storage_stats.compress_out += gz->out_total;
+            storage_stats.compress_us += storage_job.busy_us;
+            LOGI("storage", "Compressed capture %d: %u -> %u bytes in %u ms", storage_job.index,
+                 (unsigned)gz->in_total, (unsigned)gz->out_total,
+                 (unsigned)(storage_job.busy_us / 1000));
+        }
+    } else {
+        SD.remove(tmp);
+        storage_stats.skipped_files++;
+        storage_skip_index = storage_job.index;
+    }
+    heap_track_free(HEAP_TAG_STORAGE, storage_job.gz);
+    storage_job.gz = NULL;
+    storage_job.active = false;
+}
+
+static void storage_compress_slice() {
+    int64_t start = esp_timer_get_time();
+    size_t done = 0;
+    bool eof = false;
+    while (done < STORAGE_SLICE_BYTES) {
+        int n = storage_job.in.read(storage_io, sizeof(storage_io));
+        if (n <= 0) {
+            eof = true;
+            break;
+        }
+        if (!gz_stream_write(storage_job.gz, storage_io, n)) {
+            storage_abort_job(); // card full or gone
+            storage_skip_index = storage_job.index;
+            return;
+        }
+        done += n;
+    }
+    storage_job.busy_us += esp_timer_get_time() - start;
+    if (eof) {
+        storage_finish_job();
+    }
+}
+
+void storage_step() {
+    if (!storage_lock(0)) {
+        return; // someone is making room, try next time
+    }
+    if (!storage_checked || millis() - storage_checked_ms >= STORAGE_CHECK_MS) {
+        storage_make_room_locked();
+    } else {
+        storage_write_marker();
+    }
+
+    // compress only while the capture path leaves the card mostly alone
+    pcap_write_stats_t ps;
+    pcap_logger_get_stats(&ps);
+    bool idle = ps.bytes_logged - storage_last_logged < STORAGE_IDLE_BYTES;
+    storage_last_logged = ps.bytes_logged;
+
+    if (Config::storageCompress && idle && storage_stats.total_bytes > 0) {
+        if (!storage_job.active) {
+            storage_start_job();
+        } else {
+            storage_compress_slice();
+        }
+    }
+    storage_unlock();
+}
+
+void storage_get_stats(storage_stats_t *out) { *out = storage_stats; }
+
+void storage_print_stats() {
+    storage_stats_t s = storage_stats;
+    uint64_t free_bytes = s.total_bytes - s.used_bytes;
+    Serial.printf("[STORAGE] free: %llu MB of %llu MB (keep %llu MB), evicted: %u files, %llu MB\n",
+                  free_bytes >> 20, s.total_bytes >> 20, storage_min_free() >> 20,
+                  s.evicted_files, s.evicted_bytes >> 20);
+    unsigned ratio = s.compress_in ? (unsigned)(s.compress_out * 1000 / s.compress_in) : 0;
+    unsigned ms_per_mb = s.compress_in ? (unsigned)(s.compress_us * 1024 / s.compress_in) : 0;
+    Serial.printf("[STORAGE] compressed: %u files, %llu -> %llu bytes (%u.%u%%), %u ms CPU per MB, skipped: %u%s\n",
+                  s.compressed_files, s.compress_in, s.compress_out, ratio / 10, ratio % 10,
+                  ms_per_mb, s.skipped_files,
+                  storage_job.active ? ", one in progress" : "");
+}
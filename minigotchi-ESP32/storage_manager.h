@@ -0,0 +1,71 @@
+#ifndef STORAGE_MANAGER_H
+#define STORAGE_MANAGER_H
+
+#include "esp_err.h"
+#include <stdint.h>
+
+/**
+ * storage_manager.h: SD space quota and background compression
+ *
+ * Keeps Config::storageMinFreeMB free on the card by deleting the oldest
+ * closed captures. Captures without handshakes go first, captures with
+ * handshakes after them, handshake CSVs last. Which captures hold
+ * handshakes is recorded with an empty <base>_<n>.hs marker next to them.
+ *
+ * storage_step() runs from the main scheduler. Between space checks it
+ * gzips one closed capture a slice at a time (eapolscan_N.pcap becomes
+ * eapolscan_N.pcap.gz), again leaving handshake captures until last.
+ */
+
+#define STORAGE_STEP_MS 1000            // Scheduler period of storage_step()
+#define STORAGE_CHECK_MS 30000          // Free space is re-read this often
+#define STORAGE_SLICE_BYTES (32 * 1024) // Input compressed per step
+#define STORAGE_MAX_FILES 256           // Captures looked at per directory scan
+
+typedef struct {
+    uint64_t total_bytes;
+    uint64_t used_bytes;
+    uint32_t evicted_files;
+    uint64_t evicted_bytes;
+    uint32_t compressed_files;
+    uint32_t skipped_files;     // Did not get smaller, left as they were
+    uint64_t compress_in;       // Bytes read by finished compressions
+    uint64_t compress_out;      // Bytes they were written as
+    uint64_t compress_us;       // CPU time spent compressing
+} storage_stats_t;
+
+/**
+ * @brief Delete old files until the free space target is met
+ *
+ * Called before a new capture or CSV is opened. Waits for the storage
+ * mutex, which a compression slice or an eviction can hold for a while, so
+ * never call it from the WiFi callback.
+ *
+ * @return ESP_OK if enough space is free, ESP_ERR_NO_MEM if nothing is left to delete
+ */
+esp_err_t storage_make_room();
+
+/**
+ * @brief Mark the open capture as holding a handshake
+ *
+ * Safe from the WiFi callback: it only records the index, the marker file
+ * is written by the next storage_step() or storage_make_room().
+ */
+void storage_mark_handshake();
+
+/**
+ * @brief One slice of background work, called every STORAGE_STEP_MS
+ */
+void storage_step();
+
+/**
+ * @brief Copy the counters
+ */
+void storage_get_stats(storage_stats_t *out);
+
+/**
+ * @brief Print space, eviction and compression figures
+ */
+void storage_print_stats();
+
+#endif // STORAGE_MANAGER_H
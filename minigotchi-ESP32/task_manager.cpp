@@ -1,20 +1,49 @@
 #include "task_manager.h"
-#include "mood.h"
 #include <Arduino.h>
+#include <string.h>
 
-SemaphoreHandle_t TaskManager::task_mutex = NULL;
-static std::map<std::string, bool> task_exit_flags;
+/** developer note:
+ *
+ * the old manager kept a std::map of names plus a second map of exit flags,
+ * so every taskShouldExit() call built a std::string on the heap, and
+ * deleteTask() took the mutex and then called isTaskRunning(), which took
+ * it again and never came back. slots are now fixed, the table is only held
+ * under a spinlock for a few loads and stores, and every FreeRTOS call that
+ * can block or yield is made with nothing held.
+ *
+ */
+
+static_assert(TASK_MANAGER_MAX_TASKS <= 24, "one event group bit per slot");
+
+#define TASK_ID_SLOT(id) ((id) % TASK_MANAGER_MAX_TASKS)
+#define TASK_ID_GENERATION(id) ((id) / TASK_MANAGER_MAX_TASKS)
+#define TASK_ID_MAKE(slot, gen) ((task_id_t)((gen) * TASK_MANAGER_MAX_TASKS + (slot)))
+#define TASK_GENERATIONS (0x7FFF / TASK_MANAGER_MAX_TASKS)
+
+static uint32_t task_runtime_now() {
+#if configGENERATE_RUN_TIME_STATS
+    return portGET_RUN_TIME_COUNTER_VALUE();
+#else
+    return 0;
+#endif
+}
 
 TaskManager::TaskManager() {
-    task_mutex = xSemaphoreCreateMutex();
-    if (task_mutex == NULL) {
-        Serial.println("TaskManager: Failed to create mutex!");
+    memset(slots, 0, sizeof(slots));
+    slots_mutex = portMUX_INITIALIZER_UNLOCKED;
+    cancel_bits = xEventGroupCreate();
+    done_bits = xEventGroupCreate();
+    if (cancel_bits == NULL || done_bits == NULL) {
+        Serial.println("TaskManager: Failed to create event groups!");
     }
 }
 
 TaskManager::~TaskManager() {
-    if (task_mutex != NULL) {
-        vSemaphoreDelete(task_mutex);
+    if (cancel_bits != NULL) {
+        vEventGroupDelete(cancel_bits);
+    }
+    if (done_bits != NULL) {
+        vEventGroupDelete(done_bits);
     }
 }
 
@@ -23,160 +52,317 @@ TaskManager& TaskManager::getInstance() {
     return instance;
 }
 
-bool TaskManager::createTask(const std::string& name, TaskFunction_t function, uint32_t stackSize, UBaseType_t priority, void* parameters, BaseType_t core) {
-    if (xSemaphoreTake(task_mutex, portMAX_DELAY) != pdTRUE) {
-        Serial.println("TaskManager: Failed to acquire mutex for task creation!");
-        return false;
+/**
+ * Slot of an id that still names a live task, -1 otherwise.
+ * Call with slots_mutex held.
+ */
+int TaskManager::slotOf(task_id_t id) {
+    if (id < 0) {
+        return -1;
     }
-    if (tasks.find(name) != tasks.end() && tasks[name] != NULL) {
-        Serial.printf("TaskManager: Task %s already exists! Deleting first.\n", name.c_str());
-        deleteTask(name);
+    int slot = TASK_ID_SLOT(id);
+    const task_slot_t& s = slots[slot];
+    if (!s.in_use || s.generation != TASK_ID_GENERATION(id)) {
+        return -1;
     }
-    task_exit_flags[name] = false;
-    TaskHandle_t handle = NULL;
+    return slot;
+}
+
+/**
+ * Call with slots_mutex held
+ */
+task_id_t TaskManager::findLocked(const char* name) {
+    for (int i = 0; i < TASK_MANAGER_MAX_TASKS; i++) {
+        if (slots[i].in_use && strncmp(slots[i].name, name, sizeof(slots[i].name)) == 0) {
+            return TASK_ID_MAKE(i, slots[i].generation);
+        }
+    }
+    return TASK_ID_INVALID;
+}
+
+/**
+ * Runs the task function, then frees the slot and signals join()
+ * @param pvParameters Slot index
+ */
+void TaskManager::trampoline(void* pvParameters) {
+    TaskManager& tm = getInstance();
+    int slot = (int)(intptr_t)pvParameters;
+    task_slot_t& s = tm.slots[slot];
+
+    s.function(s.parameters);
+
+    portENTER_CRITICAL(&tm.slots_mutex);
+    bool killing = s.killing;
+    if (!killing) {
+        s.handle = NULL;
+        s.in_use = false;
+    }
+    portEXIT_CRITICAL(&tm.slots_mutex);
+
+    if (killing) {
+        // deleteTask() already owns the slot and is about to delete us
+        vTaskSuspend(NULL);
+    }
+    xEventGroupSetBits(tm.done_bits, BIT(slot));
+    vTaskDelete(NULL);
+}
+
+task_id_t TaskManager::createTask(const char* name, TaskFunction_t function, uint32_t stackSize, UBaseType_t priority, void* parameters, BaseType_t core) {
+    if (cancel_bits == NULL || done_bits == NULL) {
+        return TASK_ID_INVALID;
+    }
+
+    task_id_t existing = find(name);
+    if (existing != TASK_ID_INVALID) {
+        Serial.printf("TaskManager: Task %s already exists! Deleting first.\n", name);
+        deleteTask(existing);
+    }
+
+    int slot = -1;
+    portENTER_CRITICAL(&slots_mutex);
+    for (int i = 0; i < TASK_MANAGER_MAX_TASKS; i++) {
+        if (!slots[i].in_use) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot >= 0) {
+        task_slot_t& s = slots[slot];
+        strlcpy(s.name, name, sizeof(s.name));
+        s.handle = NULL;
+        s.function = function;
+        s.parameters = parameters;
+        s.generation = (s.generation + 1) % TASK_GENERATIONS;
+        s.in_use = true;
+        s.killing = false;
+    }
+    portEXIT_CRITICAL(&slots_mutex);
+
+    if (slot < 0) {
+        Serial.printf("TaskManager: No free slot for task '%s'\n", name);
+        return TASK_ID_INVALID;
+    }
+
+    task_slot_t& s = slots[slot];
+    xEventGroupClearBits(cancel_bits, BIT(slot));
+    xEventGroupClearBits(done_bits, BIT(slot));
+    s.started_ms = millis();
+    s.runtime_base = task_runtime_now();
+
+    // the handle is stored before the new task can run, so self() works
+    // from its first line
     BaseType_t result;
     if (core >= 0) {
-        result = xTaskCreatePinnedToCore(function, name.c_str(), stackSize, parameters, priority, &handle, core);
+        result = xTaskCreatePinnedToCore(trampoline, name, stackSize, (void*)(intptr_t)slot, priority, &s.handle, core);
     } else {
-        result = xTaskCreate(function, name.c_str(), stackSize, parameters, priority, &handle);
+        result = xTaskCreate(trampoline, name, stackSize, (void*)(intptr_t)slot, priority, &s.handle);
     }
-    if (result == pdPASS && handle != NULL) {
-        tasks[name] = handle;
-        Serial.printf("TaskManager: Created task '%s' successfully\n", name.c_str());
-        xSemaphoreGive(task_mutex);
-        return true;
-    } else {
-        Serial.printf("TaskManager: Failed to create task '%s'\n", name.c_str());
-        xSemaphoreGive(task_mutex);
-        return false;
+    if (result != pdPASS) {
+        Serial.printf("TaskManager: Failed to create task '%s'\n", name);
+        portENTER_CRITICAL(&slots_mutex);
+        s.handle = NULL;
+        s.in_use = false;
+        portEXIT_CRITICAL(&slots_mutex);
+        return TASK_ID_INVALID;
     }
+    Serial.printf("TaskManager: Created task '%s' successfully\n", name);
+    return TASK_ID_MAKE(slot, s.generation);
 }
 
-bool TaskManager::suspendTask(const std::string& name) {
-    if (xSemaphoreTake(task_mutex, portMAX_DELAY) != pdTRUE) {
+bool TaskManager::cancel(task_id_t id) {
+    portENTER_CRITICAL(&slots_mutex);
+    int slot = slotOf(id);
+    portEXIT_CRITICAL(&slots_mutex);
+    if (slot < 0) {
         return false;
     }
-    auto it = tasks.find(name);
-    if (it != tasks.end() && it->second != NULL) {
-        vTaskSuspend(it->second);
-        Serial.printf("TaskManager: Suspended task '%s'\n", name.c_str());
-        xSemaphoreGive(task_mutex);
+    xEventGroupSetBits(cancel_bits, BIT(slot));
+    return true;
+}
+
+bool TaskManager::join(task_id_t id, uint32_t timeout_ms) {
+    portENTER_CRITICAL(&slots_mutex);
+    int slot = slotOf(id);
+    portEXIT_CRITICAL(&slots_mutex);
+    if (slot < 0) {
+        return true; // already returned, the slot may even be reused
+    }
+    if (slots[slot].handle == xTaskGetCurrentTaskHandle()) {
+        return false; // a task cannot wait for itself
+    }
+    EventBits_t bits = xEventGroupWaitBits(done_bits, BIT(slot), pdFALSE, pdTRUE, pdMS_TO_TICKS(timeout_ms));
+    if (bits & BIT(slot)) {
         return true;
     }
-    xSemaphoreGive(task_mutex);
-    return false;
+    // the done bit is cleared when the slot is reused, check the id as well
+    portENTER_CRITICAL(&slots_mutex);
+    bool gone = slotOf(id) < 0;
+    portEXIT_CRITICAL(&slots_mutex);
+    return gone;
 }
 
-bool TaskManager::resumeTask(const std::string& name) {
-    if (xSemaphoreTake(task_mutex, portMAX_DELAY) != pdTRUE) {
+bool TaskManager::deleteTask(task_id_t id, uint32_t timeout_ms) {
+    if (!cancel(id)) {
         return false;
     }
-    auto it = tasks.find(name);
-    if (it != tasks.end() && it->second != NULL) {
-        vTaskResume(it->second);
-        Serial.printf("TaskManager: Resumed task '%s'\n", name.c_str());
-        xSemaphoreGive(task_mutex);
+    const char* name = slots[TASK_ID_SLOT(id)].name;
+    if (join(id, timeout_ms)) {
+        Serial.printf("TaskManager: Task '%s' exited gracefully\n", name);
         return true;
     }
-    xSemaphoreGive(task_mutex);
-    return false;
-}
 
-bool TaskManager::signalTaskToExit(const std::string& name, uint32_t timeout_ms) {
-    task_exit_flags[name] = true;
-    TickType_t start_time = xTaskGetTickCount();
-    const TickType_t max_wait_ticks = pdMS_TO_TICKS(timeout_ms);
-    while (isTaskRunning(name) && (xTaskGetTickCount() - start_time) < max_wait_ticks) {
-        vTaskDelay(pdMS_TO_TICKS(100));
+    int slot = TASK_ID_SLOT(id);
+    TaskHandle_t handle = NULL;
+    portENTER_CRITICAL(&slots_mutex);
+    if (slotOf(id) >= 0 && !slots[slot].killing) {
+        slots[slot].killing = true;
+        handle = slots[slot].handle;
     }
-    return !isTaskRunning(name);
+    portEXIT_CRITICAL(&slots_mutex);
+    if (handle == NULL || handle == xTaskGetCurrentTaskHandle()) {
+        return handle == NULL;
+    }
+
+    Serial.printf("TaskManager: Forcing deletion of task '%s'\n", name);
+    vTaskDelete(handle);
+    portENTER_CRITICAL(&slots_mutex);
+    slots[slot].handle = NULL;
+    slots[slot].in_use = false;
+    slots[slot].killing = false;
+    portEXIT_CRITICAL(&slots_mutex);
+    xEventGroupSetBits(done_bits, BIT(slot));
+    return true;
 }
 
-bool TaskManager::deleteTask(const std::string& name, uint32_t timeout_ms) {
-    if (xSemaphoreTake(task_mutex, portMAX_DELAY) != pdTRUE) {
+bool TaskManager::deleteTask(const char* name, uint32_t timeout_ms) {
+    return deleteTask(find(name), timeout_ms);
+}
+
+bool TaskManager::suspendTask(task_id_t id) {
+    TaskHandle_t handle = getTaskHandle(id);
+    if (handle == NULL) {
         return false;
     }
-    auto it = tasks.find(name);
-    if (it != tasks.end() && it->second != NULL) {
-        bool graceful_exit = signalTaskToExit(name, timeout_ms);
-        if (!graceful_exit) {
-            Serial.printf("TaskManager: Forcing deletion of task '%s'\n", name.c_str());
-            vTaskDelete(it->second);
-        } else {
-            Serial.printf("TaskManager: Task '%s' exited gracefully\n", name.c_str());
-        }
-        tasks.erase(it);
-        xSemaphoreGive(task_mutex);
-        return true;
-    }
-    xSemaphoreGive(task_mutex);
-    return false;
+    vTaskSuspend(handle);
+    Serial.printf("TaskManager: Suspended task '%s'\n", slots[TASK_ID_SLOT(id)].name);
+    return true;
 }
 
-bool TaskManager::isTaskRunning(const std::string& name) {
-    if (xSemaphoreTake(task_mutex, portMAX_DELAY) != pdTRUE) {
+bool TaskManager::resumeTask(task_id_t id) {
+    TaskHandle_t handle = getTaskHandle(id);
+    if (handle == NULL) {
         return false;
     }
-    auto it = tasks.find(name);
-    if (it != tasks.end() && it->second != NULL) {
-        eTaskState state = eTaskGetState(it->second);
-        bool running = (state != eDeleted && state != eInvalid);
-        xSemaphoreGive(task_mutex);
-        return running;
-    }
-    xSemaphoreGive(task_mutex);
-    return false;
+    vTaskResume(handle);
+    Serial.printf("TaskManager: Resumed task '%s'\n", slots[TASK_ID_SLOT(id)].name);
+    return true;
+}
+
+bool TaskManager::isTaskRunning(task_id_t id) {
+    return getTaskHandle(id) != NULL;
 }
 
-TaskHandle_t TaskManager::getTaskHandle(const std::string& name) {
-    if (xSemaphoreTake(task_mutex, portMAX_DELAY) != pdTRUE) {
-        return NULL;
+bool TaskManager::isTaskRunning(const char* name) {
+    return find(name) != TASK_ID_INVALID;
+}
+
+TaskHandle_t TaskManager::getTaskHandle(task_id_t id) {
+    portENTER_CRITICAL(&slots_mutex);
+    int slot = slotOf(id);
+    TaskHandle_t handle = slot >= 0 ? slots[slot].handle : NULL;
+    portEXIT_CRITICAL(&slots_mutex);
+    return handle;
+}
+
+TaskHandle_t TaskManager::getTaskHandle(const char* name) {
+    return getTaskHandle(find(name));
+}
+
+task_id_t TaskManager::find(const char* name) {
+    portENTER_CRITICAL(&slots_mutex);
+    task_id_t id = findLocked(name);
+    portEXIT_CRITICAL(&slots_mutex);
+    return id;
+}
+
+task_id_t TaskManager::self() {
+    TaskHandle_t current = xTaskGetCurrentTaskHandle();
+    task_id_t id = TASK_ID_INVALID;
+    portENTER_CRITICAL(&slots_mutex);
+    for (int i = 0; i < TASK_MANAGER_MAX_TASKS; i++) {
+        if (slots[i].in_use && slots[i].handle == current) {
+            id = TASK_ID_MAKE(i, slots[i].generation);
+            break;
+        }
     }
-    auto it = tasks.find(name);
-    if (it != tasks.end()) {
-        TaskHandle_t handle = it->second;
-        xSemaphoreGive(task_mutex);
-        return handle;
+    portEXIT_CRITICAL(&slots_mutex);
+    return id;
+}
+
+bool TaskManager::shouldExit(task_id_t id) {
+    if (id < 0 || cancel_bits == NULL) {
+        return false;
     }
-    xSemaphoreGive(task_mutex);
-    return NULL;
+    return (xEventGroupGetBits(cancel_bits) & BIT(TASK_ID_SLOT(id))) != 0;
 }
 
 void TaskManager::printTaskStats() {
-    if (xSemaphoreTake(task_mutex, portMAX_DELAY) != pdTRUE) {
-        return;
+    struct {
+        char name[configMAX_TASK_NAME_LEN];
+        TaskHandle_t handle;
+        task_id_t id;
+        uint32_t started_ms;
+        uint32_t runtime_base;
+    } copy[TASK_MANAGER_MAX_TASKS];
+    int count = 0;
+
+    portENTER_CRITICAL(&slots_mutex);
+    for (int i = 0; i < TASK_MANAGER_MAX_TASKS; i++) {
+        if (slots[i].in_use && slots[i].handle != NULL && !slots[i].killing) {
+            memcpy(copy[count].name, slots[i].name, sizeof(copy[count].name));
+            copy[count].handle = slots[i].handle;
+            copy[count].id = TASK_ID_MAKE(i, slots[i].generation);
+            copy[count].started_ms = slots[i].started_ms;
+            copy[count].runtime_base = slots[i].runtime_base;
+            count++;
+        }
     }
+    portEXIT_CRITICAL(&slots_mutex);
+
+    uint32_t now_runtime = task_runtime_now();
     Serial.println("\n--- Task Manager Statistics ---");
-    Serial.printf("Number of managed tasks: %d\n", tasks.size());
-    for (const auto& pair : tasks) {
-        const std::string& task_name = pair.first;
-        TaskHandle_t handle = pair.second;
-        if (handle != NULL) {
-            eTaskState state = eTaskGetState(handle);
-            UBaseType_t stack_high_water = uxTaskGetStackHighWaterMark(handle);
-            Serial.printf("Task: %-20s | State: ", task_name.c_str());
-            switch (state) {
-                case eRunning: Serial.print("Running  "); break;
-                case eReady: Serial.print("Ready    "); break;
-                case eBlocked: Serial.print("Blocked  "); break;
-                case eSuspended: Serial.print("Suspended"); break;
-                case eDeleted: Serial.print("Deleted  "); break;
-                default: Serial.print("Unknown  "); break;
-            }
-            Serial.printf(" | Stack HWM: %u bytes\n", stack_high_water);
-        } else {
-            Serial.printf("Task: %-20s | State: Invalid handle\n", task_name.c_str());
+    Serial.printf("Number of managed tasks: %d of %d\n", count, TASK_MANAGER_MAX_TASKS);
+    for (int i = 0; i < count; i++) {
+        TaskStatus_t status;
+        vTaskGetInfo(copy[i].handle, &status, pdTRUE, eInvalid);
+        Serial.printf("Task: %-16s | Id: %5d | State: ", copy[i].name, copy[i].id);
+        switch (status.eCurrentState) {
+            case eRunning: Serial.print("Running  "); break;
+            case eReady: Serial.print("Ready    "); break;
+            case eBlocked: Serial.print("Blocked  "); break;
+            case eSuspended: Serial.print("Suspended"); break;
+            case eDeleted: Serial.print("Deleted  "); break;
+            default: Serial.print("Unknown  "); break;
         }
+        Serial.printf(" | Stack HWM: %5u bytes | Up: %lu s", (unsigned)status.usStackHighWaterMark,
+                      (unsigned long)((millis() - copy[i].started_ms) / 1000));
+#if configGENERATE_RUN_TIME_STATS
+        // share of one core since the task was created
+        uint32_t elapsed = now_runtime - copy[i].runtime_base;
+        Serial.printf(" | CPU: %u%%", elapsed ? (unsigned)((uint64_t)status.ulRunTimeCounter * 100 / elapsed) : 0);
+#else
+        (void)now_runtime;
+#endif
+        Serial.printf(" | Cancel: %s\n", shouldExit(copy[i].id) ? "yes" : "no");
     }
     Serial.println("-------------------------------");
-    xSemaphoreGive(task_mutex);
 }
 
+/**
+ * Name based check kept for C callers, tasks started through the manager
+ * should call shouldExit(self()) instead
+ */
 extern "C" bool taskShouldExit(const char* task_name) {
-    std::string name(task_name);
-    auto it = task_exit_flags.find(name);
-    if (it != task_exit_flags.end()) {
-        return it->second;
-    }
-    return false;
+    TaskManager& tm = TaskManager::getInstance();
+    return tm.shouldExit(tm.find(task_name));
 }
@@ -3,30 +3,105 @@
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
 #include <Arduino.h>
-#include <functional>
-#include <string>
-#include <map>
+
+/**
+ * Managed tasks live in a fixed slot table. createTask() hands out a small
+ * integer id (slot plus a generation, so an id never names a newer task in
+ * the same slot). Cancellation and completion are one bit each in two event
+ * groups, so checking for a stop request is a single bit test, and nothing
+ * is allocated after the manager is constructed.
+ *
+ * Task functions started here may simply return, the manager deletes the
+ * task and wakes anyone waiting in join().
+ */
+
+#define TASK_MANAGER_MAX_TASKS 16 // One bit per slot, event groups hold 24
+#define TASK_ID_INVALID -1
+
+typedef int16_t task_id_t;
 
 class TaskManager {
 public:
     static TaskManager& getInstance();
     TaskManager(TaskManager const&) = delete;
     void operator=(TaskManager const&) = delete;
-    bool createTask(const std::string& name, TaskFunction_t function, uint32_t stackSize = 4096, UBaseType_t priority = 1, void* parameters = nullptr, BaseType_t core = -1);
-    bool suspendTask(const std::string& name);
-    bool resumeTask(const std::string& name);
-    bool deleteTask(const std::string& name, uint32_t timeout_ms = 2000);
-    bool isTaskRunning(const std::string& name);
-    TaskHandle_t getTaskHandle(const std::string& name);
+
+    /**
+     * Starts a task, an existing task with the same name is stopped first
+     * @return Id of the task, TASK_ID_INVALID on failure
+     */
+    task_id_t createTask(const char* name, TaskFunction_t function, uint32_t stackSize = 4096, UBaseType_t priority = 1, void* parameters = nullptr, BaseType_t core = -1);
+
+    /**
+     * Asks a task to stop, does not wait
+     * @param id Task to stop
+     */
+    bool cancel(task_id_t id);
+
+    /**
+     * Waits for a task to return
+     * @param id Task to wait for
+     * @param timeout_ms Longest wait
+     * @return true if the task is gone
+     */
+    bool join(task_id_t id, uint32_t timeout_ms);
+
+    /**
+     * Cancels a task, joins it and deletes it if it did not stop in time
+     */
+    bool deleteTask(task_id_t id, uint32_t timeout_ms = 2000);
+    bool deleteTask(const char* name, uint32_t timeout_ms = 2000);
+
+    bool suspendTask(task_id_t id);
+    bool resumeTask(task_id_t id);
+    bool isTaskRunning(task_id_t id);
+    bool isTaskRunning(const char* name);
+    TaskHandle_t getTaskHandle(task_id_t id);
+    TaskHandle_t getTaskHandle(const char* name);
+
+    /**
+     * Id of a running task by name, TASK_ID_INVALID if none
+     */
+    task_id_t find(const char* name);
+
+    /**
+     * Id of the calling task, look it up once at the top of the task
+     */
+    task_id_t self();
+
+    /**
+     * True once cancel() was called for the task
+     * @param id Task to check, usually the result of self()
+     */
+    bool shouldExit(task_id_t id);
+
     void printTaskStats();
+
 private:
+    typedef struct {
+        char name[configMAX_TASK_NAME_LEN];
+        TaskHandle_t handle;     // NULL while the slot is free or being torn down
+        TaskFunction_t function;
+        void* parameters;
+        uint32_t started_ms;
+        uint32_t runtime_base;   // Run time counter when the task was created
+        uint8_t generation;
+        bool in_use;
+        bool killing;            // deleteTask() is force deleting the task
+    } task_slot_t;
+
     TaskManager();
     ~TaskManager();
-    static SemaphoreHandle_t task_mutex;
-    std::map<std::string, TaskHandle_t> tasks;
-    bool signalTaskToExit(const std::string& name, uint32_t timeout_ms);
+    static void trampoline(void* pvParameters);
+    int slotOf(task_id_t id);
+    task_id_t findLocked(const char* name);
+
+    task_slot_t slots[TASK_MANAGER_MAX_TASKS];
+    EventGroupHandle_t cancel_bits;
+    EventGroupHandle_t done_bits;
+    portMUX_TYPE slots_mutex;
 };
 
 extern "C" bool taskShouldExit(const char* task_name);
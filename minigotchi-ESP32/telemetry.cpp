@@ -0,0 +1,257 @@
+#include "telemetry.h"
+#include "channel.h"
+#include "task_manager.h"
+#include "wifi_manager.h"
+#include "wifi_sniffer.h"
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include <freertos/task.h>
+#include <stddef.h>
+#include <string.h>
+
+/** developer note:
+ *
+ * this replaces the heap and task table dump that loop() used to print on
+ * every pass. the sampler fills the back snapshot with nothing held, then
+ * swaps it to the front under a spinlock, readers copy under the same lock
+ * so they never see a half written table.
+ *
+ */
+
+static telemetry_snapshot_t telemetry_snapshots[2];
+static int telemetry_front = -1; // -1 until the first sample
+static telemetry_sample_t telemetry_ring[TELEMETRY_HISTORY];
+static int telemetry_ring_head = 0;
+static int telemetry_ring_count = 0;
+static portMUX_TYPE telemetry_mutex = portMUX_INITIALIZER_UNLOCKED;
+
+// Only touched by the sampler task
+static TaskStatus_t telemetry_status[TELEMETRY_MAX_TASKS];
+static TaskHandle_t telemetry_prev_handle[TELEMETRY_MAX_TASKS];
+static uint32_t telemetry_prev_runtime[TELEMETRY_MAX_TASKS];
+static int telemetry_prev_count = 0;
+static uint32_t telemetry_prev_total = 0;
+
+// Scratch copies for the printers, kept off the caller's stack
+static telemetry_snapshot_t telemetry_print_snapshot;
+static telemetry_sample_t telemetry_print_history[TELEMETRY_HISTORY];
+static SemaphoreHandle_t telemetry_print_mutex = NULL;
+
+static const char *const telemetry_wifi_states[] = {
+    "uninitialized", "off", "sta", "ap", "monitor", "scanning", "changing"};
+
+static const char *telemetry_wifi_name(uint8_t state) {
+    return state < sizeof(telemetry_wifi_states) / sizeof(telemetry_wifi_states[0])
+               ? telemetry_wifi_states[state]
+               : "?";
+}
+
+/**
+ * Runtime of a task at the previous sample, 0 if it is new
+ */
+static uint32_t telemetry_prev_runtime_of(TaskHandle_t handle) {
+    for (int i = 0; i < telemetry_prev_count; i++) {
+        if (telemetry_prev_handle[i] == handle) {
+            return telemetry_prev_runtime[i];
+        }
+    }
+    return 0;
+}
+
+static void telemetry_sample(telemetry_snapshot_t *snap) {
+    telemetry_sample_t &s = snap->sample;
+    s.timestamp_ms = millis();
+    s.free_heap = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    s.min_free_heap = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+    s.largest_block = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    // sampling starts before boot creates the WiFi manager, don't do it from here
+    bool wifi_up = WifiManager::is_created();
+    s.wifi_state = wifi_up ? WifiManager::getInstance().get_current_state() : WIFI_STATE_UNINITIALIZED;
+    s.channel = wifi_up ? Channel::getChannel() : 0;
+    s.sniffer_running = is_sniffer_running();
+    s.cpu_busy = TELEMETRY_CPU_UNKNOWN;
+
+    uint32_t total = 0;
+    UBaseType_t count = uxTaskGetSystemState(telemetry_status, TELEMETRY_MAX_TASKS, &total);
+    snap->task_count = count;
+
+    uint32_t elapsed = (total - telemetry_prev_total) * portNUM_PROCESSORS;
+    bool have_runtime = total != 0 && telemetry_prev_total != 0 && elapsed != 0;
+    uint32_t idle = 0;
+
+    for (UBaseType_t i = 0; i < count; i++) {
+        TaskStatus_t &st = telemetry_status[i];
+        telemetry_task_t &t = snap->tasks[i];
+        strlcpy(t.name, st.pcTaskName, sizeof(t.name));
+        t.stack_hwm = st.usStackHighWaterMark;
+#if configTASKLIST_INCLUDE_COREID
+        t.core = st.xCoreID == tskNO_AFFINITY ? 0xFF : st.xCoreID;
+#else
+        t.core = 0xFF;
+#endif
+        t.cpu_percent = TELEMETRY_CPU_UNKNOWN;
+        if (have_runtime) {
+            uint32_t ran = st.ulRunTimeCounter - telemetry_prev_runtime_of(st.xHandle);
+            t.cpu_percent = (uint64_t)ran * 100 / elapsed;
+            if (strncmp(st.pcTaskName, "IDLE", 4) == 0) {
+                idle += ran;
+            }
+        }
+    }
+    if (have_runtime) {
+        s.cpu_busy = idle < elapsed ? 100 - (uint64_t)idle * 100 / elapsed : 0;
+    }
+
+    for (UBaseType_t i = 0; i < count; i++) {
+        telemetry_prev_handle[i] = telemetry_status[i].xHandle;
+        telemetry_prev_runtime[i] = telemetry_status[i].ulRunTimeCounter;
+    }
+    telemetry_prev_count = count;
+    telemetry_prev_total = total;
+}
+
+static void telemetry_task(void *pvParameters) {
+    TickType_t last_wake = xTaskGetTickCount();
+    for (;;) {
+        int back = telemetry_front == 0 ? 1 : 0;
+        telemetry_sample(&telemetry_snapshots[back]);
+
+        portENTER_CRITICAL(&telemetry_mutex);
+        telemetry_front = back;
+        telemetry_ring[telemetry_ring_head] = telemetry_snapshots[back].sample;
+        telemetry_ring_head = (telemetry_ring_head + 1) % TELEMETRY_HISTORY;
+        if (telemetry_ring_count < TELEMETRY_HISTORY) {
+            telemetry_ring_count++;
+        }
+        portEXIT_CRITICAL(&telemetry_mutex);
+
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(TELEMETRY_INTERVAL_MS));
+    }
+}
+
+esp_err_t telemetry_init() {
+    if (TaskManager::getInstance().isTaskRunning("telemetry_task")) {
+        return ESP_OK;
+    }
+    if (telemetry_print_mutex == NULL) {
+        telemetry_print_mutex = xSemaphoreCreateMutex();
+        if (telemetry_print_mutex == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    if (TaskManager::getInstance().createTask("telemetry_task", telemetry_task, 3072, 0, NULL, 0) == TASK_ID_INVALID) {
+        Serial.println("[TELEMETRY] Failed to create sampler task");
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+bool telemetry_latest(telemetry_snapshot_t *out) {
+    bool ok = false;
+    portENTER_CRITICAL(&telemetry_mutex);
+    if (telemetry_front >= 0) {
+        // tasks past task_count are stale, leave them out of the copy
+        const telemetry_snapshot_t &src = telemetry_snapshots[telemetry_front];
+        memcpy(out, &src, offsetof(telemetry_snapshot_t, tasks) +
+                              src.task_count * sizeof(telemetry_task_t));
+        ok = true;
+    }
+    portEXIT_CRITICAL(&telemetry_mutex);
+    return ok;
+}
+
+int telemetry_history(telemetry_sample_t *out, int max) {
+    portENTER_CRITICAL(&telemetry_mutex);
+    int n = telemetry_ring_count < max ? telemetry_ring_count : max;
+    int start = (telemetry_ring_head - n + TELEMETRY_HISTORY) % TELEMETRY_HISTORY;
+    for (int i = 0; i < n; i++) {
+        out[i] = telemetry_ring[(start + i) % TELEMETRY_HISTORY];
+    }
+    portEXIT_CRITICAL(&telemetry_mutex);
+    return n;
+}
+
+
+void telemetry_print(Print &out) {
+    if (telemetry_print_mutex == NULL) {
+        out.println("[TELEMETRY] No samples yet, sampler not started");
+        return;
+    }
+    if (xSemaphoreTake(telemetry_print_mutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        out.println("[TELEMETRY] Busy, try again");
+        return;
+    }
+    if (!telemetry_latest(&telemetry_print_snapshot)) {
+        out.println("[TELEMETRY] No samples yet");
+        xSemaphoreGive(telemetry_print_mutex);
+        return;
+    }
+
+    const telemetry_sample_t &s = telemetry_print_snapshot.sample;
+    out.printf("[TELEMETRY] t=%lu ms heap=%lu min=%lu largest=%lu cpu=%d%% wifi=%s ch=%u sniffer=%s\n",
+               (unsigned long)s.timestamp_ms, (unsigned long)s.free_heap,
+               (unsigned long)s.min_free_heap, (unsigned long)s.largest_block,
+               s.cpu_busy == TELEMETRY_CPU_UNKNOWN ? -1 : s.cpu_busy,
+               telemetry_wifi_name(s.wifi_state), s.channel,
+               s.sniffer_running ? "on" : "off");
+    out.println("[TELEMETRY] task             core  stack free  cpu%");
+    for (int i = 0; i < telemetry_print_snapshot.task_count; i++) {
+        const telemetry_task_t &t = telemetry_print_snapshot.tasks[i];
+        out.printf("[TELEMETRY] %-16s %4d %11lu %5d\n", t.name,
+                   t.core == 0xFF ? -1 : t.core, (unsigned long)t.stack_hwm,
+                   t.cpu_percent == TELEMETRY_CPU_UNKNOWN ? -1 : t.cpu_percent);
+    }
+
+    int n = telemetry_history(telemetry_print_history, TELEMETRY_HISTORY);
+    out.println("[TELEMETRY] history: t(ms) heap largest cpu%");
+    for (int i = 0; i < n; i++) {
+        const telemetry_sample_t &h = telemetry_print_history[i];
+        out.printf("[TELEMETRY] %lu %lu %lu %u\n", (unsigned long)h.timestamp_ms,
+                   (unsigned long)h.free_heap, (unsigned long)h.largest_block, h.cpu_busy);
+    }
+    xSemaphoreGive(telemetry_print_mutex);
+}
+
+static void telemetry_write_sample_json(Print &out, const telemetry_sample_t &s) {
+    out.printf("{\"t\":%lu,\"heap\":%lu,\"min_heap\":%lu,\"largest\":%lu,"
+               "\"cpu\":%d,\"wifi\":\"%s\",\"ch\":%u,\"sniffer\":%s}",
+               (unsigned long)s.timestamp_ms, (unsigned long)s.free_heap,
+               (unsigned long)s.min_free_heap, (unsigned long)s.largest_block,
+               s.cpu_busy == TELEMETRY_CPU_UNKNOWN ? -1 : s.cpu_busy,
+               telemetry_wifi_name(s.wifi_state), s.channel,
+               s.sniffer_running ? "true" : "false");
+}
+
+void telemetry_write_json(Print &out) {
+    if (telemetry_print_mutex == NULL ||
+        xSemaphoreTake(telemetry_print_mutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        out.print("{}");
+        return;
+    }
+    if (!telemetry_latest(&telemetry_print_snapshot)) {
+        out.print("{}");
+        xSemaphoreGive(telemetry_print_mutex);
+        return;
+    }
+
+    out.print("{\"latest\":");
+    telemetry_write_sample_json(out, telemetry_print_snapshot.sample);
+    out.print(",\"tasks\":[");
+    for (int i = 0; i < telemetry_print_snapshot.task_count; i++) {
+        const telemetry_task_t &t = telemetry_print_snapshot.tasks[i];
+        out.printf("%s{\"name\":\"%s\",\"core\":%d,\"stack_free\":%lu,\"cpu\":%d}",
+                   i ? "," : "", t.name, t.core == 0xFF ? -1 : t.core,
+                   (unsigned long)t.stack_hwm,
+                   t.cpu_percent == TELEMETRY_CPU_UNKNOWN ? -1 : t.cpu_percent);
+    }
+    out.print("],\"history\":[");
+    int n = telemetry_history(telemetry_print_history, TELEMETRY_HISTORY);
+    for (int i = 0; i < n; i++) {
+        if (i) {
+            out.print(",");
+        }
+        telemetry_write_sample_json(out, telemetry_print_history[i]);
+    }
+    out.print("]}");
+    xSemaphoreGive(telemetry_print_mutex);
+}
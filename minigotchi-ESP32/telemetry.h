@@ -0,0 +1,85 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "esp_err.h"
+#include <Print.h>
+#include <stdint.h>
+#include <freertos/FreeRTOS.h>
+
+/**
+ * telemetry.h: periodic system sampler
+ *
+ * A low priority task samples heap, largest free block, per-task stack
+ * high water marks, CPU share and WiFi state every TELEMETRY_INTERVAL_MS.
+ * The latest sample keeps the full task table, older ones keep the scalar
+ * figures in a fixed ring. Nothing is allocated after telemetry_init().
+ */
+
+#define TELEMETRY_INTERVAL_MS 5000
+#define TELEMETRY_HISTORY 32   // Samples kept, ~2.5 minutes at the default interval
+#define TELEMETRY_MAX_TASKS 32
+#define TELEMETRY_CPU_UNKNOWN 0xFF
+
+typedef struct {
+    char name[configMAX_TASK_NAME_LEN];
+    uint32_t stack_hwm;   // Bytes of stack never touched
+    uint8_t cpu_percent;  // Share of both cores since the previous sample
+    uint8_t core;         // Core affinity, 0xFF for either
+} telemetry_task_t;
+
+typedef struct {
+    uint32_t timestamp_ms;
+    uint32_t free_heap;
+    uint32_t min_free_heap;
+    uint32_t largest_block;
+    uint8_t wifi_state;   // wifi_operational_state_t
+    uint8_t channel;
+    uint8_t cpu_busy;     // Non-idle share of both cores, percent
+    bool sniffer_running;
+} telemetry_sample_t;
+
+typedef struct {
+    telemetry_sample_t sample;
+    uint8_t task_count;
+    telemetry_task_t tasks[TELEMETRY_MAX_TASKS];
+} telemetry_snapshot_t;
+
+/**
+ * @brief Start the sampler task
+ *
+ * @return ESP_OK if the task is running
+ */
+esp_err_t telemetry_init();
+
+/**
+ * @brief Copy the latest snapshot
+ *
+ * @param out Where to copy it
+ * @return false if nothing has been sampled yet
+ */
+bool telemetry_latest(telemetry_snapshot_t *out);
+
+/**
+ * @brief Copy up to max samples, oldest first
+ *
+ * @param out Where to copy them
+ * @param max Capacity of out
+ * @return Number of samples copied
+ */
+int telemetry_history(telemetry_sample_t *out, int max);
+
+/**
+ * @brief Print the latest snapshot and the history as text
+ *
+ * @param out Serial or any other Print
+ */
+void telemetry_print(Print &out);
+
+/**
+ * @brief Write the latest snapshot and the history as JSON
+ *
+ * @param out Serial, a web response stream or any other Print
+ */
+void telemetry_write_json(Print &out);
+
+#endif // TELEMETRY_H
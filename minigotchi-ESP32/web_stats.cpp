@@ -0,0 +1,119 @@
+#include "web_stats.h"
+#include "channel.h"
+#include "channel_hopper.h"
+#include "config.h"
+#include "hc22000.h"
+#include "pcap_logger.h"
+#include "pwnagotchi.h"
+#include "whitelist.h"
+#include "wifi_sniffer.h"
+#include <Arduino.h>
+#include <WiFi.h>
+#include <atomic>
+#include <esp_heap_caps.h>
+#include <esp_system.h>
+#include <string.h>
+
+/** developer note:
+ *
+ * a seqlock: the writer makes the counter odd, copies the figures in and
+ * makes it even again. a reader copies the snapshot between two reads of
+ * the counter and retries if they differ or are odd. the writer never
+ * waits on a reader, and a reader only spins for the few microseconds a
+ * copy takes. only one writer at a time, a second one just skips.
+ *
+ */
+
+#define WEB_STATS_READ_TRIES 8
+
+static web_stats_t ws_snapshot;
+static std::atomic<uint32_t> ws_seq{0};
+static std::atomic_flag ws_writing = ATOMIC_FLAG_INIT;
+static uint32_t ws_last_ms = 0;
+static uint32_t ws_published = 0;
+
+void web_stats_refresh(void) {
+    if (ws_writing.test_and_set(std::memory_order_acquire)) {
+        return;
+    }
+    uint32_t now = millis();
+    if (ws_published > 0 && now - ws_last_ms < WEB_STATS_INTERVAL_MS) {
+        ws_writing.clear(std::memory_order_release);
+        return;
+    }
+    ws_last_ms = now;
+
+    // gather first, the figures may take locks
+    web_stats_t s = {};
+    pcap_write_stats_t pcap;
+    pcap_logger_get_stats(&pcap);
+    hc22000_stats_t hc;
+    hc22000_get_stats(&hc);
+    whitelist_stats_t wl;
+    whitelist_get_stats(&wl);
+    s.seq = ++ws_published;
+    s.uptime_ms = now;
+    s.sniffer_running = is_sniffer_running();
+    s.capture = pcap_logger_current_index();
+    s.kb_logged = (uint32_t)(pcap.bytes_logged / 1024);
+    s.frames_deduped = pcap.frames_deduped;
+    s.hashes = hc.pmkids + hc.pairs;
+    s.channel = s.sniffer_running ? Channel::getChannel() : 0;
+    s.hops_ok = get_successful_channel_hops();
+    s.hops_failed = get_failed_channel_hops();
+    s.hop_interval_ms = get_channel_hop_interval_ms();
+    s.free_heap = esp_get_free_heap_size();
+    s.min_free_heap = esp_get_minimum_free_heap_size();
+    s.largest_block = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    s.peers_seen = Pwnagotchi::peersSeen;
+    s.peer_detected = Pwnagotchi::pwnagotchiDetected;
+    s.clients = WiFi.softAPgetStationNum();
+    s.configured = Config::configured;
+    s.whitelist_entries = wl.entries;
+
+    ws_seq.fetch_add(1, std::memory_order_relaxed); // odd, readers retry
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(&ws_snapshot, &s, sizeof(s));
+    ws_seq.fetch_add(1, std::memory_order_release);
+    ws_writing.clear(std::memory_order_release);
+}
+
+bool web_stats_get(web_stats_t *out) {
+    for (int i = 0; i < WEB_STATS_READ_TRIES; i++) {
+        uint32_t before = ws_seq.load(std::memory_order_acquire);
+        if (before == 0) {
+            return false;
+        }
+        if (before & 1) {
+            taskYIELD();
+            continue;
+        }
+        memcpy(out, &ws_snapshot, sizeof(*out));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (ws_seq.load(std::memory_order_relaxed) == before) {
+            return true;
+        }
+    }
+    return false; // a writer kept getting in the way, the caller can try again later
+}
+
+size_t web_stats_json(char *buf, size_t size) {
+    web_stats_t s;
+    if (!web_stats_get(&s)) {
+        return 0;
+    }
+    int n = snprintf(buf, size,
+                     "{\"seq\":%u,\"up\":%u,"
+                     "\"cap\":{\"on\":%d,\"file\":%d,\"kb\":%u,\"dedup\":%u,\"hashes\":%u},"
+                     "\"hop\":{\"ch\":%u,\"ok\":%u,\"fail\":%u,\"ms\":%u},"
+                     "\"heap\":{\"free\":%u,\"min\":%u,\"big\":%u},"
+                     "\"peers\":{\"seen\":%u,\"now\":%d},"
+                     "\"portal\":{\"clients\":%u,\"configured\":%d,\"whitelist\":%u}}",
+                     s.seq, s.uptime_ms,
+                     s.sniffer_running, (int)s.capture, s.kb_logged, s.frames_deduped, s.hashes,
+                     s.channel, s.hops_ok, s.hops_failed, s.hop_interval_ms,
+                     s.free_heap, s.min_free_heap, s.largest_block,
+                     s.peers_seen, s.peer_detected,
+                     s.clients, s.configured, s.whitelist_entries);
+    return n > 0 && (size_t)n < size ? n : 0;
+}
@@ -0,0 +1,73 @@
+#ifndef WEB_STATS_H
+#define WEB_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * web_stats.h: live figures for the web UI
+ *
+ * web_stats_refresh() gathers capture, channel hop, heap, peer and portal
+ * figures (taking whatever locks their modules need) and publishes them
+ * under a sequence counter. The HTTP handler copies them out without a
+ * lock, so a poll of /stats never waits on the SD card or the pcap mutex,
+ * and answers in a few hundred bytes instead of the whole page.
+ *
+ * The setup portal task refreshes it before the scheduler runs, after that
+ * the "webstats" activity does, so the figures stay current in download
+ * mode as well.
+ */
+
+#define WEB_STATS_INTERVAL_MS 1000 // Snapshot refresh period
+#define WEB_STATS_JSON_MAX 384     // Largest rendered /stats body
+
+typedef struct {
+    uint32_t seq;               // Snapshots published so far
+    uint32_t uptime_ms;
+    // capture
+    bool sniffer_running;
+    int32_t capture;            // Open capture index, -1 if none
+    uint32_t kb_logged;
+    uint32_t frames_deduped;
+    uint32_t hashes;            // WPA*01 and WPA*02 lines written
+    // hop
+    uint8_t channel;
+    uint32_t hops_ok;
+    uint32_t hops_failed;
+    uint32_t hop_interval_ms;
+    // heap
+    uint32_t free_heap;
+    uint32_t min_free_heap;
+    uint32_t largest_block;
+    // peers
+    uint32_t peers_seen;
+    bool peer_detected;         // Seen in the current detection window
+    // portal
+    uint8_t clients;            // Stations on the web UI access point
+    bool configured;
+    uint32_t whitelist_entries; // In the compiled whitelist set
+} web_stats_t;
+
+/**
+ * @brief Gather the figures and publish a new snapshot
+ *
+ * Rate limited to WEB_STATS_INTERVAL_MS, call it as often as convenient.
+ * A call that overlaps one from another task is skipped.
+ */
+void web_stats_refresh(void);
+
+/**
+ * @brief Copy the latest snapshot, never blocks
+ *
+ * @return false if nothing was published yet
+ */
+bool web_stats_get(web_stats_t *out);
+
+/**
+ * @brief Render the latest snapshot as compact JSON
+ *
+ * @return Length written, 0 if nothing was published yet
+ */
+size_t web_stats_json(char *buf, size_t size);
+
+#endif // WEB_STATS_H
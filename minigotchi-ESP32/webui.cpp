@@ -21,8 +21,21 @@
  */
 
 #include "webui.h"
+#include "telemetry.h"
+#include "capture_api.h"
+#include "whitelist.h"
+#include "web_stats.h"
+#include "webui_assets.h" // Generated by webui_assets.py
+#include "logger.h"
+#include "wifi_manager.h"
+#include <rom/crc.h>
 
 bool WebUI::running = false;
+bool WebUI::downloading = false;
+
+// routes are registered and the server listening, the portal and the
+// download mode share one AsyncWebServer and it is never torn down
+static bool server_started = false;
 
 // Initialize static members
 DNSServer WebUI::dnsServer;
@@ -112,12 +125,82 @@ const char WebUI::html[] = R"rawliteral(
             <input type="submit" value="Submit">
         </form><br>
     </div>
+    <div class="textbox">
+        <h2>Captures</h2>
+        <p>The capture list is at <a href="/captures">/captures</a>, fetch a file with <i>/capture?name=FILE</i></p>
+    </div>
+    <div class="textbox">
+        <h2>Live stats</h2>
+        <p id="stats">Waiting for <a href="/stats">/stats</a>...</p>
+    </div>
   </div>
   <footer>Made by <a href="https://github.com/dj1ch">@dj1ch</a></footer>
+  <script>
+    function poll() {
+      fetch('/stats').then(function (r) { return r.json(); }).then(function (s) {
+        document.getElementById('stats').textContent =
+          (s.portal.configured
+            ? 'CH ' + s.hop.ch + ' (' + s.hop.ok + ' hops, ' + s.hop.fail + ' failed) | ' +
+              (s.cap.on ? 'capture ' + s.cap.file + ': ' + s.cap.kb + ' KB, ' : 'not capturing, ') +
+              s.cap.hashes + ' hashes | ' + s.peers.seen + ' friends'
+            : s.portal.whitelist + ' whitelist entries | not configured yet') +
+          ' | ' + s.portal.clients + ' connected | heap ' + Math.round(s.heap.free / 1024) + ' KB free';
+      }).catch(function () {}).then(function () { setTimeout(poll, 2000); });
+    }
+    poll();
+  </script>
 </body>
 </html>
 )rawliteral";
 
+// validators for the page, set once webui_assets.h is checked against html
+static bool page_gz_valid = false;
+static char page_etag[12];
+static char page_etag_gz[16];
+
+/**
+ * Checks webui_assets.h still holds html, the gzip trailer carries the
+ * CRC-32 and length of what was compressed
+ */
+static void checkPageAssets() {
+  size_t len = strlen(WebUI::html);
+  uint32_t crc = crc32_le(0, (const uint8_t *)WebUI::html, len);
+  uint32_t gz_crc, gz_len;
+  memcpy(&gz_crc, webui_index_gz + sizeof(webui_index_gz) - 8, 4);
+  memcpy(&gz_len, webui_index_gz + sizeof(webui_index_gz) - 4, 4);
+  page_gz_valid = gz_crc == crc && gz_len == len;
+  snprintf(page_etag, sizeof(page_etag), "\"%08x\"", (unsigned)crc);
+  snprintf(page_etag_gz, sizeof(page_etag_gz), "\"%08x-gz\"", (unsigned)crc);
+  if (!page_gz_valid) {
+    LOGW("webui", "webui_assets.h does not match the page, run webui_assets.py. Serving it uncompressed");
+  }
+}
+
+/**
+ * Sends the page, gzipped when the client takes it, or 304 if the client's
+ * copy is current. Browsers revalidate on every load but only fetch the
+ * page again after it changed.
+ * @param request Request to answer
+ */
+static void sendPage(AsyncWebServerRequest *request) {
+  bool gz = page_gz_valid && request->hasHeader("Accept-Encoding") &&
+            request->getHeader("Accept-Encoding")->value().indexOf("gzip") >= 0;
+  const char *etag = gz ? page_etag_gz : page_etag;
+  AsyncWebServerResponse *response;
+  if (request->hasHeader("If-None-Match") && request->getHeader("If-None-Match")->value() == etag) {
+    response = request->beginResponse(304);
+  } else if (gz) {
+    response = request->beginResponse_P(200, "text/html", webui_index_gz, sizeof(webui_index_gz));
+    response->addHeader("Content-Encoding", "gzip");
+  } else {
+    response = request->beginResponse_P(200, "text/html", WebUI::html);
+  }
+  response->addHeader("ETag", etag);
+  response->addHeader("Cache-Control", "no-cache");
+  response->addHeader("Vary", "Accept-Encoding");
+  request->send(response);
+}
+
 // captive portal class, this isn't the main class though
 class CaptivePortalHandler : public AsyncWebHandler {
 public:
@@ -129,11 +212,7 @@ public:
   }
 
   void handleRequest(AsyncWebServerRequest *request) {
-    if (request->method() == HTTP_GET && request->url() == "/") {
-      request->send(200, "text/html", WebUI::html);
-    } else {
-      request->send(200, "text/html", WebUI::html);
-    }
+    sendPage(request);
   }
 };
 
@@ -157,6 +236,7 @@ WebUI::WebUI() {
   if (WiFi.softAPIP()) { WebUI::dnsServer.start(53, "*", WiFi.softAPIP()); } else { Serial.println("Error: softAPIP is not valid, DNS server not started."); }
 
   server.begin();
+  server_started = true;
   WebUI::running = true;
   Serial.println("WebUI Constructor: Setup complete. Returning control to WebUITask.");
 }
@@ -167,6 +247,9 @@ WebUI::~WebUI() {}
  * Sets up Web Server
  */
 void WebUI::setupServer() {
+  checkPageAssets();
+  whitelist_load(Config::whitelist); // Deauth::list() only runs after the portal
+  web_stats_refresh(); // first snapshot before anyone polls
   server.addHandler(new CaptivePortalHandler()).setFilter(ON_AP_FILTER);
 
   // handle whitelist
@@ -194,11 +277,83 @@ void WebUI::setupServer() {
     }
   });
 
-  server.onNotFound([&](AsyncWebServerRequest *request) {
-    request->send(200, "text/html", html);
+  // latest telemetry snapshot plus history, written straight into the response
+  server.on("/telemetry", HTTP_GET, [](AsyncWebServerRequest *request) {
+    AsyncResponseStream *response =
+        request->beginResponseStream("application/json");
+    telemetry_write_json(*response);
+    request->send(response);
+  });
+
+  // a few hundred bytes of live figures for the page to poll, copied
+  // from the published snapshot without taking any lock
+  server.on("/stats", HTTP_GET, [](AsyncWebServerRequest *request) {
+    char body[WEB_STATS_JSON_MAX];
+    size_t len = web_stats_json(body, sizeof(body));
+    AsyncWebServerResponse *response;
+    if (len == 0) {
+      response = request->beginResponse(503, "application/json", "{}");
+      response->addHeader("Retry-After", "1");
+    } else {
+      response = request->beginResponse(200, "application/json", body);
+    }
+    response->addHeader("Cache-Control", "no-store");
+    request->send(response);
+  });
+
+  // capture listing and downloads straight off the sd card
+  capture_api_register(server);
+
+  server.onNotFound([](AsyncWebServerRequest *request) {
+    sendPage(request);
   });
 }
 
+/**
+ * Brings the access point back up after configuration so captures can be
+ * fetched, the caller stops the sniffer first. The routes are only added
+ * if the setup portal didn't already do so this boot.
+ * @return true if the access point is up
+ */
+bool WebUI::startDownloads() {
+  if (downloading) {
+    return true;
+  }
+  if (!WifiManager::getInstance().request_ap_mode("downloads")) {
+    Serial.println(Mood::getInstance().getBroken() + " Download mode: could not switch to AP mode");
+    return false;
+  }
+  if (!WiFi.softAP(Config::ssid, Config::pass)) {
+    Serial.println(Mood::getInstance().getBroken() + " Download mode: soft AP failed to start");
+    WifiManager::getInstance().release_wifi_control("downloads");
+    return false;
+  }
+  if (!server_started) {
+    setupServer();
+    server.begin();
+    server_started = true;
+  }
+  downloading = true;
+  Serial.print(Mood::getInstance().getHappy() + " Download mode, captures at http://");
+  Serial.print(WiFi.softAPIP());
+  Serial.println("/captures");
+  Display::updateDisplay(Mood::getInstance().getHappy(), "Downloads on " + WiFi.softAPIP().toString());
+  return true;
+}
+
+/**
+ * Takes the download access point down, the caller restarts the sniffer.
+ * The server keeps listening, there is just no interface to reach it on.
+ */
+void WebUI::stopDownloads() {
+  if (!downloading) {
+    return;
+  }
+  downloading = false;
+  WifiManager::getInstance().release_wifi_control("downloads");
+  Serial.println(Mood::getInstance().getNeutral() + " Download mode off");
+}
+
 /**
  * Update the whitelist with the new values
  * @param newWhiteList new whitelist to use
@@ -216,4 +371,7 @@ void WebUI::updateWhitelist(String newWhitelist) {
 
   // add last element after last comma
   Config::whitelist.push_back(newWhitelist.substring(start).c_str());
+
+  // swap the compiled set in, the sniffer and Deauth see it on their next lookup
+  whitelist_load(Config::whitelist);
 }
\ No newline at end of file
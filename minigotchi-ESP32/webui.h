@@ -42,8 +42,11 @@ public:
   static void setupServer();
   static void updateWhitelist(String newWhitelist);
   static void processDNS() { if(running) WebUI::dnsServer.processNextRequest(); }
+  static bool startDownloads();
+  static void stopDownloads();
   static const char html[] PROGMEM;
   static bool running;
+  static bool downloading; // Download access point is up, the sniffer is stopped
 
   static DNSServer dnsServer;
 
@@ -0,0 +1,93 @@
+// Generated by webui_assets.py from WebUI::html in webui.cpp, do not edit
+// 3513 bytes of page, 1293 gzipped
+
+#ifndef WEBUI_ASSETS_H
+#define WEBUI_ASSETS_H
+
+#include <Arduino.h>
+
+static const uint8_t webui_index_gz[] PROGMEM = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xa5, 0x57, 0x6d, 0x6f, 0xdb, 0x36,
+    0x10, 0xfe, 0xde, 0x5f, 0x71, 0x75, 0x51, 0xd8, 0x46, 0x1d, 0xc9, 0x4e, 0x97, 0x6c, 0x50, 0x14,
+    0x75, 0x6b, 0x9a, 0xa2, 0xc1, 0x1a, 0xac, 0x40, 0x03, 0x0c, 0xfb, 0x48, 0x49, 0x94, 0xc5, 0x86,
+    0x26, 0x05, 0x92, 0x8a, 0xe3, 0x2e, 0xfd, 0xef, 0x3b, 0x92, 0xb2, 0xf5, 0x62, 0xb7, 0x69, 0x57,
+    0x1b, 0x88, 0x29, 0x1e, 0xef, 0xee, 0xb9, 0x87, 0x0f, 0x4f, 0xcc, 0x93, 0xf8, 0xe9, 0x9b, 0xbf,
+    0x2e, 0x6e, 0xfe, 0xf9, 0x70, 0x09, 0xa5, 0x59, 0xf1, 0xe4, 0x49, 0xbc, 0xfd, 0xa1, 0x24, 0x4f,
+    0x9e, 0x00, 0xc4, 0x86, 0x19, 0x4e, 0x93, 0x6b, 0x26, 0x96, 0xd2, 0x64, 0x25, 0x83, 0x0b, 0x52,
+    0x19, 0x76, 0x47, 0xe1, 0x83, 0x54, 0x86, 0xf0, 0x38, 0xf4, 0x76, 0xbb, 0x52, 0x9b, 0x8d, 0x1f,
+    0xd9, 0x4f, 0x35, 0x83, 0x14, 0xfe, 0x6d, 0x1e, 0xec, 0xa7, 0x90, 0xc2, 0x1c, 0x15, 0x64, 0xc5,
+    0xf8, 0x26, 0x82, 0x3f, 0x14, 0x23, 0x7c, 0x06, 0xef, 0x28, 0xbf, 0xa3, 0x86, 0x65, 0x64, 0x06,
+    0x9a, 0x08, 0x7d, 0xa4, 0xa9, 0x62, 0xc5, 0x59, 0xc7, 0x29, 0x93, 0x5c, 0xaa, 0x08, 0xd6, 0x25,
+    0x33, 0x74, 0x3b, 0xff, 0xa5, 0xf9, 0x2d, 0x17, 0x33, 0x28, 0x8f, 0x7f, 0x2e, 0xc7, 0x2e, 0x16,
+    0x16, 0xdd, 0x8b, 0x94, 0x92, 0xec, 0x76, 0xa9, 0x64, 0x2d, 0xf2, 0xa3, 0x06, 0xc3, 0xb3, 0x8b,
+    0xb9, 0xfd, 0x0e, 0x3d, 0x0b, 0x29, 0x0d, 0x55, 0x3d, 0x5f, 0x43, 0xef, 0xcd, 0x11, 0xe1, 0x6c,
+    0x29, 0x22, 0xc8, 0xa8, 0x40, 0xf3, 0xd9, 0x10, 0xa3, 0x66, 0x9f, 0x69, 0x04, 0x8b, 0x79, 0x75,
+    0x7f, 0xf6, 0xb3, 0x14, 0xad, 0x88, 0x5a, 0x32, 0xcc, 0xf4, 0x6b, 0x1b, 0x6b, 0x8b, 0x2d, 0x48,
+    0xd9, 0xf2, 0xb1, 0xaa, 0x5e, 0x9e, 0xda, 0x6f, 0x37, 0x60, 0x2a, 0x55, 0x4e, 0xd5, 0x91, 0x22,
+    0x39, 0xab, 0x35, 0x82, 0x3c, 0xed, 0x83, 0x5c, 0xb3, 0xdc, 0x94, 0x11, 0x9c, 0x9e, 0x3c, 0xef,
+    0xce, 0x56, 0x24, 0xcf, 0x51, 0x22, 0x11, 0xfc, 0x36, 0xa8, 0x69, 0x0b, 0x6f, 0x0e, 0xa4, 0x36,
+    0x72, 0x0f, 0xa1, 0xe5, 0x2a, 0x95, 0xf7, 0x3d, 0x94, 0x39, 0xd3, 0x15, 0x27, 0x48, 0x41, 0xca,
+    0x65, 0x76, 0x7b, 0x28, 0xd8, 0x31, 0x26, 0xe9, 0xc5, 0xeb, 0x41, 0x18, 0xd2, 0xba, 0x45, 0x3c,
+    0x7f, 0x7e, 0x40, 0x5a, 0xcf, 0x8a, 0xa2, 0x47, 0xe7, 0xb7, 0x37, 0xef, 0x1b, 0xdc, 0xb4, 0x25,
+    0xd9, 0x03, 0xd1, 0x2b, 0xe8, 0x2b, 0xa9, 0xbe, 0x0a, 0xf8, 0xdb, 0x18, 0x76, 0x8c, 0x1e, 0xe0,
+    0xe0, 0x3b, 0xf7, 0x6e, 0xfe, 0x7c, 0x08, 0x9a, 0xcb, 0x25, 0x4a, 0x42, 0x18, 0xc2, 0xc4, 0x40,
+    0xcd, 0x87, 0xd9, 0x2b, 0x29, 0x5b, 0x96, 0x26, 0x82, 0x93, 0xf9, 0x00, 0xfb, 0x23, 0x08, 0xfe,
+    0xdf, 0x0e, 0x36, 0x41, 0x0f, 0x75, 0x83, 0x8e, 0xb9, 0x41, 0x7a, 0x72, 0xd0, 0xd7, 0x35, 0xa7,
+    0x08, 0xb4, 0xe4, 0x2c, 0xef, 0x9a, 0xe5, 0x1d, 0x55, 0x05, 0x97, 0xeb, 0xc8, 0x82, 0xe9, 0xb0,
+    0x12, 0x87, 0x4d, 0x3b, 0x8b, 0x43, 0xdf, 0x0a, 0xe3, 0x54, 0xe6, 0x1b, 0xd7, 0xe7, 0x72, 0x76,
+    0x07, 0x19, 0x27, 0x5a, 0x9f, 0x8f, 0xf0, 0x80, 0x8d, 0x7c, 0xc7, 0x8b, 0xcb, 0xc5, 0x76, 0xd2,
+    0x09, 0x60, 0x94, 0xfc, 0x4d, 0x79, 0x26, 0x57, 0x14, 0x8c, 0x04, 0x53, 0xd2, 0x41, 0xdf, 0xc4,
+    0xb3, 0xae, 0xdc, 0x34, 0x36, 0x56, 0xe6, 0x3b, 0xeb, 0x53, 0xcc, 0xb4, 0x68, 0x82, 0x75, 0x52,
+    0x34, 0x27, 0x64, 0xb4, 0x6d, 0xac, 0x71, 0x95, 0xdc, 0x94, 0x4c, 0xc3, 0xaa, 0xd6, 0x06, 0x52,
+    0x0a, 0xb9, 0x14, 0x14, 0xa4, 0x70, 0xc1, 0x0a, 0xa6, 0xec, 0x24, 0xb6, 0x24, 0x9b, 0x95, 0x0a,
+    0x5d, 0x2b, 0xcc, 0x5f, 0x12, 0x33, 0x48, 0x05, 0xaa, 0x16, 0x1a, 0x65, 0xa9, 0x14, 0xcd, 0x0c,
+    0xdf, 0x60, 0xe6, 0xaa, 0x49, 0x1c, 0x62, 0xe6, 0xc7, 0x31, 0xd8, 0x72, 0x8f, 0x93, 0x0b, 0x29,
+    0x0a, 0xb6, 0x0c, 0xb2, 0xaa, 0xc2, 0x50, 0x76, 0x58, 0x2b, 0x62, 0x98, 0x14, 0x58, 0xc7, 0x71,
+    0x67, 0x65, 0x95, 0x5c, 0xe6, 0xcc, 0x23, 0x28, 0x24, 0x47, 0xaa, 0x71, 0x8b, 0xe1, 0x8e, 0xf0,
+    0x9a, 0x6a, 0x94, 0x91, 0xb2, 0xe0, 0x39, 0xaa, 0xce, 0x2e, 0x10, 0xa0, 0xa9, 0x81, 0x98, 0x35,
+    0xa1, 0xa3, 0x68, 0x1b, 0x97, 0xe6, 0x71, 0xc8, 0x12, 0x5b, 0x14, 0x1a, 0x8d, 0xaa, 0xa9, 0x7d,
+    0xdc, 0xa1, 0x6e, 0xd2, 0x0c, 0x9f, 0xdf, 0x22, 0xc5, 0x42, 0xae, 0x67, 0x2e, 0x35, 0x26, 0xd9,
+    0xf8, 0xac, 0xb0, 0x91, 0x35, 0x64, 0x44, 0x00, 0xb5, 0xb0, 0x52, 0xaa, 0x59, 0x8e, 0x48, 0xec,
+    0x1a, 0x24, 0x8e, 0x53, 0x34, 0xac, 0xf0, 0xcc, 0x61, 0x1d, 0x34, 0x07, 0x92, 0xa2, 0x3e, 0x00,
+    0xd9, 0x46, 0x1f, 0xe5, 0x85, 0xc7, 0x99, 0x36, 0xc3, 0x4c, 0x57, 0xa2, 0xaa, 0x7d, 0x85, 0x1f,
+    0x3f, 0x5e, 0xbd, 0xd1, 0xc0, 0xd9, 0xad, 0xad, 0x87, 0xe9, 0xc9, 0x62, 0x8e, 0x92, 0xbf, 0x9f,
+    0x46, 0x16, 0xb7, 0xb5, 0x2d, 0x66, 0xf6, 0xef, 0xb1, 0xfb, 0xfb, 0x72, 0xbf, 0x08, 0x54, 0xc5,
+    0x0a, 0x48, 0x66, 0xb3, 0x9f, 0x8f, 0xc2, 0x25, 0x35, 0x1d, 0xca, 0xed, 0x67, 0xcb, 0xcb, 0x0e,
+    0x09, 0xc6, 0xf5, 0xb9, 0x37, 0x15, 0xf5, 0xfb, 0x34, 0x02, 0x41, 0x56, 0x38, 0xde, 0x2d, 0x19,
+    0x84, 0xe8, 0x39, 0xe8, 0x3a, 0x5d, 0x31, 0x74, 0x71, 0xc4, 0x9c, 0x8f, 0x3e, 0xfa, 0xc7, 0x5e,
+    0x6d, 0xd7, 0x04, 0x6b, 0xf1, 0x42, 0x92, 0xce, 0xab, 0xbb, 0x05, 0xc0, 0x84, 0xab, 0x13, 0x6c,
+    0x0f, 0x5f, 0xdb, 0x0d, 0x44, 0xa2, 0xc6, 0xca, 0xab, 0xf2, 0x69, 0xbf, 0xb6, 0xd0, 0x16, 0x97,
+    0xc4, 0xa9, 0x1a, 0xe0, 0xf9, 0xde, 0x9a, 0x5b, 0x2d, 0x7c, 0xbd, 0x68, 0xbf, 0xe6, 0xa7, 0x2a,
+    0x1e, 0xc0, 0xfc, 0xb1, 0x13, 0x81, 0x67, 0x1c, 0x01, 0xea, 0xbd, 0x13, 0x70, 0x83, 0xd2, 0xc8,
+    0xbc, 0x11, 0xdc, 0xb6, 0x21, 0x65, 0x78, 0x2a, 0x63, 0x02, 0xa5, 0xa2, 0x05, 0x96, 0xdd, 0x18,
+    0xf5, 0x28, 0xd9, 0x0d, 0xe3, 0x90, 0x24, 0x33, 0x28, 0x28, 0x1e, 0x58, 0x20, 0x78, 0xb4, 0xf1,
+    0xa5, 0xb2, 0x66, 0xa6, 0xb4, 0xf4, 0x6f, 0xd7, 0xbc, 0x72, 0x55, 0xbf, 0xbd, 0x7a, 0x7f, 0xd9,
+    0x93, 0xd2, 0x0f, 0x61, 0x7e, 0x6f, 0x9b, 0x92, 0x36, 0xc4, 0xec, 0xa1, 0x06, 0x96, 0x23, 0x5f,
+    0xd6, 0x82, 0xcd, 0x8c, 0x30, 0x63, 0xcf, 0xad, 0x6d, 0x5b, 0x2d, 0xea, 0xc6, 0x18, 0x36, 0xee,
+    0x24, 0x09, 0x82, 0x60, 0x1f, 0x45, 0x3b, 0xf0, 0x97, 0x25, 0x94, 0x54, 0x8e, 0x87, 0x6d, 0xd3,
+    0x06, 0x2a, 0x8d, 0xa9, 0x74, 0x14, 0x86, 0x4b, 0xac, 0xaf, 0x4e, 0x03, 0x6c, 0x9b, 0x61, 0xfe,
+    0x69, 0x91, 0x95, 0xa3, 0xe4, 0x77, 0xf7, 0x6b, 0x43, 0xdb, 0x8d, 0x71, 0xde, 0xee, 0xaa, 0x99,
+    0x29, 0x56, 0x19, 0x9f, 0xa7, 0xa8, 0x85, 0x13, 0x0f, 0x54, 0xd8, 0x5d, 0x26, 0xd3, 0xdd, 0xcb,
+    0xcb, 0x31, 0x37, 0x19, 0x7b, 0x70, 0xe3, 0x69, 0x60, 0xfb, 0xcb, 0x64, 0xb7, 0x78, 0xa2, 0x70,
+    0x25, 0x28, 0x8a, 0x34, 0x0a, 0x50, 0xc1, 0x27, 0x2d, 0xc5, 0x64, 0x7a, 0x06, 0x5f, 0xf6, 0xd6,
+    0xe9, 0x69, 0xe7, 0x75, 0x98, 0xcb, 0xac, 0xb6, 0xdd, 0x21, 0x40, 0x99, 0x5e, 0x72, 0x6a, 0x87,
+    0xaf, 0x37, 0x57, 0xf9, 0x64, 0xbc, 0x4b, 0x82, 0x1c, 0xa3, 0x60, 0x0d, 0x1a, 0xe0, 0xbc, 0xa3,
+    0xc2, 0x89, 0x0e, 0x2a, 0xd7, 0xf8, 0x83, 0x56, 0xc6, 0x3d, 0x91, 0xbe, 0x82, 0xf1, 0xc5, 0x3b,
+    0x18, 0xc3, 0x0b, 0xd0, 0x41, 0x29, 0xab, 0x00, 0x37, 0xfd, 0x05, 0x3e, 0x4e, 0xda, 0x19, 0x79,
+    0xeb, 0x66, 0x70, 0xa8, 0x67, 0x9d, 0x85, 0x05, 0x61, 0xdc, 0x19, 0xec, 0x80, 0xe6, 0x53, 0x78,
+    0xb0, 0xc6, 0x5e, 0x6c, 0x97, 0x1e, 0x25, 0x13, 0x60, 0x3d, 0x98, 0x67, 0x2b, 0x44, 0x1f, 0xc3,
+    0xce, 0x3b, 0x71, 0x61, 0x8c, 0xa8, 0x33, 0x77, 0x9b, 0xba, 0xa8, 0x7f, 0xbe, 0xb6, 0xc9, 0xd0,
+    0x20, 0xf0, 0xa5, 0xe2, 0x3d, 0x51, 0x07, 0x38, 0x37, 0xdd, 0x4b, 0xe2, 0xfd, 0x4a, 0xa2, 0x4b,
+    0xec, 0xa7, 0x0e, 0xaa, 0x1f, 0x3e, 0x34, 0x51, 0x2b, 0x4a, 0x95, 0x0e, 0x34, 0xc5, 0x2e, 0xe1,
+    0xf0, 0x2a, 0x46, 0x45, 0xae, 0xc7, 0xbd, 0x28, 0x11, 0xec, 0x88, 0x6a, 0x7b, 0x9c, 0x5d, 0xdd,
+    0x3e, 0x21, 0xb5, 0xe8, 0x69, 0xc3, 0x3a, 0x48, 0x6d, 0x57, 0xd8, 0x50, 0x33, 0x40, 0x35, 0x6e,
+    0x73, 0x37, 0xe4, 0x73, 0xcc, 0x69, 0x3c, 0x3a, 0xf4, 0x14, 0xf8, 0xfa, 0x43, 0xc7, 0x07, 0x7c,
+    0x0f, 0x91, 0xca, 0xad, 0xbc, 0x26, 0xa6, 0x0c, 0xdc, 0x0d, 0x19, 0x29, 0xb3, 0xb3, 0x41, 0xa1,
+    0x28, 0x85, 0x10, 0xaf, 0x24, 0xc7, 0xbf, 0x4c, 0x1b, 0x46, 0xc0, 0xce, 0x8d, 0x77, 0x17, 0xbf,
+    0x29, 0xd6, 0x6d, 0xa5, 0xd6, 0x6a, 0x06, 0x25, 0xb3, 0x2f, 0x24, 0xab, 0x37, 0x7c, 0xbd, 0xdd,
+    0xb0, 0x15, 0x95, 0xb5, 0x99, 0x58, 0xb5, 0xce, 0xf0, 0x1e, 0x34, 0x9f, 0x3b, 0xd9, 0xf9, 0x68,
+    0xfe, 0x3e, 0xe6, 0x85, 0x7c, 0xe6, 0x6f, 0x21, 0x8d, 0xd2, 0xe3, 0xd0, 0xdf, 0x3f, 0xf0, 0x90,
+    0xba, 0x7f, 0xd0, 0xfe, 0x03, 0x2c, 0x0b, 0x5c, 0xae, 0xb9, 0x0d, 0x00, 0x00,
+};
+
+#endif // WEBUI_ASSETS_H
@@ -0,0 +1,295 @@
+#include "whitelist.h"
+#include "heap_tracker.h"
+#include <Arduino.h>
+#include <atomic>
+#include <esp_heap_caps.h>
+#include <sstream>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+/** developer note:
+ *
+ * readers bump the counter of the current epoch, load the set pointer, look
+ * and drop the counter again. the writer swaps the pointer, then twice
+ * flips the epoch and waits for the counter of the epoch it left to drain.
+ * a reader that took the old pointer is counted on one of the two sides,
+ * readers arriving after a flip go to the other counter and can't starve
+ * the writer. the learned BSSID table belongs to the promiscuous callback
+ * alone and is cleared when it notices a new set.
+ *
+ */
+
+#define WL_TAG_SSID 1ULL
+#define WL_TAG_BSSID 2ULL
+#define WL_TAG_OUI 3ULL
+#define WL_KEY(tag, value) (((tag) << 56) | ((value) & 0x00FFFFFFFFFFFFFFULL))
+
+typedef struct {
+    uint32_t mask;          // Slots - 1
+    uint32_t entries;
+    uint32_t generation;
+    bool has_oui;           // Skip the OUI probe when there are none
+    uint64_t keys[];        // 0 marks a free slot
+} wl_set_t;
+
+static std::atomic<wl_set_t *> wl_current{nullptr};
+static std::atomic<uint32_t> wl_epoch{0};
+static std::atomic<int32_t> wl_readers[2];
+static SemaphoreHandle_t wl_write_mutex = NULL;
+static uint32_t wl_generation = 0;
+static uint64_t wl_learned[WHITELIST_LEARNED_SLOTS];
+static uint32_t wl_learned_generation = 0;
+static uint32_t wl_learned_count = 0;
+static uint32_t wl_frames_excluded = 0;
+
+static inline wl_set_t *wl_read_begin(uint32_t *epoch) {
+    *epoch = wl_epoch.load();
+    wl_readers[*epoch & 1]++;
+    return wl_current.load();
+}
+
+static inline void wl_read_end(uint32_t epoch) { wl_readers[epoch & 1]--; }
+
+static inline uint32_t wl_slot(uint64_t key, uint32_t mask) {
+    key ^= key >> 29;
+    key *= 0x9E3779B97F4A7C15ULL;
+    return (uint32_t)(key >> 32) & mask;
+}
+
+static bool wl_contains(const wl_set_t *set, uint64_t key) {
+    for (uint32_t i = wl_slot(key, set->mask);; i = (i + 1) & set->mask) {
+        if (set->keys[i] == key) {
+            return true;
+        }
+        if (set->keys[i] == 0) {
+            return false; // the table is never full
+        }
+    }
+}
+
+static void wl_insert(wl_set_t *set, uint64_t key) {
+    for (uint32_t i = wl_slot(key, set->mask);; i = (i + 1) & set->mask) {
+        if (set->keys[i] == key) {
+            return;
+        }
+        if (set->keys[i] == 0) {
+            set->keys[i] = key;
+            return;
+        }
+    }
+}
+
+static uint64_t wl_ssid_hash(const uint8_t *ssid, size_t len) {
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ ssid[i]) * 1099511628211ULL;
+    }
+    return h;
+}
+
+static uint64_t wl_mac_value(const uint8_t *mac, int len) {
+    uint64_t v = 0;
+    for (int i = 0; i < len; i++) {
+        v = (v << 8) | mac[i];
+    }
+    return v;
+}
+
+/**
+ * Hex byte pairs split by ':' or '-', an optional ":*" at the end
+ * @return bytes parsed, -1 if the text is not an address
+ */
+static int wl_parse_mac(const std::string &s, uint8_t *out, int max) {
+    int n = 0;
+    size_t i = 0;
+    while (i < s.size()) {
+        if (n > 0) {
+            if (s[i] != ':' && s[i] != '-') {
+                return -1;
+            }
+            i++;
+            if (i + 1 == s.size() && s[i] == '*') {
+                return n;
+            }
+        }
+        if (n == max || i + 2 > s.size() || !isxdigit(s[i]) || !isxdigit(s[i + 1])) {
+            return -1;
+        }
+        out[n++] = strtoul(s.substr(i, 2).c_str(), NULL, 16);
+        i += 2;
+    }
+    return n;
+}
+
+/**
+ * Waits until no reader can still hold the set that was current before
+ */
+static void wl_synchronize() {
+    for (int i = 0; i < 2; i++) {
+        uint32_t left = wl_epoch.fetch_add(1);
+        while (wl_readers[left & 1].load() != 0) {
+            vTaskDelay(1);
+        }
+    }
+}
+
+esp_err_t whitelist_load(const std::vector<std::string> &entries) {
+    if (wl_write_mutex == NULL) {
+        wl_write_mutex = xSemaphoreCreateMutex(); // first load happens at boot, before any race
+        if (wl_write_mutex == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    // split and trim like Deauth::add, an entry such as "HomeNet, Office"
+    // names two networks
+    std::vector<std::string> tokens;
+    for (const std::string &entry : entries) {
+        std::stringstream ss(entry);
+        std::string token;
+        while (std::getline(ss, token, ',')) {
+            token.erase(0, token.find_first_not_of(" \t\r\n"));
+            token.erase(token.find_last_not_of(" \t\r\n") + 1);
+            if (!token.empty()) {
+                tokens.push_back(token);
+            }
+        }
+    }
+
+    // two keys at most per entry, kept under half full
+    uint32_t slots = 16;
+    while (slots < tokens.size() * 4) {
+        slots *= 2;
+    }
+    wl_set_t *set = (wl_set_t *)heap_track_malloc(HEAP_TAG_SNIFFER, sizeof(wl_set_t) + slots * sizeof(uint64_t),
+                                                  MALLOC_CAP_8BIT);
+    if (set == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    memset(set, 0, sizeof(wl_set_t) + slots * sizeof(uint64_t));
+    set->mask = slots - 1;
+
+    for (const std::string &entry : tokens) {
+        set->entries++;
+        wl_insert(set, WL_KEY(WL_TAG_SSID, wl_ssid_hash((const uint8_t *)entry.data(), entry.size())));
+        uint8_t mac[6];
+        int n = wl_parse_mac(entry, mac, sizeof(mac));
+        if (n == 6) {
+            wl_insert(set, WL_KEY(WL_TAG_BSSID, wl_mac_value(mac, 6)));
+        } else if (n == 3) {
+            wl_insert(set, WL_KEY(WL_TAG_OUI, wl_mac_value(mac, 3)));
+            set->has_oui = true;
+        }
+    }
+
+    xSemaphoreTake(wl_write_mutex, portMAX_DELAY);
+    set->generation = ++wl_generation;
+    wl_set_t *old = wl_current.exchange(set);
+    wl_synchronize();
+    xSemaphoreGive(wl_write_mutex);
+    heap_track_free(HEAP_TAG_SNIFFER, old);
+    return ESP_OK;
+}
+
+static bool wl_match_mac(const wl_set_t *set, const uint8_t *mac) {
+    return wl_contains(set, WL_KEY(WL_TAG_BSSID, wl_mac_value(mac, 6))) ||
+           (set->has_oui && wl_contains(set, WL_KEY(WL_TAG_OUI, wl_mac_value(mac, 3))));
+}
+
+bool whitelist_match_ssid(const uint8_t *ssid, size_t len) {
+    uint32_t epoch;
+    wl_set_t *set = wl_read_begin(&epoch);
+    bool hit = set != NULL && set->entries > 0 && wl_contains(set, WL_KEY(WL_TAG_SSID, wl_ssid_hash(ssid, len)));
+    wl_read_end(epoch);
+    return hit;
+}
+
+bool whitelist_match_bssid(const uint8_t *mac) {
+    uint32_t epoch;
+    wl_set_t *set = wl_read_begin(&epoch);
+    bool hit = set != NULL && set->entries > 0 && wl_match_mac(set, mac);
+    wl_read_end(epoch);
+    return hit;
+}
+
+static bool wl_learned_has(uint64_t mac) {
+    for (uint32_t i = wl_slot(mac, WHITELIST_LEARNED_SLOTS - 1), n = 0; n < WHITELIST_LEARNED_SLOTS;
+         i = (i + 1) & (WHITELIST_LEARNED_SLOTS - 1), n++) {
+        if (wl_learned[i] == mac) {
+            return true;
+        }
+        if (wl_learned[i] == 0) {
+            return false;
+        }
+    }
+    return false;
+}
+
+static void wl_learn(uint64_t mac) {
+    if (wl_learned_count >= WHITELIST_LEARNED_SLOTS / 2) {
+        return; // keep probes short, the set itself still matches by SSID
+    }
+    for (uint32_t i = wl_slot(mac, WHITELIST_LEARNED_SLOTS - 1);; i = (i + 1) & (WHITELIST_LEARNED_SLOTS - 1)) {
+        if (wl_learned[i] == mac) {
+            return;
+        }
+        if (wl_learned[i] == 0) {
+            wl_learned[i] = mac;
+            wl_learned_count++;
+            return;
+        }
+    }
+}
+
+bool whitelist_match_frame(const uint8_t *frame, size_t len) {
+    if (len < 24) {
+        return false;
+    }
+    uint32_t epoch;
+    wl_set_t *set = wl_read_begin(&epoch);
+    if (set == NULL || set->entries == 0) {
+        wl_read_end(epoch);
+        return false;
+    }
+    if (set->generation != wl_learned_generation) {
+        memset(wl_learned, 0, sizeof(wl_learned));
+        wl_learned_count = 0;
+        wl_learned_generation = set->generation;
+    }
+
+    bool hit = false;
+    for (int a = 0; a < 3 && !hit; a++) {
+        const uint8_t *mac = frame + 4 + 6 * a;
+        hit = wl_match_mac(set, mac) || (wl_learned_count > 0 && wl_learned_has(WL_KEY(WL_TAG_BSSID, wl_mac_value(mac, 6))));
+    }
+    // beacon or probe response naming a whitelisted network
+    if (!hit && (frame[0] == 0x80 || frame[0] == 0x50) && len >= 38 && frame[36] == 0 &&
+        38u + frame[37] <= len && wl_contains(set, WL_KEY(WL_TAG_SSID, wl_ssid_hash(frame + 38, frame[37])))) {
+        wl_learn(WL_KEY(WL_TAG_BSSID, wl_mac_value(frame + 16, 6)));
+        hit = true;
+    }
+    wl_read_end(epoch);
+    if (hit) {
+        wl_frames_excluded++;
+    }
+    return hit;
+}
+
+void whitelist_get_stats(whitelist_stats_t *out) {
+    uint32_t epoch;
+    wl_set_t *set = wl_read_begin(&epoch);
+    out->entries = set ? set->entries : 0;
+    out->slots = set ? set->mask + 1 : 0;
+    out->generation = set ? set->generation : 0;
+    wl_read_end(epoch);
+    out->learned = wl_learned_count;
+    out->frames_excluded = wl_frames_excluded;
+}
+
+void whitelist_print(void) {
+    whitelist_stats_t s;
+    whitelist_get_stats(&s);
+    Serial.printf("[WHITELIST] %u entries in %u slots, generation %u, %u BSSIDs learned, %u frames kept out of captures\n",
+                  s.entries, s.slots, s.generation, s.learned, s.frames_excluded);
+}
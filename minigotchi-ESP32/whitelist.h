@@ -0,0 +1,68 @@
+#ifndef WHITELIST_H
+#define WHITELIST_H
+
+#include "esp_err.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+ * whitelist.h: compiled whitelist shared by Deauth and the sniffer
+ *
+ * Config::whitelist entries are compiled into one open addressed set of
+ * 64-bit keys: every entry as an SSID hash, "aa:bb:cc:dd:ee:ff" also as a
+ * BSSID and "aa:bb:cc" (or "aa:bb:cc:*") also as an OUI prefix. Lookups
+ * take no lock and allocate nothing, so the promiscuous callback can use
+ * them to keep our own networks out of the captures.
+ *
+ * whitelist_load() builds a new set and swaps it in RCU style, readers
+ * still on the old set finish before it is freed.
+ */
+
+#define WHITELIST_LEARNED_SLOTS 64 // BSSIDs the sniffer saw beaconing a whitelisted SSID
+
+typedef struct {
+    uint32_t entries;       // Entries compiled into the current set
+    uint32_t slots;         // Table size of the current set
+    uint32_t generation;    // Sets published so far
+    uint32_t learned;       // BSSIDs learned from beacons for this set
+    uint32_t frames_excluded;
+} whitelist_stats_t;
+
+/**
+ * @brief Compile entries and publish them as the current set
+ *
+ * Each entry may list several networks split by ',', as Deauth::add()
+ * announces them. Not for the WiFi callback, allocates and waits for readers.
+ *
+ * @return ESP_ERR_NO_MEM if the new set could not be allocated, the old one stays
+ */
+esp_err_t whitelist_load(const std::vector<std::string> &entries);
+
+/**
+ * @brief SSID is whitelisted
+ */
+bool whitelist_match_ssid(const uint8_t *ssid, size_t len);
+
+/**
+ * @brief BSSID is whitelisted, directly or by its OUI
+ */
+bool whitelist_match_bssid(const uint8_t *mac);
+
+/**
+ * @brief Frame belongs to a whitelisted network and should not be captured
+ *
+ * Checks the three addresses and, for beacons and probe responses, the
+ * SSID. A BSSID seen beaconing a whitelisted SSID is remembered, so its
+ * data frames are excluded too. Only for the promiscuous callback.
+ *
+ * @param frame 802.11 frame starting at frame control
+ * @param len Frame length
+ */
+bool whitelist_match_frame(const uint8_t *frame, size_t len);
+
+void whitelist_get_stats(whitelist_stats_t *out);
+void whitelist_print(void);
+
+#endif // WHITELIST_H
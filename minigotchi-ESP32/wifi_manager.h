@@ -40,6 +40,10 @@ public:
     wifi_operational_state_t get_current_state();
     const char* get_current_controller_tag();
 
+    // True once the singleton has brought the stack up, lets early callers
+    // (the telemetry sampler) look without constructing it themselves
+    static bool is_created() { return is_initialized; }
+
 private:
     void initialize_wifi(); // Basic ESP-IDF init
     void deinitialize_wifi();
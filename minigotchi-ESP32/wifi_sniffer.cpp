@@ -10,6 +10,11 @@
 #include "channel_hopper.h"
 #include "wifi_frames.h"
 #include "handshake_logger.h"
+#include "hc22000.h"        // Crackable hashes next to the capture
+#include "whitelist.h"      // Our own networks stay out of the captures
+#include "pwnagotchi.h"     // Peer detection rides on the capture session
+#include "logger.h"
+#include "heap_tracker.h"
 // #include <WiFi.h> // WiFi.h is often included by Arduino.h or esp_wifi.h indirectly. Kept commented as per instruction.
 
 static bool sniffer_is_active = false; // Ensured
@@ -42,15 +47,25 @@ void wifi_promiscuous_rx_callback(void *buf, wifi_promiscuous_pkt_type_t type) {
     uint8_t *payload = pkt->payload;
     uint16_t len = pkt->rx_ctrl.sig_len;
 
+    if ((type == WIFI_PKT_MGMT || type == WIFI_PKT_DATA) && whitelist_match_frame(payload, len)) {
+        return;
+    }
+
     if (type == WIFI_PKT_MGMT || type == WIFI_PKT_DATA) {
         if (len > 0) {
             esp_err_t err = pcap_logger_write_packet(payload, len);
-            if (err != ESP_OK) {
-                ESP_LOGE(TAG_SNIFFER, "Failed to write packet to PCAP. Error: %s", esp_err_to_name(err));
+            if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) { // no file while starting or stopping
+                LOGE("sniffer", "Failed to write packet to PCAP. Error: %s", esp_err_to_name(err));
             }
         }
     }
 
+    if (type == WIFI_PKT_MGMT && len > 4) {
+        hc22000_note_mgmt(payload, len - 4);
+        Pwnagotchi::inspectBeacon(payload, len - 4, pkt->rx_ctrl.rssi); // strip FCS
+        return;
+    }
+
     if (type == WIFI_PKT_DATA) {
         if (len < sizeof(ieee80211_mac_hdr_t) + LLC_SNAP_HDR_LEN + 4) { 
             return;
@@ -91,8 +106,10 @@ void wifi_promiscuous_rx_callback(void *buf, wifi_promiscuous_pkt_type_t type) {
 
             uint8_t eapol_packet_type = eapol_frame_ptr[1]; 
             if (eapol_packet_type == 0x03) { // EAPOL-Key
+                hc22000_note_eapol(payload, eapol_frame_ptr, len_remaining);
+
                 if (len_remaining < 4 + EAPOL_KEY_FRAME_MIN_LEN) {
-                    ESP_LOGV(TAG_SNIFFER, "EAPOL-Key packet too short for full EAPOL Key header.");
+                    LOGD("sniffer", "EAPOL-Key packet too short for full EAPOL Key header.");
                     return;
                 }
 
@@ -131,7 +148,7 @@ void wifi_promiscuous_rx_callback(void *buf, wifi_promiscuous_pkt_type_t type) {
                 else if (is_pairwise && has_mic && !has_ack) eapol_msg_type = "M2 or M4 (STA to AP)"; 
                 else if (is_pairwise && has_mic && has_ack && is_install) eapol_msg_type = "M3 (AP to STA)"; 
                 
-                ESP_LOGI(TAG_SNIFFER, "EAPOL-Key! SA: %s, DA: %s, BSSID: %s, Type: %s, KeyInfo: 0x%04X, ReplayCounter: %llu",
+                LOGI("sniffer", "EAPOL-Key! SA: %s, DA: %s, BSSID: %s, Type: %s, KeyInfo: 0x%04X, ReplayCounter: %llu",
                     sa_str, da_str, bssid_str, eapol_msg_type.c_str(), key_info, replay_counter_host);
                 
                 // Log handshake to CSV file - determine BSSID based on frame direction
@@ -157,14 +174,20 @@ esp_err_t wifi_sniffer_start(void) {
     }
 
     Serial.println(Mood::getInstance().getIntense() + " wifi_sniffer_start: Requesting monitor mode...");
-    if (!WifiManager::getInstance().request_monitor_mode("sniffer_start")) {
+    size_t heap_before = esp_get_free_heap_size();
+    bool monitor_ok = WifiManager::getInstance().request_monitor_mode("sniffer_start");
+    heap_track_note(HEAP_TAG_SNIFFER, heap_before);
+    if (!monitor_ok) {
         Serial.println(Mood::getInstance().getBroken() + " wifi_sniffer_start: Failed to acquire monitor mode via WifiManager.");
         return ESP_FAIL;
     }
     Serial.println(Mood::getInstance().getHappy() + " wifi_sniffer_start: Monitor mode acquired via WifiManager.");
 
     Serial.println(Mood::getInstance().getIntense() + " Attempting to open PCAP file for sniffer...");
-    if (pcap_logger_open_new_file() != ESP_OK) {
+    heap_before = esp_get_free_heap_size();
+    esp_err_t pcap_err = pcap_logger_open_new_file();
+    heap_track_note(HEAP_TAG_PCAP, heap_before);
+    if (pcap_err != ESP_OK) {
         Serial.println(Mood::getInstance().getBroken() + " Sniffer: Failed to open PCAP file.");
         WifiManager::getInstance().release_wifi_control("sniffer_start_fail_pcap"); // Release monitor mode
         return ESP_FAIL;
@@ -178,6 +201,11 @@ esp_err_t wifi_sniffer_start(void) {
         WifiManager::getInstance().release_wifi_control("sniffer_start_fail_hs_init");
         return ESP_FAIL;
     }
+    if (hc22000_init() != ESP_OK) {
+        Serial.println(Mood::getInstance().getBroken() + " No memory for the hc22000 writer, hashes will only be in the pcap.");
+    } else if (hc22000_open() != ESP_OK) {
+        Serial.println(Mood::getInstance().getBroken() + " Could not open the hc22000 file, hashes will only be in the pcap.");
+    }
     if (handshake_logger_open_new_file() != ESP_OK) {
         Serial.println(Mood::getInstance().getBroken() + " Failed to open handshake CSV file.");
         pcap_logger_close_file();
@@ -245,11 +273,17 @@ esp_err_t wifi_sniffer_stop(void) {
     // Attempt to disable promiscuous mode itself, though WifiManager will handle mode transition
     esp_wifi_set_promiscuous(false); 
 
+    size_t heap_before = esp_get_free_heap_size();
     pcap_logger_close_file();
+    heap_track_note(HEAP_TAG_PCAP, heap_before);
     handshake_logger_close_file();
+    hc22000_close();
 
     Serial.println(Mood::getInstance().getNeutral() + " wifi_sniffer_stop: Releasing monitor mode...");
-    if (!WifiManager::getInstance().release_wifi_control("sniffer_stop")) {
+    heap_before = esp_get_free_heap_size();
+    bool released = WifiManager::getInstance().release_wifi_control("sniffer_stop");
+    heap_track_note(HEAP_TAG_SNIFFER, heap_before);
+    if (!released) {
          Serial.println(Mood::getInstance().getBroken() + " wifi_sniffer_stop: Failed to release monitor mode via WifiManager, or was not controller.");
          // If release failed, it might be because another component took control, or an error occurred.
          // WifiManager's release_wifi_control sets mode to OFF if it was the controller.
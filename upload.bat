@@ -36,6 +36,7 @@ echo Selected COM port: %selectedPort%
 echo Compiling and uploading Minigotchi ESP32 firmware with huge_app partition scheme...
 
 REM Try to compile first
+python webui_assets.py || exit /b 1
 arduino-cli compile --fqbn esp32:esp32:esp32:PartitionScheme=huge_app minigotchi-ESP32
 if %ERRORLEVEL% NEQ 0 (
     echo Compilation failed. Please fix the errors before uploading.
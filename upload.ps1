@@ -48,6 +48,8 @@ Write-Host "Selected COM port: $selectedPort" -ForegroundColor $Green
 Write-Host "Compiling and uploading Minigotchi ESP32 firmware with huge_app partition scheme..." -ForegroundColor $Green
 
 # Try to compile first
+python webui_assets.py
+if ($LASTEXITCODE -ne 0) { exit 1 }
 $compileResult = arduino-cli compile --fqbn "esp32:esp32:esp32:PartitionScheme=huge_app" minigotchi-ESP32
 if ($LASTEXITCODE -ne 0) {
     Write-Host "Compilation failed. Please fix the errors before uploading." -ForegroundColor $Red
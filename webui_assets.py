@@ -0,0 +1,59 @@
+#!/usr/bin/env python3
+# Gzips the captive portal page for the firmware
+#
+# Reads the WebUI::html raw literal out of minigotchi-ESP32/webui.cpp and
+# writes minigotchi-ESP32/webui_assets.h with the gzipped bytes. The build
+# scripts run this before compiling; run it by hand after editing the page
+# if you build from the Arduino IDE. A stale header is caught at boot (the
+# gzip trailer no longer matches the page) and the page is served plain.
+
+import gzip
+import os
+import re
+import sys
+
+ROOT = os.path.dirname(os.path.abspath(__file__))
+SOURCE = os.path.join(ROOT, "minigotchi-ESP32", "webui.cpp")
+OUTPUT = os.path.join(ROOT, "minigotchi-ESP32", "webui_assets.h")
+
+
+def main():
+    with open(SOURCE, "r", encoding="utf-8", newline="") as f:
+        text = f.read().replace("\r\n", "\n")
+    match = re.search(r'WebUI::html\[\]\s*=\s*R"rawliteral\((.*?)\)rawliteral"', text, re.S)
+    if match is None:
+        sys.exit("webui_assets.py: WebUI::html not found in " + SOURCE)
+    page = match.group(1).encode("utf-8")
+    packed = gzip.compress(page, compresslevel=9, mtime=0)  # no timestamp, same input gives the same bytes
+
+    lines = []
+    for i in range(0, len(packed), 16):
+        lines.append("    " + ", ".join("0x%02x" % b for b in packed[i:i + 16]) + ",")
+    header = (
+        "// Generated by webui_assets.py from WebUI::html in webui.cpp, do not edit\n"
+        "// %d bytes of page, %d gzipped\n"
+        "\n"
+        "#ifndef WEBUI_ASSETS_H\n"
+        "#define WEBUI_ASSETS_H\n"
+        "\n"
+        "#include <Arduino.h>\n"
+        "\n"
+        "static const uint8_t webui_index_gz[] PROGMEM = {\n"
+        "%s\n"
+        "};\n"
+        "\n"
+        "#endif // WEBUI_ASSETS_H\n" % (len(page), len(packed), "\n".join(lines))
+    )
+
+    old = None
+    if os.path.exists(OUTPUT):
+        with open(OUTPUT, "r", encoding="utf-8") as f:
+            old = f.read()
+    if old != header:  # leave the timestamp alone so the sketch is not rebuilt for nothing
+        with open(OUTPUT, "w", encoding="utf-8", newline="\n") as f:
+            f.write(header)
+    print("webui_assets.py: %d bytes of page, %d gzipped" % (len(page), len(packed)))
+
+
+if __name__ == "__main__":
+    main()